@@ -0,0 +1,496 @@
+#ifndef COMPILER_BATCH_DRIVER_HPP
+#define COMPILER_BATCH_DRIVER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <utils/concurrency/work_stealing_pool.hpp>
+#include <utils/hash/xxhash64.hpp>
+#include <utils/io/batch_reader.hpp>
+#include <utils/io/content_cache.hpp>
+#include <utils/profile/trace.hpp>
+#include <compiler/fused_parser.hpp>
+#include <compiler/lexical_analysis.hpp>
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+  struct batch_file_result_t
+  {
+    std::string path;
+    std::size_t bytes = 0;
+    std::size_t tokens = 0;
+    std::size_t invalid_characters = 0;
+    bool accepted = false;
+    // taken from the content cache instead of lexed and parsed
+    bool cached = false;
+    // parsed from the token stream in the content cache, which was lexed
+    // for other parser tables
+    bool replayed = false;
+    double seconds = 0;
+    std::vector<std::string> diagnostics;
+  };
+
+  // a token of a cached token stream: the parser's terminal id and the
+  // lexeme's place in the file
+  struct cached_token_t
+  {
+    int terminal;
+    std::size_t i_start;
+    std::size_t length;
+  };
+
+  inline void append_varint(std::string& bytes, std::uint64_t value)
+  {
+    for (; value >= 0x80; value >>= 7) {
+      bytes += char(value | 0x80);
+    }
+    bytes += char(value);
+  }
+
+  inline bool read_varint(std::string_view& bytes, std::uint64_t& value)
+  {
+    value = 0;
+    for (int shift = 0; shift < 64 && !bytes.empty(); shift += 7) {
+      auto byte = (unsigned char)bytes.front();
+      bytes.remove_prefix(1);
+      value |= std::uint64_t(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // compact form of a file's result and token stream for the content
+  // cache, after the fingerprint of the analyser that produced the result:
+  // varints throughout, token starts as the gap after the previous token
+  inline std::string encode_batch_result(std::uint64_t analyser_fingerprint,
+      const batch_file_result_t& result, const std::vector<cached_token_t>& tokens)
+  {
+    std::string bytes;
+    append_varint(bytes, analyser_fingerprint);
+    append_varint(bytes, result.bytes);
+    append_varint(bytes, result.invalid_characters);
+    append_varint(bytes, result.accepted);
+    append_varint(bytes, result.diagnostics.size());
+    for (auto&& diagnostic: result.diagnostics) {
+      append_varint(bytes, diagnostic.size());
+      bytes += diagnostic;
+    }
+    append_varint(bytes, tokens.size());
+    std::size_t i_end = 0;
+    for (auto&& token: tokens) {
+      // unknown_terminal_id is the only negative id in a stream
+      append_varint(bytes, std::uint64_t(token.terminal - unknown_terminal_id));
+      append_varint(bytes, token.i_start - i_end);
+      append_varint(bytes, token.length);
+      i_end = token.i_start + token.length;
+    }
+    return bytes;
+  }
+
+  // false on a malformed entry, including tokens outside result.bytes;
+  // tokens are only decoded when asked for
+  inline bool decode_batch_result(std::string_view bytes, std::uint64_t& analyser_fingerprint,
+      batch_file_result_t& result, std::vector<cached_token_t>* tokens = nullptr)
+  {
+    std::uint64_t value, num_diagnostics, num_tokens;
+    if (!read_varint(bytes, analyser_fingerprint)) {
+      return false;
+    }
+    if (!read_varint(bytes, value)) {
+      return false;
+    }
+    result.bytes = value;
+    if (!read_varint(bytes, value)) {
+      return false;
+    }
+    result.invalid_characters = value;
+    if (!read_varint(bytes, value)) {
+      return false;
+    }
+    result.accepted = value != 0;
+    if (!read_varint(bytes, num_diagnostics)) {
+      return false;
+    }
+    result.diagnostics.clear();
+    while (num_diagnostics--) {
+      if (!read_varint(bytes, value) || value > bytes.size()) {
+        return false;
+      }
+      result.diagnostics.emplace_back(bytes.substr(0, value));
+      bytes.remove_prefix(value);
+    }
+    if (!read_varint(bytes, num_tokens)) {
+      return false;
+    }
+    result.tokens = num_tokens;
+    if (tokens) {
+      tokens->clear();
+      std::size_t i_end = 0;
+      std::uint64_t terminal, gap, length;
+      while (num_tokens--) {
+        if (!read_varint(bytes, terminal) || !read_varint(bytes, gap) || !read_varint(bytes, length)
+            || gap > result.bytes - i_end || length > result.bytes - i_end - gap
+            || terminal > std::uint64_t(std::numeric_limits<int>::max())) {
+          return false;
+        }
+        tokens->push_back({ int(terminal) + unknown_terminal_id, i_end + gap, length });
+        i_end += gap + length;
+      }
+    }
+    return true;
+  }
+
+  // the regular files under a directory, or the paths listed one per line
+  // in a file list
+  inline std::vector<std::string> collect_batch_paths(const std::string& list_or_directory)
+  {
+    std::vector<std::string> paths;
+    std::error_code error;
+    if (std::filesystem::is_directory(list_or_directory, error)) {
+      for (auto&& entry: std::filesystem::recursive_directory_iterator(list_or_directory, error)) {
+        if (entry.is_regular_file(error)) {
+          paths.push_back(entry.path().string());
+        }
+      }
+      std::sort(paths.begin(), paths.end());
+    } else {
+      std::ifstream list_in_stream(list_or_directory);
+      for (std::string line; std::getline(list_in_stream, line); ) {
+        if (!line.empty() && line.back() == '\r') {
+          line.pop_back();
+        }
+        if (!line.empty()) {
+          paths.push_back(line);
+        }
+      }
+    }
+    return paths;
+  }
+
+  // "line:column" of offset in content, both from 1
+  inline std::string source_position(std::string_view content, std::size_t offset)
+  {
+    auto line_start = offset == 0 ? std::string_view::npos : content.rfind('\n', offset - 1);
+    auto line = std::count(content.begin(), content.begin() + offset, '\n') + 1;
+    auto column = line_start == std::string_view::npos ? offset + 1 : offset - line_start;
+    return std::to_string(line) + ":" + std::to_string(column);
+  }
+
+  // lexes and parses many files against one DFA and one analyser, loaded
+  // once, on a work-stealing pool; files are handed out largest first so
+  // the big ones do not end up in the tail. The calling thread reads the
+  // files in batches (io_uring where available) while the pool parses the
+  // ones already read. With a content cache, files whose contents were
+  // already processed with the same lexer and parser tables are only
+  // hashed, and those processed with other parser tables are parsed from
+  // their cached token streams. The files read but not yet parsed are held in memory up to a
+  // bound, past which reading waits for the pool. Analyser is an LL(1) or
+  // LR analyser with the push API
+  template <typename Analyser>
+  class batch_driver_t
+  {
+  public:
+    batch_driver_t(const lexical_automaton_t& dfa, const Analyser& analyser,
+        std::size_t num_threads = std::thread::hardware_concurrency(),
+        bool use_io_uring = true)
+    : m_analyser(analyser), m_reader(use_io_uring), m_pool(num_threads)
+    {
+      compiled_lexer_t lexer(dfa, [&analyser](const std::string& token_name) {
+        return analyser.terminal_id(token_name);
+      });
+      m_lexers.assign(m_pool.size(), lexer);
+      m_contexts.resize(m_pool.size());
+      m_tokens.resize(m_pool.size());
+      // the cache context: the lexer tables, terminal ids included, and the
+      // entry format. The analyser's fingerprint is kept in the entry, so
+      // a change to the grammar alone reparses the cached token streams
+      std::uint64_t context[] = { lexer.fingerprint(), cache_format_version };
+      m_context_hash = utils::hash::xxhash64(context, sizeof(context));
+      m_analyser_fingerprint = analyser.fingerprint();
+    }
+
+    // cache of per-file results consulted and filled by run(), evicted
+    // down to its size bound after every run; nullptr disables it
+    void set_cache(utils::io::content_cache_t* cache)
+    {
+      m_cache = cache;
+    }
+
+    // bytes of file contents read ahead of the pool, exceeded only by a
+    // single file larger than the bound
+    void set_max_queued_bytes(std::size_t max_queued_bytes)
+    {
+      m_max_queued_bytes = max_queued_bytes;
+    }
+
+    std::size_t num_threads() const
+    {
+      return m_pool.size();
+    }
+
+    std::size_t num_steals() const
+    {
+      return m_pool.num_steals();
+    }
+
+    const utils::io::batch_reader_t& reader() const
+    {
+      return m_reader;
+    }
+
+    // results in the order of paths
+    std::vector<batch_file_result_t> run(const std::vector<std::string>& paths)
+    {
+      UTILS_TRACE_SCOPE("batch/run");
+      std::vector<batch_file_result_t> results(paths.size());
+      std::vector<std::uintmax_t> sizes(paths.size());
+      for (std::size_t idx = 0; idx < paths.size(); ++idx) {
+        std::error_code error;
+        auto size = std::filesystem::file_size(paths[idx], error);
+        sizes[idx] = error ? 0 : size;
+      }
+      std::vector<std::size_t> order(paths.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(),
+          [&](std::size_t lhs, std::size_t rhs) { return sizes[lhs] > sizes[rhs]; });
+
+      std::vector<std::string> ordered_paths;
+      for (auto idx: order) {
+        ordered_paths.push_back(paths[idx]);
+      }
+      m_reader.read(ordered_paths, [&](std::size_t i_ordered, std::string_view content, int error) {
+        auto idx = order[i_ordered];
+        results[idx].path = paths[idx];
+        if (error != 0) {
+          results[idx].diagnostics.push_back(std::string("cannot read file: ") + std::strerror(error));
+          return;
+        }
+        {
+          std::unique_lock<std::mutex> lock(m_queued_mutex);
+          m_queued_cv.wait(lock, [&]() {
+            return m_queued_bytes == 0 || m_queued_bytes + content.size() <= m_max_queued_bytes;
+          });
+          m_queued_bytes += content.size();
+        }
+        m_pool.submit([this, &results, idx, input_content = std::string(content)](std::size_t worker) {
+          // gives the bytes back even if processing throws
+          struct queued_bytes_guard_t
+          {
+            batch_driver_t* driver;
+            std::size_t bytes;
+            ~queued_bytes_guard_t()
+            {
+              driver->release_queued_bytes(bytes);
+            }
+          } guard { this, input_content.size() };
+          process_file(input_content, worker, results[idx]);
+        });
+      });
+      m_pool.wait();
+      if (m_cache) {
+        m_cache->evict();
+      }
+      return results;
+    }
+
+  private:
+    void release_queued_bytes(std::size_t bytes)
+    {
+      {
+        std::lock_guard<std::mutex> lock(m_queued_mutex);
+        m_queued_bytes -= bytes;
+      }
+      m_queued_cv.notify_one();
+    }
+
+    void process_file(const std::string& input_content, std::size_t worker, batch_file_result_t& result)
+    {
+      UTILS_TRACE_SCOPE("batch/file");
+      auto time_start = std::chrono::steady_clock::now();
+      result.bytes = input_content.size();
+
+      auto& tokens = m_tokens[worker];
+      auto& context = m_contexts[worker];
+      std::uint64_t content_hash = 0;
+      if (m_cache) {
+        content_hash = utils::hash::xxhash64(input_content);
+        std::string payload;
+        std::uint64_t analyser_fingerprint;
+        if (m_cache->get(content_hash, m_context_hash, payload)
+            && decode_batch_result(payload, analyser_fingerprint, result) && result.bytes == input_content.size()) {
+          if (analyser_fingerprint == m_analyser_fingerprint) {
+            result.cached = true;
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+            return;
+          }
+          // same tokens, other parser tables: parse the cached token stream
+          // instead of lexing the file again
+          if (decode_batch_result(payload, analyser_fingerprint, result, &tokens)) {
+            result.accepted = false;
+            result.diagnostics.clear();
+            m_analyser.push_start(context);
+            for (auto&& token: tokens) {
+              push_token(context, token.terminal,
+                  std::string_view(input_content).substr(token.i_start, token.length), input_content, result);
+            }
+            finish_tokens(context, result);
+            result.replayed = true;
+            m_cache->put(content_hash, m_context_hash, encode_batch_result(m_analyser_fingerprint, result, tokens));
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+            return;
+          }
+        }
+        auto path = std::move(result.path);
+        result = batch_file_result_t();
+        result.path = std::move(path);
+        result.bytes = input_content.size();
+      }
+
+      auto& lexer = m_lexers[worker];
+      tokens.clear();
+      lexer.reset(input_content);
+      m_analyser.push_start(context);
+      for (int token = lexer.next_token(); token != end_of_input_id; token = lexer.next_token()) {
+        ++result.tokens;
+        auto lexeme = lexer.lexeme();
+        if (m_cache) {
+          tokens.push_back({ token, std::size_t(lexeme.data() - input_content.data()), lexeme.size() });
+        }
+        push_token(context, token, lexeme, input_content, result);
+      }
+      result.invalid_characters = lexer.num_invalid_characters();
+      finish_tokens(context, result);
+      if (m_cache) {
+        m_cache->put(content_hash, m_context_hash, encode_batch_result(m_analyser_fingerprint, result, tokens));
+      }
+      result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+    }
+
+    // lexeme is a view into input_content
+    void push_token(typename Analyser::parse_context_t& context, int token, std::string_view lexeme,
+        const std::string& input_content, batch_file_result_t& result)
+    {
+      if (!context.rejected && !m_analyser.push(context, token)) {
+        result.diagnostics.push_back("syntax error at "
+            + source_position(input_content, lexeme.data() - input_content.data())
+            + " near '" + std::string(lexeme) + "'");
+      }
+    }
+
+    void finish_tokens(typename Analyser::parse_context_t& context, batch_file_result_t& result)
+    {
+      if (!context.rejected) {
+        result.accepted = m_analyser.finish(context);
+        if (!result.accepted) {
+          result.diagnostics.push_back("syntax error at end of input");
+        }
+      }
+      if (result.invalid_characters > 0) {
+        result.diagnostics.push_back(std::to_string(result.invalid_characters) + " invalid characters");
+      }
+    }
+
+    const Analyser& m_analyser;
+    utils::io::batch_reader_t m_reader;
+    utils::concurrency::work_stealing_pool_t m_pool;
+    // one lexer cursor, parse context and token buffer per worker, all
+    // sharing the one analyser
+    std::vector<compiled_lexer_t> m_lexers;
+    std::vector<typename Analyser::parse_context_t> m_contexts;
+    std::vector<std::vector<cached_token_t>> m_tokens;
+
+    static constexpr std::uint64_t cache_format_version = 3;
+
+    utils::io::content_cache_t* m_cache = nullptr;
+    std::uint64_t m_context_hash = 0;
+    std::uint64_t m_analyser_fingerprint = 0;
+
+    static constexpr std::size_t default_max_queued_bytes = std::size_t(256) << 20;
+    std::mutex m_queued_mutex;
+    std::condition_variable m_queued_cv;
+    std::size_t m_queued_bytes = 0;
+    std::size_t m_max_queued_bytes = default_max_queued_bytes;
+  };
+
+  inline std::string json_escape(const std::string& text)
+  {
+    std::string escaped;
+    for (char ch: text) {
+      if (ch == '"' || ch == '\\') {
+        escaped += '\\';
+        escaped += ch;
+      } else if ((unsigned char)ch < 0x20) {
+        static const char* hex = "0123456789abcdef";
+        escaped += "\\u00";
+        escaped += hex[(unsigned char)ch >> 4];
+        escaped += hex[ch & 0xf];
+      } else {
+        escaped += ch;
+      }
+    }
+    return escaped;
+  }
+
+  // aggregated JSON report, totals first then one object per file
+  inline void write_batch_report(std::ostream& out_stream,
+      const std::vector<batch_file_result_t>& results, double seconds)
+  {
+    std::size_t bytes = 0, tokens = 0, accepted = 0, invalid_characters = 0, cached = 0, replayed = 0;
+    for (auto&& result: results) {
+      cached += result.cached;
+      replayed += result.replayed;
+      bytes += result.bytes;
+      tokens += result.tokens;
+      accepted += result.accepted;
+      invalid_characters += result.invalid_characters;
+    }
+    out_stream << "{\n  \"files\": " << results.size()
+               << ",\n  \"accepted\": " << accepted
+               << ",\n  \"rejected\": " << results.size() - accepted
+               << ",\n  \"bytes\": " << bytes
+               << ",\n  \"tokens\": " << tokens
+               << ",\n  \"invalid_characters\": " << invalid_characters
+               << ",\n  \"cached\": " << cached
+               << ",\n  \"replayed\": " << replayed
+               << ",\n  \"seconds\": " << seconds
+               << ",\n  \"results\": [";
+    for (std::size_t idx = 0; idx < results.size(); ++idx) {
+      auto& result = results[idx];
+      out_stream << (idx ? ",\n" : "\n")
+                 << "    {\"path\": \"" << json_escape(result.path)
+                 << "\", \"bytes\": " << result.bytes
+                 << ", \"tokens\": " << result.tokens
+                 << ", \"accepted\": " << (result.accepted ? "true" : "false")
+                 << ", \"cached\": " << (result.cached ? "true" : "false")
+                 << ", \"replayed\": " << (result.replayed ? "true" : "false")
+                 << ", \"seconds\": " << result.seconds
+                 << ", \"diagnostics\": [";
+      for (std::size_t i_diagnostic = 0; i_diagnostic < result.diagnostics.size(); ++i_diagnostic) {
+        out_stream << (i_diagnostic ? ", " : "") << "\"" << json_escape(result.diagnostics[i_diagnostic]) << "\"";
+      }
+      out_stream << "]}";
+    }
+    out_stream << "\n  ]\n}\n";
+  }
+
+} // namespace compiler
+
+#endif // COMPILER_BATCH_DRIVER_HPP
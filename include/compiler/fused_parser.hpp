@@ -0,0 +1,198 @@
+#ifndef COMPILER_FUSED_PARSER_HPP
+#define COMPILER_FUSED_PARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <utils/hash/xxhash64.hpp>
+#include <utils/profile/trace.hpp>
+#include <compiler/lexical_analysis.hpp>
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+  // pull scanner over a lexical DFA compiled into a dense next-state table,
+  // each state's token already resolved to the terminal id of one parser.
+  // next_token() returns that id, end_of_input_id at the end of input or
+  // unknown_terminal_id for a token the parser has no terminal for; blanks,
+  // comments and invalid characters are skipped like scan() does
+  class compiled_lexer_t
+  {
+  public:
+    // terminal_id(token_name) maps a DFA token name to the parser's id
+    template <typename TerminalId>
+    compiled_lexer_t(const lexical_automaton_t& dfa, TerminalId&& terminal_id)
+    {
+      // state 0 is dead, the start state is 1
+      std::unordered_map<const lexical_state_t*, std::uint32_t> state_ids;
+      std::vector<typename lexical_automaton_t::vertex_property_pointer_t> states;
+      std::queue<std::uint32_t> queue;
+      auto add_state = [&](const typename lexical_automaton_t::vertex_property_pointer_t& state) {
+        auto [it, inserted] = state_ids.emplace(state.get(), std::uint32_t(states.size() + 1));
+        if (inserted) {
+          states.push_back(state);
+          queue.push(it->second);
+        }
+        return it->second;
+      };
+      add_state(dfa.start_state());
+
+      m_next.assign(2 * 256, 0);
+      while (!queue.empty()) {
+        auto state_id = queue.front();
+        queue.pop();
+        for (int byte = 0; byte < 256; ++byte) {
+          auto next_state = dfa.transit(states[state_id - 1], char(byte));
+          if (next_state) {
+            auto next_id = add_state(next_state);
+            if (m_next.size() < (next_id + 1) * 256) {
+              m_next.resize((next_id + 1) * 256, 0);
+            }
+            m_next[state_id * 256 + byte] = next_id;
+          }
+        }
+      }
+
+      m_tokens.assign(states.size() + 1, not_final);
+      for (std::size_t idx = 0; idx < states.size(); ++idx) {
+        auto& state = *states[idx];
+        if (!state.is_finalize()) {
+          continue;
+        }
+        if (state.m_token_name == "blank" || state.m_token_name == "comment") {
+          m_tokens[idx + 1] = skipped;
+        } else {
+          m_tokens[idx + 1] = terminal_id(state.m_token_name);
+        }
+      }
+    }
+
+    void reset(std::string_view input)
+    {
+      m_input = input;
+      m_position = 0;
+      m_lexeme = std::string_view();
+      m_num_invalid = 0;
+    }
+
+    int next_token()
+    {
+      // the loop only touches locals, so the state stays in a register
+      const std::uint32_t* next = m_next.data();
+      const int* tokens = m_tokens.data();
+      const char* input = m_input.data();
+      const std::size_t length = m_input.size();
+      std::size_t position = m_position;
+      while (position < length) {
+        std::uint32_t state = 1;
+        std::size_t i_end = position;
+        int token = not_final;
+        for (std::size_t idx = position; idx < length; ) {
+          state = next[state * 256 + (unsigned char)input[idx]];
+          if (state == 0) {
+            break;
+          }
+          ++idx;
+          if (tokens[state] != not_final) {
+            token = tokens[state];
+            i_end = idx;
+          }
+        }
+        if (i_end == position) {
+          // invalid character
+          ++m_num_invalid;
+          ++position;
+          continue;
+        }
+        std::size_t i_start = position;
+        position = i_end;
+        if (token != skipped) {
+          m_position = position;
+          m_lexeme = std::string_view(input + i_start, i_end - i_start);
+          return token;
+        }
+      }
+      m_position = position;
+      return end_of_input_id;
+    }
+
+    // text of the token last returned by next_token()
+    std::string_view lexeme() const
+    {
+      return m_lexeme;
+    }
+
+    // characters skipped since reset() because no token starts with them
+    std::size_t num_invalid_characters() const
+    {
+      return m_num_invalid;
+    }
+
+    std::size_t num_states() const
+    {
+      return m_tokens.size() - 1;
+    }
+
+    // hash of the compiled tables, the parser's token ids included
+    std::uint64_t fingerprint() const
+    {
+      return utils::hash::xxhash64(m_tokens, utils::hash::xxhash64(m_next));
+    }
+
+  private:
+    static constexpr int not_final = -3;
+    static constexpr int skipped = -4;
+
+    std::vector<std::uint32_t> m_next;
+    std::vector<int> m_tokens;
+
+    std::string_view m_input;
+    std::size_t m_position = 0;
+    std::string_view m_lexeme;
+    std::size_t m_num_invalid = 0;
+  };
+
+  // fuses a pull lexer and a parser so the parser drives the scan, no
+  // token is stored: Lexer is constructed from (dfa, terminal_id) and
+  // provides reset(input) and int next_token(), Parser provides
+  // int terminal_id(token_name) and bool recognize_pull(next_token).
+  // Both are template parameters so the compiler can inline across the
+  // boundary. The parser must outlive the fused parser
+  template <typename Lexer, typename Parser>
+  class fused_parser_t
+  {
+  public:
+    fused_parser_t(const lexical_automaton_t& dfa, const Parser& parser)
+    : m_lexer(dfa, [&parser](const std::string& token_name) { return parser.terminal_id(token_name); }),
+      m_parser(parser)
+    { }
+
+    // whether input is accepted, not thread-safe as the lexer is reused
+    bool recognize(std::string_view input)
+    {
+      UTILS_TRACE_SCOPE("fused/recognize");
+      m_lexer.reset(input);
+      return m_parser.recognize_pull([this]() { return m_lexer.next_token(); });
+    }
+
+    Lexer& lexer()
+    {
+      return m_lexer;
+    }
+
+  private:
+    Lexer m_lexer;
+    const Parser& m_parser;
+  };
+
+  template <typename Parser>
+  using fused_dfa_parser_t = fused_parser_t<compiled_lexer_t, Parser>;
+
+} // namespace compiler
+
+#endif // COMPILER_FUSED_PARSER_HPP
@@ -0,0 +1,333 @@
+#ifndef COMPILER_LEXICAL_ANALYSIS_HPP
+#define COMPILER_LEXICAL_ANALYSIS_HPP
+
+#include <bitset>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <stack>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <utils/automaton/automaton.hpp>
+#include <utils/io/smart_ifstream.hpp>
+#include <utils/profile/counters.hpp>
+#include <utils/profile/trace.hpp>
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+  struct lexical_state_t
+  {
+    std::size_t m_idx;
+    bool m_is_finalize;
+    std::string m_token_name;
+
+    lexical_state_t(std::size_t idx)
+    : m_idx(idx), m_is_finalize(false)
+    { }
+
+    void set_finalize(const std::string& token_name)
+    {
+      m_is_finalize = true;
+      m_token_name = token_name;
+    }
+
+    bool is_finalize() const
+    {
+      return m_is_finalize;
+    }
+  };
+
+  inline char translate_escape_character(char escape_character)
+  {
+    static const std::unordered_map<char, char> translation_map = {
+      { 'b', ' ' }, { 't','\t' }, { 'n','\n' }, { '[', '[' }, { ']', ']' }, 
+      { '.', '.' }, {'\\','\\' },
+    };
+    auto it = translation_map.find(escape_character);
+    if (it != translation_map.end()) {
+      return it->second;
+    } else {
+      return '\0';
+    }
+  }
+
+  inline std::bitset<256> character_set_all()
+  {
+    std::bitset<256> character_set = 0;
+    character_set.set();
+    return character_set;
+  }
+
+  inline std::bitset<256> parse_character_set_without_reverse(const std::string& pattern)
+  {
+    std::bitset<256> character_set = 0;
+    for (std::size_t idx = 0, length = pattern.length(); idx < length; ++idx) {
+      if (pattern[idx] == '\\') {
+        character_set.set(translate_escape_character(pattern[idx + 1]));
+        ++idx;
+      } else if (isdigit(pattern[idx]) && pattern[idx + 1] == '-' && idx + 2 < length && isdigit(pattern[idx + 2])) {
+        for (auto ch = pattern[idx]; ch <= pattern[idx + 2]; ++ch) {
+          character_set.set(ch);
+        }
+        idx += 2;
+      } else if (isalpha(pattern[idx]) && pattern[idx + 1] == '-' && idx + 2 < length && isalpha(pattern[idx + 2])) {
+        for (auto ch = pattern[idx]; ch <= pattern[idx + 2]; ++ch) {
+          character_set.set(ch);
+        }
+        idx += 2;
+      } else {
+        character_set.set(pattern[idx]);
+      }
+    }
+    return character_set;
+  }
+
+  inline std::bitset<256> parse_character_set(const std::string& pattern)
+  {
+    std::bitset<256> character_set = 0;
+    if (pattern[0] == '^') {
+      if (pattern.length() > 1) {
+        character_set = ~parse_character_set_without_reverse(pattern.substr(1));
+      }
+    } else {
+      character_set = parse_character_set_without_reverse(pattern);
+    }
+    return character_set;
+  }
+
+  struct lexical_transition_t : utils::automaton::character_set_transition_t
+  {
+    lexical_transition_t(const std::string& parameter)
+    {
+      if (parameter == "epsilon") {
+        // epsilon transition
+        m_is_epsilon = true;
+      } else if (parameter.length() == 1) {
+        // single character
+        if (parameter[0] == '.') {
+          m_character_set = character_set_all();
+        } else {
+          m_character_set.set(parameter[0]);
+        }
+      } else if (parameter.length() == 2 && parameter[0] == '\\') {
+        // escape character
+        m_character_set.set(translate_escape_character(parameter[1]));
+      } else if (parameter[0] == '[' && parameter.back() == ']') {
+        // character range
+        m_character_set = parse_character_set(parameter.substr(1, parameter.length() - 2));
+      }
+    }
+  };
+
+  using lexical_automaton_t = utils::automaton::automaton_t<lexical_state_t, lexical_transition_t>;
+
+  // reads a lexical DFA in the dfa_define.txt / lexical_default.txt format,
+  // the automaton's tables allocate from resource
+  inline std::shared_ptr<lexical_automaton_t> load_lexical_automaton(
+      utils::io::smart_ifstream& dfa_in_stream,
+      std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+  {
+    UTILS_TRACE_SCOPE("lexer/load_dfa");
+    std::vector<typename lexical_automaton_t::vertex_property_pointer_t> states;
+    states.push_back(std::make_shared<lexical_state_t>(0));
+
+    std::size_t num_states, num_finalize_states;
+    dfa_in_stream >> num_states >> num_finalize_states;
+
+    auto dfa = std::make_shared<lexical_automaton_t>(states[0], resource);
+
+    for (std::size_t idx = 1; idx < num_states; ++idx) {
+      auto state = std::make_shared<lexical_state_t>(idx);
+      states.push_back(state);
+      dfa->add_vertex(state);
+    }
+
+    while (num_finalize_states--) {
+      std::size_t idx_state;
+      std::string token_name;
+      dfa_in_stream >> idx_state >> token_name;
+
+      states[idx_state]->set_finalize(token_name);
+    }
+
+    {
+      std::size_t idx_state_in, idx_state_out;
+      std::string parameter;
+      while (dfa_in_stream >> idx_state_in >> idx_state_out >> parameter) {
+        auto transition = std::make_shared<lexical_transition_t>(parameter);
+        dfa->add_edge(states[idx_state_in], states[idx_state_out], transition);
+      }
+    }
+    return dfa;
+  }
+
+  inline std::string smart_character_output(char c)
+  {
+    if (c == ' ') {
+      return "\\b";
+    } else if (c == '\t') {
+      return "\\t";
+    } else if (c == '\n') {
+      return "\\n";
+    } else {
+      return std::string { c };
+    }
+  }
+
+  inline void smart_token_output(
+      const std::string& token_id, 
+      const std::string& accepted_string, 
+      std::ostream& out_stream)
+  {
+    out_stream << "< " << token_id << " ,\t";
+    for (auto& ch: accepted_string) {
+      out_stream << smart_character_output(ch);
+    }
+    out_stream << " >\n";
+  }
+
+  // DFA states entered and transitions taken (state index * 256 + byte) by
+  // every scan, counted only with UTILS_PROFILE_ENABLE_COUNTERS and not
+  // thread-safe
+  inline utils::profile::counter_table_t& lexer_state_counters()
+  {
+    static utils::profile::counter_table_t counters;
+    return counters;
+  }
+
+  inline utils::profile::counter_table_t& lexer_transition_counters()
+  {
+    static utils::profile::counter_table_t counters;
+    return counters;
+  }
+
+  inline void report_lexer_counters(
+      const lexical_automaton_t& dfa, std::ostream& out_stream, std::size_t max_rows = 20)
+  {
+    std::vector<std::string> token_names(dfa.num_vertices());
+    for (auto&& state: dfa.vertices()) {
+      if (state->m_idx < token_names.size() && state->is_finalize()) {
+        token_names[state->m_idx] = " (" + state->m_token_name + ")";
+      }
+    }
+    auto state_name = [&](std::size_t idx) {
+      return "state " + std::to_string(idx) + (idx < token_names.size() ? token_names[idx] : "");
+    };
+    lexer_state_counters().report(out_stream, "DFA states", state_name, max_rows);
+    lexer_transition_counters().report(out_stream, "DFA transitions",
+        [&](std::size_t id) {
+          return state_name(id / 256) + " --" + smart_character_output(char(id % 256)) + "-->";
+        }, max_rows);
+  }
+
+  // calls token_handler, false if it asks to stop
+  template <typename TokenHandler>
+  bool call_token_handler(TokenHandler& token_handler,
+      const std::string& token_name, std::size_t i_start, std::size_t length)
+  {
+    if constexpr (std::is_same_v<decltype(token_handler(token_name, i_start, length)), bool>) {
+      return token_handler(token_name, i_start, length);
+    } else {
+      token_handler(token_name, i_start, length);
+      return true;
+    }
+  }
+
+  // longest-match scan of input_content, calling
+  // token_handler(token_name, i_start, length) for every token except
+  // blanks; characters no token starts with are reported as "invalid".
+  // A handler returning bool stops the scan by returning false
+  template <typename TokenHandler>
+  void scan_tokens(
+      const lexical_automaton_t& dfa, 
+      const std::string& input_content,
+      TokenHandler&& token_handler)
+  {
+    UTILS_TRACE_SCOPE("lexer/scan");
+    static const std::string invalid_token_name = "invalid";
+    for (std::size_t i_start = 0, i_offset;
+        i_start < input_content.length();
+        i_start += i_offset)
+    {
+      std::stack<typename lexical_automaton_t::vertex_property_pointer_t> stack;
+      stack.push(dfa.start_state());
+      UTILS_PROFILE_COUNT(lexer_state_counters(), stack.top()->m_idx);
+      i_offset = 1;
+      while (i_start + i_offset <= input_content.length() && !stack.empty()) {
+        auto next_state = dfa.transit(
+            stack.top(), input_content[i_start + i_offset - 1]);
+        if (next_state) {
+          UTILS_PROFILE_COUNT(lexer_transition_counters(),
+              stack.top()->m_idx * 256 + (unsigned char)input_content[i_start + i_offset - 1]);
+          UTILS_PROFILE_COUNT(lexer_state_counters(), next_state->m_idx);
+          stack.push(next_state);
+          i_offset += 1;
+        } else {
+          i_offset -= 1;
+          break;
+        }
+      }
+      while (i_offset > 0 && !stack.top()->is_finalize()) {
+        i_offset -= 1;
+        stack.pop();
+      }
+      if (i_offset == 0) {
+        if (!call_token_handler(token_handler, invalid_token_name, i_start, 1)) {
+          return;
+        }
+        i_start += 1;
+      } else {
+        auto& stopped_state = stack.top();
+        if (stopped_state->m_token_name != "blank") {
+          if (!call_token_handler(token_handler, stopped_state->m_token_name, i_start, i_offset)) {
+            return;
+          }
+        }
+      }
+    }
+  }
+
+  // scans input_content, writing every token to out_stream and returning
+  // the terminate symbols handed to the syntax analysers (no comments)
+  inline std::vector<symbol_t> scan(
+      std::shared_ptr<lexical_automaton_t> dfa, 
+      const std::string& input_content,
+      std::ostream& out_stream)
+  {
+    std::vector<symbol_t> terminate_symbols;
+    scan_tokens(*dfa, input_content,
+        [&](const std::string& token_name, std::size_t i_start, std::size_t length) {
+          auto accepted_string = input_content.substr(i_start, length);
+          smart_token_output(token_name, accepted_string, out_stream);
+          if (token_name != "invalid" && token_name != "comment") {
+            terminate_symbols.emplace_back(token_name, accepted_string);
+          }
+        });
+    return terminate_symbols;
+  }
+
+  inline std::vector<symbol_t> lexical_analysis(
+      utils::io::smart_ifstream& dfa_in_stream,
+      std::ifstream& code_in_stream,
+      std::ostream& out_stream)
+  {
+    // construct automaton
+    auto dfa = load_lexical_automaton(dfa_in_stream);
+
+    // scan
+    std::string input_content {
+        std::istreambuf_iterator<char>(code_in_stream), 
+        std::istreambuf_iterator<char>() 
+    };
+    return scan(dfa, input_content, out_stream);
+  }
+
+} // namespace compiler
+
+#endif // COMPILER_LEXICAL_ANALYSIS_HPP
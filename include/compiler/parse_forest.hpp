@@ -0,0 +1,112 @@
+#ifndef COMPILER_PARSE_FOREST_HPP
+#define COMPILER_PARSE_FOREST_HPP
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace compiler
+{
+// shared packed parse forest: one node per symbol and input span, with
+// one family of children per way the span derives from the symbol, so
+// that every parse of an ambiguous input is kept in space polynomial in
+// its length. Spans are token positions, [begin, end)
+struct parse_forest_t
+{
+  struct node_t
+  {
+    int symbol;
+    int begin;
+    int end;
+    // families of a nonterminal, -1 for terminals and until added
+    int first_family;
+  };
+
+  struct family_t
+  {
+    int rule_id;
+    int first_child;
+    int num_children;
+    int next_family;
+  };
+
+  std::vector<node_t> nodes;
+  std::vector<family_t> families;
+  std::vector<int> children;
+  int root = -1;
+
+  void clear()
+  {
+    nodes.clear();
+    families.clear();
+    children.clear();
+    root = -1;
+  }
+
+  int add_node(int symbol, int begin, int end)
+  {
+    nodes.push_back(node_t { symbol, begin, end, -1 });
+    return nodes.size() - 1;
+  }
+
+  // adds the family unless node has it already
+  void add_family(int node, int rule_id, const int *child, int num_children)
+  {
+    for (int family = nodes[node].first_family; family >= 0; family = families[family].next_family)
+    {
+      auto &exist = families[family];
+      if (exist.rule_id == rule_id && exist.num_children == num_children
+          && std::equal(child, child + num_children, children.begin() + exist.first_child))
+        return;
+    }
+    families.push_back(family_t { rule_id, (int)children.size(), num_children, nodes[node].first_family });
+    children.insert(children.end(), child, child + num_children);
+    nodes[node].first_family = families.size() - 1;
+  }
+
+  // nodes with more than one family, where the input is ambiguous
+  std::size_t num_ambiguous() const
+  {
+    return std::count_if(nodes.begin(), nodes.end(), [&](const node_t &node) {
+      return node.first_family >= 0 && families[node.first_family].next_family >= 0;
+    });
+  }
+
+  // prints the forest from root as nested "SYMBOL(...)", the families of
+  // an ambiguous node as "{...|...}"; symbol_name(id) names the symbols
+  template <typename SymbolName>
+  void print(std::ostream &out_stream, SymbolName &&symbol_name) const
+  {
+    if (root >= 0)
+      _print(out_stream, symbol_name, root);
+    out_stream << "\n";
+  }
+
+private:
+  template <typename SymbolName>
+  void _print(std::ostream &out_stream, SymbolName &symbol_name, int node) const
+  {
+    out_stream << symbol_name(nodes[node].symbol);
+    int first_family = nodes[node].first_family;
+    if (first_family < 0)
+      return;
+    bool ambiguous = families[first_family].next_family >= 0;
+    out_stream << (ambiguous ? "{" : "(");
+    for (int family = first_family; family >= 0; family = families[family].next_family)
+    {
+      if (family != first_family)
+        out_stream << "|";
+      auto &alternative = families[family];
+      for (int idx = 0; idx < alternative.num_children; ++idx)
+      {
+        if (idx)
+          out_stream << " ";
+        _print(out_stream, symbol_name, children[alternative.first_child + idx]);
+      }
+    }
+    out_stream << (ambiguous ? "}" : ")");
+  }
+};
+} // namespace compiler
+
+#endif // COMPILER_PARSE_FOREST_HPP
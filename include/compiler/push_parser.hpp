@@ -0,0 +1,79 @@
+#ifndef COMPILER_PUSH_PARSER_HPP
+#define COMPILER_PUSH_PARSER_HPP
+
+#include <iterator>
+#include <utility>
+
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+  // incremental parse on top of an LL(1) or LR analyser: tokens are fed in
+  // batches as they arrive and only the parse stack is kept between them.
+  // The state can be taken out with release() and resumed by constructing
+  // another push parser from it; the analyser must outlive the parser
+  template <typename Analyser>
+  class push_parser_t
+  {
+  public:
+    using state_t = typename Analyser::push_state_t;
+
+    explicit push_parser_t(const Analyser& analyser)
+    : m_analyser(analyser), m_state(analyser.push_start())
+    { }
+
+    push_parser_t(const Analyser& analyser, state_t state)
+    : m_analyser(analyser), m_state(std::move(state))
+    { }
+
+    // consumes the symbols [it_begin, it_end), false once the input is
+    // rejected
+    template <typename ForwardIterator>
+    bool feed(const ForwardIterator& it_begin, const ForwardIterator& it_end)
+    {
+      return m_analyser.feed(m_state, it_begin, it_end);
+    }
+
+    template <typename TokenSpan>
+    bool feed(const TokenSpan& tokens)
+    {
+      return feed(std::begin(tokens), std::end(tokens));
+    }
+
+    // consumes one token given by its terminal id, see terminal_id()
+    bool push(int terminal_id)
+    {
+      return m_analyser.push(m_state, terminal_id);
+    }
+
+    // ends the input, returns whether it is accepted
+    bool finish()
+    {
+      return m_analyser.finish(m_state);
+    }
+
+    bool rejected() const
+    {
+      return m_state.rejected;
+    }
+
+    const state_t& state() const
+    {
+      return m_state;
+    }
+
+    state_t release()
+    {
+      state_t state = std::move(m_state);
+      m_state = m_analyser.push_start();
+      return state;
+    }
+
+  private:
+    const Analyser& m_analyser;
+    state_t m_state;
+  };
+
+} // namespace compiler
+
+#endif // COMPILER_PUSH_PARSER_HPP
@@ -0,0 +1,375 @@
+#ifndef COMPILER_SOURCE_GENERATOR_HPP
+#define COMPILER_SOURCE_GENERATOR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <queue>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <compiler/lexical_analysis.hpp>
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+  // random valid programs for a grammar, by weighted random derivation
+  // from start_symbol; terminals are spelled with lexemes that the lexical
+  // DFA scans back into exactly that terminal
+  class source_generator_t
+  {
+  public:
+    source_generator_t(
+        syntax_t syntax, const symbol_t &start_symbol,
+        const lexical_automaton_t &dfa, std::uint64_t seed = 0)
+    : _random(seed)
+    {
+      _build_rules(syntax, start_symbol);
+      _build_lexemes(dfa);
+      _build_min_lengths();
+    }
+
+    // relative probability of choosing rule among the rules of its symbol
+    // while the token budget and depth allow a free choice, 1 by default
+    void set_weight(const production_rule_t &rule, double weight)
+    {
+      for (auto &&candidate : _rules)
+      {
+        if (std::equal_to<production_rule_t>()(candidate.rule, rule))
+        {
+          candidate.weight = weight;
+        }
+      }
+    }
+
+    // terminals of the grammar the DFA cannot spell, rules deriving them
+    // are never chosen
+    std::vector<std::string> unspellable_terminals() const
+    {
+      std::vector<std::string> terminals;
+      for (std::size_t symbol = 0; symbol < _symbols.size(); ++symbol)
+      {
+        if (_symbols[symbol].is_terminate && _lexemes[symbol].empty())
+        {
+          terminals.push_back(_symbols[symbol].symbol_id);
+        }
+      }
+      return terminals;
+    }
+
+    // writes one program of about num_tokens tokens to out_stream and
+    // returns the number of tokens written; beyond max_depth nested
+    // (non-tail) derivations, and once the budget is used up, only the
+    // shortest rules are chosen
+    std::size_t generate(std::ostream &out_stream, std::size_t num_tokens, std::size_t max_depth = 32)
+    {
+      if (_min_length[_start_symbol] == infinity)
+      {
+        return 0;
+      }
+
+      struct frame_t
+      {
+        int symbol;
+        std::size_t depth;
+      };
+      std::vector<frame_t> frames { { _start_symbol, 0 } };
+      std::size_t emitted = 0, pending = _min_length[_start_symbol];
+      std::size_t line_length = 0;
+      std::vector<double> weights;
+      std::vector<int> candidates;
+
+      while (!frames.empty())
+      {
+        auto [symbol, depth] = frames.back();
+        frames.pop_back();
+        pending -= _min_length[symbol];
+
+        if (_symbols[symbol].is_terminate)
+        {
+          auto &lexemes = _lexemes[symbol];
+          auto &lexeme = lexemes[std::uniform_int_distribution<std::size_t>(0, lexemes.size() - 1)(_random)];
+          out_stream << lexeme;
+          line_length += lexeme.length() + 1;
+          if (_is_line_end[symbol] || line_length > 80)
+          {
+            out_stream << "\n";
+            line_length = 0;
+          }
+          else
+          {
+            out_stream << " ";
+          }
+          ++emitted;
+          continue;
+        }
+
+        // choose a rule of symbol
+        auto &rule_ids = _rules_of_symbol[symbol];
+        candidates.clear();
+        weights.clear();
+        bool exhausted = emitted + pending + _min_length[symbol] >= num_tokens;
+        for (auto rule_id : rule_ids)
+        {
+          auto &rule = _rules[rule_id];
+          if (rule.min_length == infinity)
+          {
+            continue;
+          }
+          if (exhausted || depth >= max_depth)
+          {
+            // shortest rules only, which always terminate
+            if (rule.min_length != _min_length[symbol])
+            {
+              continue;
+            }
+          }
+          else if (depth == 0 && rule.min_length == _min_length[symbol] && _has_longer_rule[symbol])
+          {
+            // the outermost (tail) derivation keeps growing until the budget
+            // is used up, so programs reach the requested size
+            continue;
+          }
+          candidates.push_back(rule_id);
+          weights.push_back(rule.weight);
+        }
+        int rule_id = candidates.size() == 1
+            ? candidates[0]
+            : candidates[std::discrete_distribution<std::size_t>(weights.begin(), weights.end())(_random)];
+
+        auto &rule_symbols = _rules[rule_id].symbols;
+        for (std::size_t idx = rule_symbols.size(); idx-- > 0;)
+        {
+          // the last symbol is a tail derivation and does not nest
+          frames.push_back({ rule_symbols[idx], idx + 1 == rule_symbols.size() ? depth : depth + 1 });
+          pending += _min_length[rule_symbols[idx]];
+        }
+      }
+      out_stream << "\n";
+      return emitted;
+    }
+
+    std::string generate(std::size_t num_tokens, std::size_t max_depth = 32)
+    {
+      std::ostringstream out_stream;
+      generate(out_stream, num_tokens, max_depth);
+      return out_stream.str();
+    }
+
+  private:
+    static constexpr std::size_t infinity = std::numeric_limits<std::size_t>::max() / 4;
+
+    struct rule_t
+    {
+      production_rule_t rule;
+      int symbol;
+      std::vector<int> symbols;
+      double weight;
+      std::size_t min_length;
+    };
+
+    int _add_symbol(const symbol_t &symbol)
+    {
+      auto &&[it, inserted] = _symbol_ids.emplace(symbol.symbol_id, _symbols.size());
+      if (inserted)
+      {
+        _symbols.push_back(symbol);
+        _rules_of_symbol.emplace_back();
+      }
+      return it->second;
+    }
+
+    void _build_rules(syntax_t &syntax, const symbol_t &start_symbol)
+    {
+      _start_symbol = _add_symbol(start_symbol);
+      for (auto &&symbol : syntax.non_terminate_symbols())
+      {
+        _add_symbol(symbol);
+      }
+      for (auto &&symbol : syntax.non_terminate_symbols())
+      {
+        for (auto &&rule : syntax.rules(symbol))
+        {
+          rule_t generated_rule { rule, _add_symbol(symbol), {}, 1.0, infinity };
+          if (!rule.is_epsilon())
+          {
+            for (auto &&rule_symbol : rule.rule_symbols)
+            {
+              generated_rule.symbols.push_back(_add_symbol(rule_symbol));
+            }
+          }
+          _rules_of_symbol[generated_rule.symbol].push_back(_rules.size());
+          _rules.push_back(std::move(generated_rule));
+        }
+      }
+    }
+
+    // shortest token count derivable from every symbol and rule, infinity
+    // for whatever needs an unspellable terminal
+    void _build_min_lengths()
+    {
+      _min_length.assign(_symbols.size(), infinity);
+      for (std::size_t symbol = 0; symbol < _symbols.size(); ++symbol)
+      {
+        if (_symbols[symbol].is_terminate && !_lexemes[symbol].empty())
+        {
+          _min_length[symbol] = 1;
+        }
+      }
+      for (bool flag_changed = true; flag_changed;)
+      {
+        flag_changed = false;
+        for (auto &&rule : _rules)
+        {
+          std::size_t length = 0;
+          for (auto symbol : rule.symbols)
+          {
+            length = std::min(infinity, length + _min_length[symbol]);
+          }
+          rule.min_length = length;
+          if (length < _min_length[rule.symbol])
+          {
+            _min_length[rule.symbol] = length;
+            flag_changed = true;
+          }
+        }
+      }
+      _has_longer_rule.assign(_symbols.size(), false);
+      for (auto &&rule : _rules)
+      {
+        if (rule.min_length != infinity && rule.min_length > _min_length[rule.symbol])
+        {
+          _has_longer_rule[rule.symbol] = true;
+        }
+      }
+    }
+
+    // the token name lexeme scans into when followed by a blank, or an
+    // empty string if it does not scan into exactly one token
+    static std::string _scanned_token(const lexical_automaton_t &dfa, const std::string &lexeme)
+    {
+      std::string token_name;
+      std::size_t num_tokens = 0, length = 0;
+      scan_tokens(dfa, lexeme + " ",
+          [&](const std::string &scanned_token_name, std::size_t, std::size_t scanned_length) {
+            token_name = scanned_token_name;
+            length = scanned_length;
+            ++num_tokens;
+          });
+      return (num_tokens == 1 && length == lexeme.length()) ? token_name : "";
+    }
+
+    // lexemes of every terminal: the content of quoted terminals, and for
+    // the others the shortest string reaching each of their DFA states plus
+    // prefixes of random walks through the DFA
+    void _build_lexemes(const lexical_automaton_t &dfa)
+    {
+      const std::size_t max_lexemes = 16;
+      _lexemes.assign(_symbols.size(), {});
+      _is_line_end.assign(_symbols.size(), false);
+      auto add_lexeme = [&](const std::string &lexeme) {
+        auto it = _symbol_ids.find(_scanned_token(dfa, lexeme));
+        if (it == _symbol_ids.end() || !_symbols[it->second].is_terminate)
+        {
+          return;
+        }
+        auto &lexemes = _lexemes[it->second];
+        if (lexemes.size() < max_lexemes && std::find(lexemes.begin(), lexemes.end(), lexeme) == lexemes.end())
+        {
+          lexemes.push_back(lexeme);
+        }
+      };
+
+      for (std::size_t symbol = 0; symbol < _symbols.size(); ++symbol)
+      {
+        auto &terminal = _symbols[symbol];
+        if (terminal.is_terminate && terminal.symbol_id[0] == '"')
+        {
+          add_lexeme(terminal.content);
+          _is_line_end[symbol] = terminal.content == ";" || terminal.content == "{" || terminal.content == "}";
+        }
+      }
+
+      using state_pointer_t = lexical_automaton_t::vertex_property_pointer_t;
+      auto next_characters = [&](const state_pointer_t &state) {
+        std::vector<std::pair<char, state_pointer_t>> next;
+        for (int ch = 32; ch < 127; ++ch)
+        {
+          if (auto next_state = dfa.transit(state, char(ch)))
+          {
+            next.emplace_back(char(ch), next_state);
+          }
+        }
+        return next;
+      };
+
+      // breadth-first shortest strings
+      std::unordered_map<const lexical_state_t *, std::string> shortest { { dfa.start_state().get(), "" } };
+      std::queue<state_pointer_t> states;
+      states.push(dfa.start_state());
+      while (!states.empty())
+      {
+        auto state = states.front();
+        states.pop();
+        for (auto &&[ch, next_state] : next_characters(state))
+        {
+          if (shortest.count(next_state.get()) == 0)
+          {
+            shortest[next_state.get()] = shortest[state.get()] + ch;
+            if (next_state->is_finalize())
+            {
+              add_lexeme(shortest[next_state.get()]);
+            }
+            states.push(next_state);
+          }
+        }
+      }
+
+      // random walks
+      for (int walk = 0; walk < 4096; ++walk)
+      {
+        auto state = dfa.start_state();
+        std::string lexeme;
+        for (int step = 0; step < 12; ++step)
+        {
+          auto next = next_characters(state);
+          if (next.empty())
+          {
+            break;
+          }
+          auto &&[ch, next_state] = next[std::uniform_int_distribution<std::size_t>(0, next.size() - 1)(_random)];
+          lexeme += ch;
+          state = next_state;
+          if (state->is_finalize())
+          {
+            add_lexeme(lexeme);
+          }
+        }
+      }
+    }
+
+  private:
+    std::mt19937_64 _random;
+
+    int _start_symbol;
+    std::vector<symbol_t> _symbols;
+    std::unordered_map<std::string, int> _symbol_ids;
+    std::vector<rule_t> _rules;
+    std::vector<std::vector<int>> _rules_of_symbol;
+
+    std::vector<std::size_t> _min_length;
+    std::vector<bool> _has_longer_rule;
+
+    std::vector<std::vector<std::string>> _lexemes;
+    std::vector<bool> _is_line_end;
+  };
+
+} // namespace compiler
+
+#endif // COMPILER_SOURCE_GENERATOR_HPP
@@ -2,6 +2,7 @@
 #define COMPILER_SYNTAX_HPP
 
 #include <iostream>
+#include <memory_resource>
 #include <string>
 #include <vector>
 #include <unordered_set>
@@ -31,6 +32,34 @@ namespace compiler
     bool is_epsilon() const;
   };
 
+  // an operator-expression nonterminal declared by a %operators block: its
+  // precedence levels from the loosest binding to the tightest, each of
+  // binary operators, left or right associative, or of prefix or postfix
+  // ones, over operands of the operand nonterminal. Level k is the
+  // nonterminal SYMBOL_k, so a rule can start an expression below level k
+  struct operator_table_t
+  {
+    enum kind_t { left, right, prefix, postfix };
+    // precedence climbing keeps levels in a byte
+    static constexpr std::size_t max_levels = 255;
+    struct level_t
+    {
+      kind_t kind;
+      std::vector<std::string> operators;
+    };
+
+    std::string symbol_id;
+    std::string operand_id;
+    std::vector<level_t> levels;
+
+    std::string level_id(std::size_t level) const;
+    std::string tail_id(std::size_t level) const;
+
+    // the chain of rules the table stands for, one nonterminal per level
+    // and a tail for each binary or postfix level, in LL(1) form
+    std::vector<production_rule_t> rules() const;
+  };
+
 }
 
 template <>
@@ -148,6 +177,11 @@ namespace compiler
     return delimiter;
   }
 
+  // terminal ids a pull scanner hands to recognize_pull() besides the
+  // parser's own, which are never negative
+  constexpr int end_of_input_id = -1;
+  constexpr int unknown_terminal_id = -2;
+
   // struct production_rule_t
   template <typename ForwardIterator>
   production_rule_t::production_rule_t(
@@ -175,12 +209,63 @@ namespace compiler
     return out_stream;
   }
 
+  // struct operator_table_t
+  std::string operator_table_t::level_id(std::size_t level) const
+  {
+    return symbol_id + "_" + std::to_string(level);
+  }
+
+  std::string operator_table_t::tail_id(std::size_t level) const
+  {
+    return level_id(level) + "_TAIL";
+  }
+
+  std::vector<production_rule_t> operator_table_t::rules() const
+  {
+    std::vector<production_rule_t> rules;
+    auto add_rule = [&](const std::string& symbol, std::vector<std::string> rule) {
+      rules.emplace_back(symbol, rule.begin(), rule.end());
+    };
+    add_rule(symbol_id, { levels.empty() ? operand_id : level_id(1) });
+    for (std::size_t level = 1; level <= levels.size(); ++level) {
+      auto& [kind, operators] = levels[level - 1];
+      std::string next = level < levels.size() ? level_id(level + 1) : operand_id;
+      std::string symbol = level_id(level), tail = tail_id(level);
+      if (kind == prefix) {
+        // SYMBOL_k ::= op SYMBOL_k | SYMBOL_k+1
+        for (auto&& op: operators) {
+          add_rule(symbol, { op, symbol });
+        }
+        add_rule(symbol, { next });
+        continue;
+      }
+      // SYMBOL_k ::= SYMBOL_k+1 SYMBOL_k_TAIL, the tail repeating the
+      // operator and its right operand, or the operator alone
+      add_rule(symbol, { next, tail });
+      for (auto&& op: operators) {
+        if (kind == left) {
+          add_rule(tail, { op, next, tail });
+        } else if (kind == right) {
+          add_rule(tail, { op, symbol });
+        } else {
+          add_rule(tail, { op, tail });
+        }
+      }
+      add_rule(tail, { epsilon_symbol().symbol_id });
+    }
+    return rules;
+  }
+
   // class syntax_t
+  // the symbol and rule tables allocate from the memory resource given at
+  // construction (the symbols' strings do not)
   class syntax_t
   {
   public:
     template <typename ForwardIterator>
-    syntax_t(const ForwardIterator& it_begin, const ForwardIterator& it_end)
+    syntax_t(const ForwardIterator& it_begin, const ForwardIterator& it_end,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : _terminate_symbols(resource), _non_terminate_symbols(resource), bnfs(resource)
     {
       // used for checking validation
       std::unordered_set<symbol_t> symbols, symbols_with_rule;
@@ -208,26 +293,62 @@ namespace compiler
       }
     }
 
-    std::vector<symbol_t> terminate_symbols()
+    // rules whose operator tables, their chains of rules among them, an
+    // LL(1) analyser may parse by precedence climbing
+    template <typename ForwardIterator>
+    syntax_t(const ForwardIterator& it_begin, const ForwardIterator& it_end,
+        const std::vector<operator_table_t>& operator_tables,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+    : syntax_t(it_begin, it_end, resource)
+    {
+      _operator_tables = operator_tables;
+    }
+
+    syntax_t(const syntax_t& syntax) = default;
+
+    // copy of syntax allocating from resource
+    syntax_t(const syntax_t& syntax, std::pmr::memory_resource* resource)
+    : is_valid(syntax.is_valid),
+      _terminate_symbols(syntax._terminate_symbols, resource),
+      _non_terminate_symbols(syntax._non_terminate_symbols, resource),
+      bnfs(syntax.bnfs, resource),
+      _operator_tables(syntax._operator_tables)
+    { }
+
+    std::pmr::memory_resource* resource() const
+    {
+      return bnfs.get_allocator().resource();
+    }
+
+    std::vector<symbol_t> terminate_symbols() const
     {
       std::vector<symbol_t> symbols { 
           _terminate_symbols.begin(), _terminate_symbols.end() };
       return symbols;
     }
 
-    std::vector<symbol_t> non_terminate_symbols()
+    std::vector<symbol_t> non_terminate_symbols() const
     {
       std::vector<symbol_t> symbols { 
           _non_terminate_symbols.begin(), _non_terminate_symbols.end() };
       return symbols;
     }
 
-    std::vector<production_rule_t> rules(symbol_t symbol)
+    std::vector<production_rule_t> rules(const symbol_t& symbol) const
     {
-      std::vector<production_rule_t> production_rules(bnfs[symbol]);
+      auto it = bnfs.find(symbol);
+      if (it == bnfs.end()) {
+        return {};
+      }
+      std::vector<production_rule_t> production_rules(it->second.begin(), it->second.end());
       return production_rules;
     }
 
+    const std::vector<operator_table_t>& operator_tables() const
+    {
+      return _operator_tables;
+    }
+
     explicit operator bool() const
     {
       return is_valid;
@@ -235,12 +356,13 @@ namespace compiler
 
   private:
     bool is_valid = true;
-    std::unordered_set<symbol_t> _terminate_symbols;
-    std::unordered_set<symbol_t> _non_terminate_symbols;
-    std::unordered_map<
+    std::pmr::unordered_set<symbol_t> _terminate_symbols;
+    std::pmr::unordered_set<symbol_t> _non_terminate_symbols;
+    std::pmr::unordered_map<
         symbol_t,
-        std::vector<production_rule_t>
+        std::pmr::vector<production_rule_t>
     > bnfs;
+    std::vector<operator_table_t> _operator_tables;
   };
 
 } // namespace compiler
@@ -1,11 +1,24 @@
 #ifndef COMPILER_SYNTAX_ANALYSIS_HPP
 #define COMPILER_SYNTAX_ANALYSIS_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <stack>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
+#include <utils/hash/xxhash64.hpp>
+#include <utils/profile/counters.hpp>
+#include <utils/profile/trace.hpp>
 #include <compiler/syntax.hpp>
 
 namespace compiler
@@ -13,18 +26,33 @@ namespace compiler
 class LL1_syntax_analyser_t
 {
 public:
-  LL1_syntax_analyser_t(const syntax_t &syntax, const symbol_t &start_symbol)
-      : _is_valid(true), _syntax(syntax), _start_symbol(start_symbol)
+  // the grammar copy and every table allocate from resource
+  LL1_syntax_analyser_t(const syntax_t &syntax, const symbol_t &start_symbol,
+                        std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+      : _is_valid(true), _syntax(syntax, resource), _start_symbol(start_symbol),
+        _first_set(resource), _follow_set(resource), _predict_table(resource),
+        _rule_ids(resource), _id_rules(resource),
+        _terminal_ids(resource), _nonterminal_ids(resource), _dense_rules(resource), _dense_predict(resource),
+        _rule_lhs(resource), _nonterminal_rules(resource), _occurrences(resource),
+        _lookahead(std::make_shared<lookahead_cache_t>()),
+        _climb_operators(resource), _climb_operands(resource), _climb_levels(resource)
   {
     _build_first_set();
     _build_follow_set();
     _build_predict_table();
     _check_validation();
+    _build_rule_ids();
+    _build_dense_tables();
+    _build_adaptive_tables();
+    _build_climb_tables();
   }
 
-  auto get_first_set(symbol_t symbol)
+  // the getters and the parse functions are const and keep no state in the
+  // analyser, so one analyser can serve any number of threads
+  std::pmr::unordered_set<symbol_t> get_first_set(const symbol_t &symbol) const
   {
-    auto first_set = _first_set[symbol];
+    auto it = _first_set.find(symbol);
+    auto first_set = it != _first_set.end() ? it->second : std::pmr::unordered_set<symbol_t>();
     if (symbol == epsilon_symbol())
     {
       first_set.insert(epsilon_symbol());
@@ -34,7 +62,7 @@ public:
 
   template <typename ForwardIterator>
   auto get_first_set(
-      ForwardIterator it_begin, ForwardIterator it_end)
+      ForwardIterator it_begin, ForwardIterator it_end) const
   {
     symbol_t epsilon = epsilon_symbol();
     std::unordered_set<symbol_t> first_set;
@@ -63,27 +91,28 @@ public:
     return first_set;
   }
 
-  auto get_follow_set(symbol_t symbol)
+  std::pmr::unordered_set<symbol_t> get_follow_set(const symbol_t &symbol) const
   {
-    return _follow_set[symbol];
+    auto it = _follow_set.find(symbol);
+    return it != _follow_set.end() ? it->second : std::pmr::unordered_set<symbol_t>();
   }
 
-  auto get_predict_table()
+  const auto &get_predict_table() const
   {
     return _predict_table;
   }
 
-  auto terminate_symbols()
+  auto terminate_symbols() const
   {
     return _syntax.terminate_symbols();
   }
 
-  auto non_terminate_symbols()
+  auto non_terminate_symbols() const
   {
     return _syntax.non_terminate_symbols();
   }
 
-  auto rules(symbol_t symbol)
+  auto rules(const symbol_t &symbol) const
   {
     return _syntax.rules(symbol);
   }
@@ -91,6 +120,7 @@ public:
 private:
   void _build_first_set()
   {
+    UTILS_TRACE_SCOPE("LL1/first_set");
     symbol_t epsilon = epsilon_symbol();
 
     // X is a ternimate symbol
@@ -119,21 +149,31 @@ private:
           else
           {
             // X -> Y_1 Y_2 ... Y_k (k >= 1)
+            bool flag_all_contain_epsilon = true;
             for (auto &&Yi : rule.rule_symbols)
             {
               // FIRST[Y_1] ... FIRST[Y_{i-1}] all contain epsilon, add
-              // all symbols in FIRST[Y_i] into FIRST[X]
+              // all symbols in FIRST[Y_i] but epsilon into FIRST[X]
               for (auto &&exist_symbol : _first_set[Yi])
               {
+                if (exist_symbol == epsilon)
+                  continue;
                 auto &&[_, inserted] = _first_set[X].insert(exist_symbol);
                 flag_added |= inserted;
               }
               // FIRST[Y_i] doesn't contain epsilon
               if (_first_set[Yi].count(epsilon) == 0)
               {
+                flag_all_contain_epsilon = false;
                 break;
               }
             }
+            // every Y_i derives epsilon
+            if (flag_all_contain_epsilon)
+            {
+              auto &&[_, inserted] = _first_set[X].insert(epsilon);
+              flag_added |= inserted;
+            }
           }
         }
       }
@@ -143,6 +183,7 @@ private:
 
   void _build_follow_set()
   {
+    UTILS_TRACE_SCOPE("LL1/follow_set");
     symbol_t epsilon = epsilon_symbol(), delimiter = delimiter_symbol();
 
     // insert delimiter into follow set of start symbol
@@ -194,6 +235,7 @@ private:
 
   void _build_predict_table()
   {
+    UTILS_TRACE_SCOPE("LL1/predict_table");
     symbol_t epsilon = epsilon_symbol(), delimiter = delimiter_symbol();
 
     for (auto &&A : non_terminate_symbols())
@@ -230,6 +272,8 @@ private:
     }
   }
 
+  // a cell more than one rule fits is left to adaptive prediction, which
+  // only a left-recursive grammar defeats
   void _check_validation()
   {
     for (auto &&[_, items] : get_predict_table())
@@ -237,13 +281,209 @@ private:
       for (auto &&[_, rule_set] : items)
       {
         if (rule_set.size() > 1)
+          ++_num_conflicts;
+      }
+    }
+    if (_num_conflicts > 0)
+      _is_valid = !_is_left_recursive();
+    _is_adaptive = _num_conflicts > 0 && _is_valid;
+  }
+
+  // whether a nonterminal derives a sentence starting with itself: its
+  // left corners, the nonterminals of its rules behind nullable symbols
+  // only, reach it
+  bool _is_left_recursive() const
+  {
+    symbol_t epsilon = epsilon_symbol();
+    std::unordered_map<symbol_t, std::vector<symbol_t>> left_corners;
+    for (auto &&A : non_terminate_symbols())
+    {
+      for (auto &&alpha : rules(A))
+      {
+        if (alpha.is_epsilon())
+          continue;
+        for (auto &&X : alpha.rule_symbols)
         {
-          _is_valid = false;
-          break;
+          if (!X.is_terminate)
+            left_corners[A].push_back(X);
+          if (get_first_set(X).count(epsilon) == 0)
+            break;
         }
       }
-      if (!_is_valid)
-        break;
+    }
+    for (auto &&[A, _] : left_corners)
+    {
+      std::unordered_set<symbol_t> visited;
+      std::vector<symbol_t> symbols { A };
+      while (!symbols.empty())
+      {
+        auto B = symbols.back();
+        symbols.pop_back();
+        auto it = left_corners.find(B);
+        if (it == left_corners.end())
+          continue;
+        for (auto &&C : it->second)
+        {
+          if (C == A)
+            return true;
+          if (visited.insert(C).second)
+            symbols.push_back(C);
+        }
+      }
+    }
+    return false;
+  }
+
+  void _build_rule_ids()
+  {
+    for (auto &&A : non_terminate_symbols())
+    {
+      for (auto &&alpha : rules(A))
+      {
+        if (_rule_ids.emplace(alpha, _id_rules.size()).second)
+          _id_rules.push_back(alpha);
+      }
+    }
+  }
+
+  void _build_dense_tables()
+  {
+    // terminals are numbered from 0 with "$" last, nonterminals follow them
+    // so both share one integer parse stack
+    symbol_t epsilon = epsilon_symbol();
+    for (auto &&a : terminate_symbols())
+    {
+      if (a != epsilon)
+        _terminal_ids.emplace(a.symbol_id, (int)_terminal_ids.size());
+    }
+    _terminal_ids.emplace(delimiter_symbol().symbol_id, (int)_terminal_ids.size());
+    _delimiter_id = _terminal_ids.at(delimiter_symbol().symbol_id);
+    _num_terminals = (int)_terminal_ids.size();
+
+    auto &nonterminal_ids = _nonterminal_ids;
+    for (auto &&A : non_terminate_symbols())
+    {
+      nonterminal_ids.emplace(A, _num_terminals + (int)nonterminal_ids.size());
+    }
+    nonterminal_ids.emplace(_start_symbol, _num_terminals + (int)nonterminal_ids.size());
+    _dense_start = nonterminal_ids.at(_start_symbol);
+
+    auto code = [&](const symbol_t &symbol) {
+      return _dense_id(symbol);
+    };
+    // right-hand sides are stored reversed, ready to be pushed
+    _dense_rules.resize(_id_rules.size());
+    for (std::size_t rule_id = 0; rule_id < _id_rules.size(); ++rule_id)
+    {
+      auto &rule = _id_rules[rule_id];
+      if (rule.is_epsilon())
+        continue;
+      for (auto reverse_it = rule.rule_symbols.rbegin();
+           reverse_it < rule.rule_symbols.rend(); ++reverse_it)
+      {
+        _dense_rules[rule_id].push_back(code(*reverse_it));
+      }
+    }
+
+    _dense_predict.assign(nonterminal_ids.size() * _num_terminals, -1);
+    for (auto &&[A, items] : _predict_table)
+    {
+      auto it_A = nonterminal_ids.find(A);
+      if (it_A == nonterminal_ids.end())
+        continue;
+      for (auto &&[a, rule_set] : items)
+      {
+        auto it_a = _terminal_ids.find(a.symbol_id);
+        if (it_a == _terminal_ids.end() || rule_set.empty())
+          continue;
+        _dense_predict[(it_A->second - _num_terminals) * _num_terminals + it_a->second] =
+            (_is_adaptive && rule_set.size() > 1) ? adaptive_cell : (int)_rule_ids.at(*rule_set.begin());
+      }
+    }
+  }
+
+  // the rules of every nonterminal, in grammar order, and where each
+  // nonterminal occurs in them, for adaptive prediction to expand and
+  // return from
+  void _build_adaptive_tables()
+  {
+    if (!_is_adaptive)
+      return;
+    std::size_t num_nonterminals = _nonterminal_ids.size();
+    _nonterminal_rules.resize(num_nonterminals);
+    _occurrences.resize(num_nonterminals);
+    _rule_lhs.resize(_id_rules.size());
+    for (std::size_t rule_id = 0; rule_id < _id_rules.size(); ++rule_id)
+    {
+      int lhs = _nonterminal_ids.at(_id_rules[rule_id].symbol);
+      _rule_lhs[rule_id] = lhs;
+      _nonterminal_rules[lhs - _num_terminals].push_back(rule_id);
+      auto &rule_symbols = _dense_rules[rule_id];
+      for (std::size_t idx = 0; idx < rule_symbols.size(); ++idx)
+      {
+        if (rule_symbols[idx] >= _num_terminals)
+          _occurrences[rule_symbols[idx] - _num_terminals].emplace_back(rule_id, idx);
+      }
+    }
+    _lookahead->dfas.reset(new lookahead_dfa_t[num_nonterminals]);
+    _lookahead->num_decisions = num_nonterminals;
+  }
+
+  // the operators of every operator table by terminal id, and the cells
+  // of its nonterminal and level nonterminals turned into climbing frames
+  // that start an expression at that level
+  void _build_climb_tables()
+  {
+    auto &operator_tables = _syntax.operator_tables();
+    for (auto &&table : operator_tables)
+      _climb_stride = std::max<int>(_climb_stride, table.levels.size() + 2);
+    _climb_operators.assign(operator_tables.size() * _num_terminals, climb_operator_t());
+    for (std::size_t table_id = 0; table_id < operator_tables.size(); ++table_id)
+    {
+      auto &table = operator_tables[table_id];
+      symbol_t operand(table.operand_id);
+      bool has_operand = operand.is_terminate
+          ? _terminal_ids.count(operand.symbol_id) > 0 : _nonterminal_ids.count(operand) > 0;
+      // tables too deep for climb_operator_t are parsed by their chain
+      if (table.levels.empty() || table.levels.size() > operator_table_t::max_levels || !has_operand)
+      {
+        _climb_operands.push_back(-1);
+        _climb_levels.push_back(0);
+        continue;
+      }
+      _climb_operands.push_back(_dense_id(operand));
+      _climb_levels.push_back(table.levels.size());
+      for (std::size_t level = 1; level <= table.levels.size(); ++level)
+      {
+        auto &[kind, operators] = table.levels[level - 1];
+        for (auto &&op : operators)
+        {
+          auto it_op = _terminal_ids.find(op);
+          if (it_op == _terminal_ids.end())
+            continue;
+          // an operator listed twice for one kind keeps its loosest level
+          auto &climb_operator = _climb_operators[table_id * _num_terminals + it_op->second];
+          auto &operator_level = kind == operator_table_t::prefix ? climb_operator.prefix
+              : kind == operator_table_t::postfix ? climb_operator.postfix : climb_operator.binary;
+          if (operator_level != 0)
+            continue;
+          operator_level = level;
+          if (kind == operator_table_t::right)
+            climb_operator.is_right = true;
+        }
+      }
+      std::vector<std::pair<std::string, std::size_t>> entries { { table.symbol_id, 1 } };
+      for (std::size_t level = 1; level <= table.levels.size(); ++level)
+        entries.emplace_back(table.level_id(level), level);
+      for (auto &&[symbol_id, level] : entries)
+      {
+        auto it_A = _nonterminal_ids.find(symbol_t(symbol_id));
+        if (it_A == _nonterminal_ids.end())
+          continue;
+        auto row = _dense_predict.begin() + (it_A->second - _num_terminals) * _num_terminals;
+        std::replace_if(row, row + _num_terminals, [](int cell) { return cell != -1; },
+            _climb_expect(table_id, level));
+      }
     }
   }
 
@@ -253,7 +493,184 @@ public:
     return _is_valid;
   }
 
-  std::string get(std::string nodename) {
+  // id of the terminal named token_name for recognize_pull(), or
+  // unknown_terminal_id
+  int terminal_id(const std::string &token_name) const
+  {
+    auto it = _terminal_ids.find(token_name);
+    return it == _terminal_ids.end() ? unknown_terminal_id : it->second;
+  }
+
+  // hash of the tables push() and recognize_pull() run on, terminal names
+  // included, equal for analysers that accept the same token ids alike
+  std::uint64_t fingerprint() const
+  {
+    std::vector<std::string> terminal_names(_terminal_ids.size());
+    for (auto &&[name, id] : _terminal_ids)
+      terminal_names[id] = name;
+    std::uint64_t hash = utils::hash::xxhash64(_dense_predict, _dense_start);
+    for (auto &&name : terminal_names)
+      hash = utils::hash::xxhash64(name.data(), name.size() + 1, hash);
+    for (auto &&rule_symbols : _dense_rules)
+    {
+      std::size_t size = rule_symbols.size();
+      hash = utils::hash::xxhash64(rule_symbols, utils::hash::xxhash64(&size, sizeof(size), hash));
+    }
+    return hash;
+  }
+
+  // cells more than one rule fits, predicted adaptively
+  std::size_t num_conflicts() const
+  {
+    return _num_conflicts;
+  }
+
+  // operator tables parsed by precedence climbing in push()
+  std::size_t num_operator_tables() const
+  {
+    return std::count_if(_climb_levels.begin(), _climb_levels.end(), [](int levels) { return levels > 0; });
+  }
+
+  // states of the lookahead DFAs built so far, over every decision
+  std::size_t num_lookahead_states() const
+  {
+    std::lock_guard<std::mutex> lock(_lookahead->mutex);
+    std::size_t num_states = 0;
+    for (std::size_t decision = 0; decision < _lookahead->num_decisions; ++decision)
+      num_states += _lookahead->dfas[decision].num_states;
+    return num_states;
+  }
+
+  // writes the lookahead DFA states built so far, for load_lookahead_dfa()
+  // to give an analyser of the same fingerprint in a later run
+  void save_lookahead_dfa(std::ostream &out_stream) const
+  {
+    std::lock_guard<std::mutex> lock(_lookahead->mutex);
+    out_stream << fingerprint() << "\n";
+    for (std::size_t decision = 0; decision < _lookahead->num_decisions; ++decision)
+    {
+      auto &dfa = _lookahead->dfas[decision];
+      if (dfa.num_states == 0)
+        continue;
+      out_stream << decision << " " << dfa.num_states << "\n";
+      for (std::size_t state_id = 0; state_id < dfa.num_states; ++state_id)
+      {
+        auto &state = dfa[state_id];
+        out_stream << state.prediction << " " << state.configurations.size();
+        for (auto value : state.configurations)
+          out_stream << " " << value;
+        std::vector<std::pair<int, int>> transitions;
+        for (int token = 0; token < _num_terminals; ++token)
+        {
+          int target = state.transitions[token].load(std::memory_order_relaxed);
+          if (target != unknown_state)
+            transitions.emplace_back(token, target);
+        }
+        out_stream << " " << transitions.size();
+        for (auto &&[token, target] : transitions)
+          out_stream << " " << token << " " << target;
+        out_stream << "\n";
+      }
+    }
+  }
+
+  // loads the lookahead DFAs save_lookahead_dfa() wrote. Parses hold
+  // state ids of the DFAs, so they are only loaded before any parse built
+  // a state: false, leaving them as they are, once one did, or if
+  // in_stream is not from an analyser of the same fingerprint or holds a
+  // value out of range
+  bool load_lookahead_dfa(std::istream &in_stream) const
+  {
+    std::uint64_t hash = 0;
+    if (!(in_stream >> hash) || hash != fingerprint() || !_is_adaptive)
+      return false;
+    std::vector<std::vector<lookahead_state_t>> loaded(_lookahead->num_decisions);
+    std::size_t decision = 0, num_states = 0;
+    while (in_stream >> decision >> num_states)
+    {
+      if (decision >= loaded.size() || !loaded[decision].empty() || num_states == 0)
+        return false;
+      auto &states = loaded[decision];
+      for (std::size_t state_id = 0; state_id < num_states; ++state_id)
+      {
+        lookahead_state_t state;
+        std::size_t size = 0, num_transitions = 0;
+        if (!(in_stream >> state.prediction >> size))
+          return false;
+        for (int value = 0; state.configurations.size() < size && in_stream >> value;)
+          state.configurations.push_back(value);
+        if (!_valid_lookahead_state(state, state_id == 0))
+          return false;
+        state.transitions = _new_transitions();
+        if (!(in_stream >> num_transitions) || num_transitions > (std::size_t)_num_terminals)
+          return false;
+        for (std::size_t idx = 0; idx < num_transitions; ++idx)
+        {
+          int token = -1, target = -1;
+          in_stream >> token >> target;
+          if (token < 0 || token >= _num_terminals || target < 0 || target >= (int)num_states)
+            return false;
+          state.transitions[token].store(target, std::memory_order_relaxed);
+        }
+        if (!in_stream)
+          return false;
+        states.push_back(std::move(state));
+      }
+    }
+    std::lock_guard<std::mutex> lock(_lookahead->mutex);
+    for (std::size_t decision = 0; decision < _lookahead->num_decisions; ++decision)
+    {
+      if (_lookahead->dfas[decision].num_states > 0)
+        return false;
+    }
+    for (std::size_t decision = 0; decision < loaded.size(); ++decision)
+    {
+      auto &dfa = _lookahead->dfas[decision];
+      for (auto &&state : loaded[decision])
+      {
+        if (!dfa.state_ids.emplace(state.configurations, (int)dfa.num_states).second)
+          return false;
+        dfa.add(std::move(state));
+      }
+    }
+    return true;
+  }
+
+  // per-call state of a parse, so that the analyser itself is never
+  // written to: the dense parse stack, whether the input was rejected and
+  // the rule expansions of every parse made with this context, counted
+  // only with UTILS_PROFILE_ENABLE_COUNTERS. One context per thread; it
+  // can be reused by push_start(context) without reallocating the stack.
+  // An adaptive decision keeps the nonterminal it is for, the tokens read
+  // ahead of it and its lookahead DFA state, or its configurations once
+  // the DFA leaves it to the parse stack
+  struct parse_context_t
+  {
+    std::vector<int> symbols;
+    bool rejected = false;
+    utils::profile::counter_table_t rule_counters;
+
+    int decision = -1;
+    int lookahead_state = 0;
+    std::vector<int> lookahead;
+    std::set<std::vector<int>> full_context;
+    std::size_t adaptive_predictions = 0;
+    std::size_t lookahead_tokens = 0;
+    std::size_t full_context_predictions = 0;
+  };
+
+  void report_counters(std::ostream &out_stream, const parse_context_t &context,
+                       std::size_t max_rows = 20) const
+  {
+    context.rule_counters.report(out_stream, "LL(1) rule expansions",
+        [&](std::size_t id) {
+          std::ostringstream rule_stream;
+          rule_stream << _id_rules[id];
+          return rule_stream.str();
+        }, max_rows);
+  }
+
+  static std::string get(const std::string &nodename) {
     std::string name = "\"";
     int len = nodename.length();
     for (int i = 0;i < len; i++) {
@@ -266,10 +683,22 @@ public:
     return name;
   }
 
+  // parses [it_begin, it_end), printing the derivation to out_stream and
+  // the parse tree to output/output.dot; returns whether it is accepted
+  template <typename ForwardIterator>
+  bool analysis(std::ostream &out_stream,
+                const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    return analysis(out_stream, it_begin, it_end, context);
+  }
+
   template <typename ForwardIterator>
-  void analysis(std::ostream &out_stream,
-                const ForwardIterator &it_begin, const ForwardIterator &it_end)
+  bool analysis(std::ostream &out_stream,
+                const ForwardIterator &it_begin, const ForwardIterator &it_end,
+                parse_context_t &context) const
   {
+    UTILS_TRACE_SCOPE("LL1/parse");
     std::stack<symbol_t> symbols;
     symbols.push(_start_symbol);
     std::stack<int> ids;
@@ -280,10 +709,32 @@ public:
     dot_stream << "graph g{\n";
     std::vector<int> deep;
     deep.push_back(0);
+    auto it = it_begin;
+    // the rule of a conflicting cell, from the tokens at it on and the
+    // symbols under the nonterminal
+    auto predict = [&](const symbol_t &A) {
+      auto below = symbols;
+      context.symbols.resize(below.size());
+      for (auto symbol_it = context.symbols.rbegin(); symbol_it != context.symbols.rend(); ++symbol_it)
+      {
+        *symbol_it = _dense_id(below.top());
+        below.pop();
+      }
+      return _predict(context, A, it, it_end);
+    };
     auto match_or_output = [&](symbol_t terminate_symbol) {
+      // a whole sentence was derived: only the end of input may follow
+      if (symbols.empty())
+      {
+        bool accepted = terminate_symbol == delimiter_symbol();
+        if (!accepted)
+          out_stream << "[error] " << terminate_symbol << "\n";
+        return accepted;
+      }
       for (int idx = 0;idx < deep[ids.top()];idx++)
         out_stream << "\t";
       out_stream << "[matching] " << terminate_symbol << "\n";
+      bool matched = false;
       while (!symbols.empty())
       {
         auto top = symbols.top();
@@ -296,11 +747,21 @@ public:
             out_stream << "\t";
           out_stream << "[matched] " << terminate_symbol << "\n";
           dot_stream << "\t" << get(top.symbol_id + "_" + std::to_string(top_id)) + "--" + get(terminate_symbol.symbol_id + "_" + std::to_string(top_id)) << "\n";
+          matched = true;
           break;
         }
         else
         {
-          auto rule = *(_predict_table[top][terminate_symbol].begin());
+          auto rule_ptr = top.is_terminate ? nullptr : _find_rule(top, terminate_symbol, predict);
+          if (rule_ptr == nullptr)
+          {
+            for (int idx = 0; idx < deep[top_id]; idx++)
+              out_stream << "\t";
+            out_stream << "[error] " << terminate_symbol << "\n";
+            return false;
+          }
+          auto &rule = *rule_ptr;
+          UTILS_PROFILE_COUNT(context.rule_counters, _rule_ids.at(rule));
           for (int idx = 0; idx < deep[top_id]; idx++)
             out_stream << "\t";
           out_stream << rule << "\n";
@@ -317,32 +778,798 @@ public:
           }
         }
       }
+      // the end of input is only matched by emptying the stack
+      return matched || terminate_symbol == delimiter_symbol();
     };
 
-    for (auto it = it_begin; it < it_end; ++it)
+    bool accepted = true;
+    for (; it != it_end && accepted; ++it)
     {
-      match_or_output(*it);
+      accepted = match_or_output(*it);
     }
-    match_or_output(delimiter_symbol());
+    accepted = accepted && match_or_output(delimiter_symbol());
     dot_stream << "}\n";
     dot_stream.close();
     system("dot -Tpng output/output.dot -o output/output.png");
+    return accepted;
+  }
+
+  // parses [it_begin, it_end) without output, returns whether it is accepted
+  template <typename ForwardIterator>
+  bool recognize(const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    return recognize(it_begin, it_end, context);
+  }
+
+  template <typename ForwardIterator>
+  bool recognize(const ForwardIterator &it_begin, const ForwardIterator &it_end,
+                 parse_context_t &context) const
+  {
+    UTILS_TRACE_SCOPE("LL1/recognize");
+    // symbols point into _predict_table rules, which are never modified here
+    std::vector<const symbol_t *> symbols { &_start_symbol };
+    auto it = it_begin;
+    auto predict = [&](const symbol_t &A) {
+      context.symbols.clear();
+      for (auto symbol : symbols)
+        context.symbols.push_back(_dense_id(*symbol));
+      return _predict(context, A, it, it_end);
+    };
+    auto match = [&](const symbol_t &terminate_symbol, bool is_delimiter) {
+      while (!symbols.empty())
+      {
+        auto top = symbols.back();
+        symbols.pop_back();
+        if (*top == terminate_symbol)
+          return true;
+        if (top->is_terminate)
+          return false;
+        auto rule_ptr = _find_rule(*top, terminate_symbol, predict);
+        if (rule_ptr == nullptr)
+          return false;
+        auto &rule = *rule_ptr;
+        UTILS_PROFILE_COUNT(context.rule_counters, _rule_ids.at(rule));
+        if (!rule.is_epsilon())
+        {
+          for (auto reverse_it = rule.rule_symbols.rbegin();
+               reverse_it < rule.rule_symbols.rend(); ++reverse_it)
+          {
+            symbols.push_back(&*reverse_it);
+          }
+        }
+      }
+      return is_delimiter;
+    };
+
+    for (; it != it_end; ++it)
+    {
+      if (!match(*it, false))
+        return false;
+    }
+    return match(delimiter_symbol(), true);
+  }
+
+  // state of a push parse: the parse context, a plain value that can be
+  // copied away between feed() calls and resumed later
+  using push_state_t = parse_context_t;
+
+  push_state_t push_start() const
+  {
+    push_state_t state;
+    push_start(state);
+    return state;
+  }
+
+  // restarts the parse in context, keeping its counters
+  void push_start(parse_context_t &context) const
+  {
+    context.symbols.assign(1, _dense_start);
+    context.rejected = false;
+    context.decision = -1;
+    context.lookahead.clear();
+  }
+
+  // consumes one terminal id, or the delimiter id at the end of input;
+  // false once the input is rejected
+  bool push(push_state_t &state, int token) const
+  {
+    if (state.rejected)
+      return false;
+    if (state.decision >= 0)
+      return _push_lookahead(state, token);
+    const int num_terminals = _num_terminals;
+    auto &symbols = state.symbols;
+    while (!symbols.empty())
+    {
+      int top = symbols.back();
+      symbols.pop_back();
+      if (top == token)
+        return true;
+      int rule_id = (top < num_terminals || token < 0)
+          ? -1 : _dense_predict[(top - num_terminals) * num_terminals + token];
+      if (rule_id < 0)
+      {
+        if (rule_id == adaptive_cell)
+        {
+          _start_decision(state, top);
+          return _push_lookahead(state, token);
+        }
+        // a climbing frame on the stack, or one a cell expands into
+        int frame = rule_id < adaptive_cell ? rule_id : top;
+        if (frame <= climb_frame)
+        {
+          if (_climb(symbols, frame, token))
+            return true;
+          continue;
+        }
+        state.rejected = true;
+        return false;
+      }
+      UTILS_PROFILE_COUNT(state.rule_counters, rule_id);
+      auto &rule_symbols = _dense_rules[rule_id];
+      symbols.insert(symbols.end(), rule_symbols.begin(), rule_symbols.end());
+    }
+    state.rejected = token != _delimiter_id;
+    return !state.rejected;
+  }
+
+  // consumes the symbols [it_begin, it_end), returns false once rejected
+  template <typename ForwardIterator>
+  bool feed(push_state_t &state,
+            const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    for (auto it = it_begin; it != it_end && !state.rejected; ++it)
+    {
+      push(state, terminal_id((*it).symbol_id));
+    }
+    return !state.rejected;
+  }
+
+  // ends the input, returns whether it is accepted
+  bool finish(push_state_t &state) const
+  {
+    return push(state, _delimiter_id) && state.symbols.empty();
+  }
+
+  // parses the terminal ids returned by next_token() until it returns
+  // end_of_input_id, on dense tables; accepts the same inputs as
+  // recognize() without building a symbol per token
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token) const
+  {
+    parse_context_t context;
+    return recognize_pull(next_token, context);
+  }
+
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token, parse_context_t &state) const
+  {
+    UTILS_TRACE_SCOPE("LL1/recognize_pull");
+    push_start(state);
+    for (int token = next_token(); token != end_of_input_id; token = next_token())
+    {
+      if (!push(state, token))
+        return false;
+    }
+    return finish(state);
   }
 
 private:
+  // precedence climbing over an operator table, as a loop whose state
+  // lives on the parse stack between tokens: a frame either expects an
+  // expression whose operators bind at least as tight as level min, or
+  // follows an operand with the operators of levels min to cap. Frames
+  // are negative, below the ids of tokens and adaptive_cell, and sit in
+  // the cells of the table's nonterminals, so a parse pays for them only
+  // where it reaches one: an expression costs a few stack entries per
+  // operator and operand whatever the number of levels. A prefix operator
+  // is preferred to an operand, a postfix operator to a binary one
+  static constexpr int climb_frame = -3;
+
+  struct climb_operator_t
+  {
+    std::uint8_t prefix = 0;
+    std::uint8_t postfix = 0;
+    std::uint8_t binary = 0;
+    bool is_right = false;
+  };
+
+  int _climb_expect(std::size_t table_id, std::size_t min) const
+  {
+    return climb_frame - (((int)table_id * _climb_stride + (int)min) * _climb_stride) * 2;
+  }
+
+  int _climb_follow(std::size_t table_id, std::size_t min, std::size_t cap) const
+  {
+    return climb_frame - (((int)table_id * _climb_stride + (int)min) * _climb_stride + (int)cap) * 2 - 1;
+  }
+
+  struct climb_frame_t
+  {
+    int table_id;
+    int min;
+    int cap;
+    bool is_follow;
+  };
+
+  climb_frame_t _climb_decode(int frame) const
+  {
+    int code = climb_frame - frame;
+    int stride = _climb_stride;
+    return { code / 2 / stride / stride, code / 2 / stride % stride, code / 2 % stride, (code & 1) != 0 };
+  }
+
+  // one step of the loop on frame, popped off symbols, and token: pushes
+  // the frames and the operand to parse next, returns whether it consumed
+  // token
+  bool _climb(std::vector<int> &symbols, int frame, int token) const
+  {
+    // plain copies, which the lambda below can capture
+    auto decoded = _climb_decode(frame);
+    int table_id = decoded.table_id, min = decoded.min, cap = decoded.cap;
+    climb_operator_t op;
+    if (token >= 0 && token < _num_terminals)
+      op = _climb_operators[table_id * _num_terminals + token];
+    auto push_follow = [&](int follow_cap) {
+      if (follow_cap >= min)
+        symbols.push_back(_climb_follow(table_id, min, follow_cap));
+    };
+    if (!decoded.is_follow)
+    {
+      if (op.prefix >= min)
+      {
+        push_follow(op.prefix - 1);
+        symbols.push_back(_climb_expect(table_id, op.prefix));
+        return true;
+      }
+      push_follow(_climb_levels[table_id]);
+      symbols.push_back(_climb_operands[table_id]);
+      return false;
+    }
+    if (op.postfix >= min && op.postfix <= cap)
+    {
+      push_follow(op.postfix);
+      return true;
+    }
+    if (op.binary >= min && op.binary <= cap)
+    {
+      push_follow(op.is_right ? op.binary - 1 : op.binary);
+      symbols.push_back(_climb_expect(table_id, op.is_right ? op.binary : op.binary + 1));
+      return true;
+    }
+    return false;
+  }
+
+  // the grammar symbols a frame stands for, pushed onto configuration for
+  // adaptive prediction in context: the level nonterminal of an expected
+  // expression, the tails of the levels an operand is followed in
+  void _climb_symbols(int frame, std::vector<int> &configuration) const
+  {
+    auto [table_id, min, cap, is_follow] = _climb_decode(frame);
+    auto &table = _syntax.operator_tables()[table_id];
+    if (!is_follow)
+    {
+      configuration.push_back(min > _climb_levels[table_id]
+          ? _climb_operands[table_id] : _nonterminal_ids.at(symbol_t(table.level_id(min))));
+      return;
+    }
+    for (int level = min; level <= cap; ++level)
+    {
+      if (table.levels[level - 1].kind != operator_table_t::prefix)
+        configuration.push_back(_nonterminal_ids.at(symbol_t(table.tail_id(level))));
+    }
+  }
+
+  // the rule of M[A, a], or nullptr for an empty cell; predict(A) picks
+  // the rule of a conflicting cell
+  template <typename Predict>
+  const production_rule_t *_find_rule(const symbol_t &A, const symbol_t &a, Predict &&predict) const
+  {
+    auto it_items = _predict_table.find(A);
+    if (it_items == _predict_table.end())
+      return nullptr;
+    auto it_rules = it_items->second.find(a);
+    if (it_rules == it_items->second.end() || it_rules->second.empty())
+      return nullptr;
+    if (_is_adaptive && it_rules->second.size() > 1)
+      return predict(A);
+    return &*it_rules->second.begin();
+  }
+
+  int _dense_id(const symbol_t &symbol) const
+  {
+    if (symbol.is_terminate)
+      return _terminal_ids.at(symbol.symbol_id);
+    return _nonterminal_ids.at(symbol);
+  }
+
+  // adaptive prediction, as ALL(*) does: the rules of the decision's
+  // nonterminal are followed over the tokens ahead until one rule is left.
+  // A configuration is a rule, the context its symbols are matched in and
+  // the symbols left, top last. The lookahead DFA simulates the rules out
+  // of context, returning from a nonterminal into every rule it occurs in,
+  // so that its states hold for every decision on the nonterminal; only
+  // when that leaves rules it cannot tell apart are they followed again
+  // with the parse stack under the decision as their context
+  static constexpr int adaptive_cell = -2;
+  static constexpr int predict_error = -1;
+  static constexpr int predict_pending = -2;
+  static constexpr int predict_full_context = -3;
+  static constexpr int unknown_state = -1;
+  static constexpr int full_context_state = -1;
+
+  using configuration_set_t = std::set<std::vector<int>>;
+
+  // a lookahead DFA state: its configurations encoded as its key, after
+  // whether it is the start state, a state past "$" or neither; what it
+  // predicts; its targets by terminal id, the only part that changes once
+  // the state is added
+  struct lookahead_state_t
+  {
+    std::vector<int> configurations;
+    int prediction = predict_pending;
+    std::unique_ptr<std::atomic<int>[]> transitions;
+  };
+
+  // the states of a decision's lookahead DFA in chunks that never move,
+  // chunk k holding 64 << k states, so that parses follow the targets
+  // already built without the lock while states are added. A chunk is
+  // published once its first state is in it, and a state is complete
+  // before any target names it
+  struct lookahead_dfa_t
+  {
+    static constexpr int first_chunk_bits = 6;
+    static constexpr int num_chunks = 25;
+
+    std::atomic<lookahead_state_t *> chunks[num_chunks] {};
+    // the states added and their ids by key, under the cache's mutex
+    std::size_t num_states = 0;
+    std::map<std::vector<int>, int> state_ids;
+
+    lookahead_dfa_t() = default;
+    lookahead_dfa_t(const lookahead_dfa_t &) = delete;
+    lookahead_dfa_t &operator=(const lookahead_dfa_t &) = delete;
+
+    ~lookahead_dfa_t()
+    {
+      for (auto &chunk : chunks)
+        delete[] chunk.load(std::memory_order_relaxed);
+    }
+
+    static std::pair<int, std::size_t> locate(std::size_t state_id)
+    {
+      std::size_t idx = state_id + (std::size_t(1) << first_chunk_bits);
+      int chunk = 63 - __builtin_clzll(idx) - first_chunk_bits;
+      return { chunk, idx - (std::size_t(1) << (chunk + first_chunk_bits)) };
+    }
+
+    bool started() const
+    {
+      return chunks[0].load(std::memory_order_acquire) != nullptr;
+    }
+
+    lookahead_state_t &operator[](std::size_t state_id) const
+    {
+      auto [chunk, offset] = locate(state_id);
+      return chunks[chunk].load(std::memory_order_acquire)[offset];
+    }
+
+    // under the cache's mutex
+    int add(lookahead_state_t &&state)
+    {
+      auto [chunk, offset] = locate(num_states);
+      if (offset == 0)
+      {
+        auto states = new lookahead_state_t[std::size_t(1) << (chunk + first_chunk_bits)];
+        states[0] = std::move(state);
+        chunks[chunk].store(states, std::memory_order_release);
+      }
+      else
+        chunks[chunk].load(std::memory_order_relaxed)[offset] = std::move(state);
+      return (int)num_states++;
+    }
+  };
+
+  // the lookahead DFAs by decision, the nonterminal ids less the terminal
+  // ids, built as parses need them and shared by all of them; the mutex
+  // is only taken to add states and targets
+  struct lookahead_cache_t
+  {
+    std::mutex mutex;
+    std::unique_ptr<lookahead_dfa_t[]> dfas;
+    std::size_t num_decisions = 0;
+  };
+
+  std::unique_ptr<std::atomic<int>[]> _new_transitions() const
+  {
+    std::unique_ptr<std::atomic<int>[]> transitions(new std::atomic<int>[_num_terminals]);
+    for (int token = 0; token < _num_terminals; ++token)
+      transitions[token].store(unknown_state, std::memory_order_relaxed);
+    return transitions;
+  }
+
+  // whether a loaded state is one the grammar could have built: its kind,
+  // configurations of a rule, the nonterminal returned to and symbols in
+  // range, and a prediction that is a rule or a pending decision
+  bool _valid_lookahead_state(const lookahead_state_t &state, bool is_start) const
+  {
+    int num_rules = _dense_rules.size();
+    int num_symbols = _num_terminals + (int)_nonterminal_rules.size();
+    if (state.prediction < predict_full_context || state.prediction >= num_rules)
+      return false;
+    auto &key = state.configurations;
+    if (key.empty() || key[0] < inner_state || key[0] > end_state || (key[0] == start_state) != is_start)
+      return false;
+    for (std::size_t idx = 1; idx < key.size(); idx += key[idx] + 1)
+    {
+      if (key[idx] < 2 || (std::size_t)key[idx] > key.size() - idx - 1)
+        return false;
+      auto configuration = key.begin() + idx + 1;
+      if (configuration[0] < 0 || configuration[0] >= num_rules
+          || configuration[1] < -1 || configuration[1] >= num_symbols
+          || (configuration[1] >= 0 && configuration[1] < _num_terminals))
+        return false;
+      for (int symbol_idx = 2; symbol_idx < key[idx]; ++symbol_idx)
+      {
+        if (configuration[symbol_idx] < 0 || configuration[symbol_idx] >= num_symbols)
+          return false;
+      }
+    }
+    return true;
+  }
+
+  enum state_kind_t
+  {
+    inner_state,
+    start_state,
+    end_state,
+  };
+
+  static std::vector<int> _encode(state_kind_t kind, const configuration_set_t &configurations)
+  {
+    std::vector<int> key { kind };
+    for (auto &&configuration : configurations)
+    {
+      key.push_back(configuration.size());
+      key.insert(key.end(), configuration.begin(), configuration.end());
+    }
+    return key;
+  }
+
+  static configuration_set_t _decode(const std::vector<int> &key)
+  {
+    configuration_set_t configurations;
+    for (std::size_t idx = 1; idx < key.size(); idx += key[idx] + 1)
+      configurations.emplace(key.begin() + idx + 1, key.begin() + idx + 1 + key[idx]);
+    return configurations;
+  }
+
+  // closes an out-of-context configuration, rule, nonterminal returned to
+  // (-1 past the start symbol) and symbols, into configurations whose top
+  // is a terminal or which end the input
+  void _closure(std::vector<int> configuration,
+                configuration_set_t &visited, configuration_set_t &configurations) const
+  {
+    if (!visited.insert(configuration).second)
+      return;
+    if (configuration.size() == 2)
+    {
+      int nonterminal = configuration[1];
+      if (nonterminal < 0)
+      {
+        configurations.insert(configuration);
+        return;
+      }
+      if (nonterminal == _dense_start)
+        _closure({ configuration[0], -1 }, visited, configurations);
+      for (auto [rule_id, idx] : _occurrences[nonterminal - _num_terminals])
+      {
+        auto &rule_symbols = _dense_rules[rule_id];
+        std::vector<int> next { configuration[0], _rule_lhs[rule_id] };
+        next.insert(next.end(), rule_symbols.begin(), rule_symbols.begin() + idx);
+        _closure(std::move(next), visited, configurations);
+      }
+      return;
+    }
+    _expand(std::move(configuration), [&](std::vector<int> next) {
+      _closure(std::move(next), visited, configurations);
+    }, configurations);
+  }
+
+  // closes a configuration in context, rule, symbols of stack under the
+  // decision left and symbols, the same way
+  void _closure(std::vector<int> configuration, const std::vector<int> &stack,
+                configuration_set_t &visited, configuration_set_t &configurations) const
+  {
+    while (configuration.size() == 2 && configuration[1] > 0)
+    {
+      int symbol = stack[--configuration[1]];
+      if (symbol <= climb_frame)
+        _climb_symbols(symbol, configuration);
+      else
+        configuration.push_back(symbol);
+    }
+    if (!visited.insert(configuration).second)
+      return;
+    if (configuration.size() == 2)
+    {
+      configurations.insert(configuration);
+      return;
+    }
+    _expand(std::move(configuration), [&](std::vector<int> next) {
+      _closure(std::move(next), stack, visited, configurations);
+    }, configurations);
+  }
+
+  template <typename Closure>
+  void _expand(std::vector<int> configuration, Closure &&closure, configuration_set_t &configurations) const
+  {
+    int top = configuration.back();
+    if (top < _num_terminals)
+    {
+      configurations.insert(configuration);
+      return;
+    }
+    configuration.pop_back();
+    for (auto rule_id : _nonterminal_rules[top - _num_terminals])
+    {
+      auto next = configuration;
+      next.insert(next.end(), _dense_rules[rule_id].begin(), _dense_rules[rule_id].end());
+      closure(std::move(next));
+    }
+  }
+
+  // the configurations left once token is matched, closed again
+  template <typename Closure>
+  configuration_set_t _move(const configuration_set_t &configurations, int token, Closure &&closure) const
+  {
+    configuration_set_t next;
+    for (auto &&configuration : configurations)
+    {
+      if (token == _delimiter_id && configuration.size() == 2)
+        next.insert(configuration);
+      else if (configuration.size() > 2 && configuration.back() == token)
+        closure(std::vector<int>(configuration.begin(), configuration.end() - 1), next);
+    }
+    return next;
+  }
+
+  // the rule the configurations agree on, predict_error when none is
+  // left, or when no symbol ahead tells the rules left apart, the first of
+  // them in context and predict_full_context out of it; else
+  // predict_pending
+  int _prediction(const configuration_set_t &configurations, bool is_end, bool in_context) const
+  {
+    if (configurations.empty())
+      return predict_error;
+    // configurations are ordered by rule first
+    int first_rule = configurations.begin()->front();
+    if (configurations.rbegin()->front() == first_rule)
+      return first_rule;
+    if (!is_end)
+    {
+      std::map<std::vector<int>, std::size_t> rules_by_rest;
+      std::size_t num_rules = 0;
+      int last_rule = -1;
+      for (auto &&configuration : configurations)
+      {
+        if (configuration.front() != last_rule)
+          ++num_rules, last_rule = configuration.front();
+        ++rules_by_rest[std::vector<int>(configuration.begin() + 1, configuration.end())];
+      }
+      for (auto &&[_, count] : rules_by_rest)
+      {
+        if (count != num_rules)
+          return predict_pending;
+      }
+    }
+    return in_context ? first_rule : predict_full_context;
+  }
+
+  // the target of state on token in the decision's lookahead DFA, built
+  // on a miss, and what it predicts; a target built already is read
+  // without the lock
+  int _transit(int decision, int state, int token, int &prediction) const
+  {
+    auto &dfa = _lookahead->dfas[decision];
+    if (dfa.started())
+    {
+      int target = dfa[state].transitions[token].load(std::memory_order_acquire);
+      if (target != unknown_state)
+      {
+        prediction = dfa[target].prediction;
+        return target;
+      }
+    }
+    std::lock_guard<std::mutex> lock(_lookahead->mutex);
+    auto add_state = [&](std::vector<int> &&key, int prediction) {
+      auto [it, inserted] = dfa.state_ids.try_emplace(key, (int)dfa.num_states);
+      if (inserted)
+        dfa.add(lookahead_state_t { std::move(key), prediction, _new_transitions() });
+      return it->second;
+    };
+    if (dfa.num_states == 0)
+    {
+      configuration_set_t visited, configurations;
+      int nonterminal = decision + _num_terminals;
+      for (auto rule_id : _nonterminal_rules[decision])
+      {
+        std::vector<int> configuration { rule_id, nonterminal };
+        configuration.insert(configuration.end(), _dense_rules[rule_id].begin(), _dense_rules[rule_id].end());
+        _closure(std::move(configuration), visited, configurations);
+      }
+      add_state(_encode(start_state, configurations), predict_pending);
+    }
+    // another parse may have built it meanwhile
+    auto &transition = dfa[state].transitions[token];
+    int target = transition.load(std::memory_order_relaxed);
+    if (target == unknown_state)
+    {
+      auto configurations = _move(_decode(dfa[state].configurations), token,
+          [&](std::vector<int> configuration, configuration_set_t &next) {
+            configuration_set_t visited;
+            _closure(std::move(configuration), visited, next);
+          });
+      bool is_end = token == _delimiter_id;
+      int prediction = _prediction(configurations, is_end, false);
+      target = add_state(_encode(is_end ? end_state : inner_state, configurations), prediction);
+      transition.store(target, std::memory_order_release);
+    }
+    prediction = dfa[target].prediction;
+    return target;
+  }
+
+  void _start_decision(parse_context_t &context, int nonterminal) const
+  {
+    context.decision = nonterminal - _num_terminals;
+    context.lookahead_state = 0;
+    context.lookahead.clear();
+    context.full_context.clear();
+    ++context.adaptive_predictions;
+  }
+
+  // reads token ahead of the decision, the last of context.lookahead;
+  // the rule predicted, or predict_pending or predict_error
+  int _predict_next(parse_context_t &context, int token) const
+  {
+    ++context.lookahead_tokens;
+    if (token < 0 || token >= _num_terminals)
+      return predict_error;
+    auto closure = [&](std::vector<int> configuration, configuration_set_t &next) {
+      configuration_set_t visited;
+      _closure(std::move(configuration), context.symbols, visited, next);
+    };
+    if (context.lookahead_state != full_context_state)
+    {
+      int prediction = predict_pending;
+      context.lookahead_state = _transit(context.decision, context.lookahead_state, token, prediction);
+      if (prediction != predict_full_context)
+        return prediction;
+      // the rules again in context, over the tokens read so far
+      ++context.full_context_predictions;
+      context.lookahead_state = full_context_state;
+      context.full_context.clear();
+      int stack_depth = context.symbols.size();
+      for (auto rule_id : _nonterminal_rules[context.decision])
+      {
+        std::vector<int> configuration { rule_id, stack_depth };
+        configuration.insert(configuration.end(), _dense_rules[rule_id].begin(), _dense_rules[rule_id].end());
+        closure(std::move(configuration), context.full_context);
+      }
+      for (std::size_t idx = 0; idx + 1 < context.lookahead.size(); ++idx)
+      {
+        context.full_context = _move(context.full_context, context.lookahead[idx], closure);
+        int prediction = _prediction(context.full_context, false, true);
+        if (prediction != predict_pending)
+          return prediction;
+      }
+    }
+    context.full_context = _move(context.full_context, token, closure);
+    return _prediction(context.full_context, token == _delimiter_id, true);
+  }
+
+  // push() of a token read ahead of a pending decision, which once decided
+  // expands its rule and pushes the tokens read again
+  bool _push_lookahead(parse_context_t &context, int token) const
+  {
+    context.lookahead.push_back(token);
+    int rule_id = _predict_next(context, token);
+    if (rule_id == predict_pending)
+      return true;
+    context.decision = -1;
+    if (rule_id < 0)
+    {
+      context.rejected = true;
+      return false;
+    }
+    UTILS_PROFILE_COUNT(context.rule_counters, rule_id);
+    auto &rule_symbols = _dense_rules[rule_id];
+    context.symbols.insert(context.symbols.end(), rule_symbols.begin(), rule_symbols.end());
+    std::vector<int> lookahead;
+    lookahead.swap(context.lookahead);
+    for (auto lookahead_token : lookahead)
+    {
+      if (!push(context, lookahead_token))
+        return false;
+    }
+    // keeps the buffer unless a decision pending again holds another
+    if (context.lookahead.empty())
+    {
+      lookahead.clear();
+      context.lookahead.swap(lookahead);
+    }
+    return true;
+  }
+
+  // the rule of A's decision, context.symbols holding the stack under it,
+  // from the symbols at it_next on; nullptr if none fits
+  template <typename ForwardIterator>
+  const production_rule_t *_predict(parse_context_t &context, const symbol_t &A,
+                                    ForwardIterator it_next, const ForwardIterator &it_end) const
+  {
+    _start_decision(context, _dense_id(A));
+    int rule_id = predict_pending;
+    while (rule_id == predict_pending)
+    {
+      int token = _delimiter_id;
+      if (it_next != it_end)
+      {
+        token = terminal_id((*it_next).symbol_id);
+        ++it_next;
+      }
+      context.lookahead.push_back(token);
+      rule_id = _predict_next(context, token);
+    }
+    context.decision = -1;
+    return rule_id < 0 ? nullptr : &_id_rules[rule_id];
+  }
+
   bool _is_valid;
   syntax_t _syntax;
   symbol_t _start_symbol;
 
-  std::unordered_map<symbol_t, std::unordered_set<symbol_t>> _first_set;
-  std::unordered_map<symbol_t, std::unordered_set<symbol_t>> _follow_set;
+  std::pmr::unordered_map<symbol_t, std::pmr::unordered_set<symbol_t>> _first_set;
+  std::pmr::unordered_map<symbol_t, std::pmr::unordered_set<symbol_t>> _follow_set;
 
-  std::unordered_map<
+  std::pmr::unordered_map<
       symbol_t,
-      std::unordered_map<
+      std::pmr::unordered_map<
           symbol_t,
-          std::unordered_set<production_rule_t>>>
+          std::pmr::unordered_set<production_rule_t>>>
       _predict_table;
+
+  std::pmr::unordered_map<production_rule_t, std::size_t> _rule_ids;
+  std::pmr::vector<production_rule_t> _id_rules;
+
+  // integer tables of recognize_pull(), rule ids as in _id_rules
+  std::pmr::unordered_map<std::string, int> _terminal_ids;
+  std::pmr::unordered_map<symbol_t, int> _nonterminal_ids;
+  int _num_terminals = 0;
+  int _delimiter_id = 0;
+  int _dense_start = 0;
+  std::pmr::vector<std::pmr::vector<int>> _dense_rules;
+  std::pmr::vector<int> _dense_predict;
+
+  // adaptive prediction, for the cells of _dense_predict marked
+  // adaptive_cell: the nonterminal of every rule, the rules of every
+  // nonterminal, where each nonterminal occurs as (rule id, index in the
+  // reversed right-hand side), and the lookahead DFAs, shared with the
+  // copies of the analyser
+  std::size_t _num_conflicts = 0;
+  bool _is_adaptive = false;
+  std::pmr::vector<int> _rule_lhs;
+  std::pmr::vector<std::pmr::vector<int>> _nonterminal_rules;
+  std::pmr::vector<std::pmr::vector<std::pair<int, std::size_t>>> _occurrences;
+  std::shared_ptr<lookahead_cache_t> _lookahead;
+
+  // precedence climbing: the operators of every operator table by
+  // terminal id, its operand nonterminal and its number of levels, and
+  // the levels a frame code counts in
+  std::pmr::vector<climb_operator_t> _climb_operators;
+  std::pmr::vector<int> _climb_operands;
+  std::pmr::vector<int> _climb_levels;
+  int _climb_stride = 2;
 };
 } // namespace compiler
 
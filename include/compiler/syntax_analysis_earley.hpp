@@ -0,0 +1,644 @@
+#ifndef COMPILER_SYNTAX_ANALYSIS_EARLEY_HPP
+#define COMPILER_SYNTAX_ANALYSIS_EARLEY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <utils/profile/trace.hpp>
+#include <compiler/parse_forest.hpp>
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+// Earley parser for any context-free grammar, the fallback for grammars
+// that no deterministic table fits. Items are a dotted rule id and an
+// origin, every item set is a range of one array. Nullable symbols are
+// skipped when predicted, as Aycock and Horspool do, so that no item
+// completes in the set it started in, and a completion whose origin set
+// has a single item waiting on the symbol, that item ending the rule,
+// jumps to the topmost item of the chain, as Leo does, so right-recursive
+// lists take linear time. The parses are kept in a parse_forest_t, built
+// after recognition; the chains Leo skipped are walked only for the
+// forest nodes that need them
+class Earley_syntax_analyser_t
+{
+public:
+  struct item_t
+  {
+    int dot;
+    int origin;
+    int first_link;
+  };
+
+  // how an item was reached from its predecessor: over the symbol whose
+  // forest node spans [origin, set of the item); the predecessor is in
+  // set origin
+  struct link_t
+  {
+    int predecessor;
+    int symbol;
+    int origin;
+    int next_link;
+  };
+
+  // the items of one set waiting on symbol, with Leo's topmost item when
+  // there is a single one ending its rule: reached by moving leo_item
+  // over leo_symbol, completed from leo_origin
+  struct transition_t
+  {
+    int symbol;
+    int first_waiting;
+    int num_waiting;
+    int leo_item;
+    int leo_symbol;
+    int leo_origin;
+  };
+
+  // a chain Leo skips: symbol completed from origin completes the rule
+  // of item, which waits on it in set origin
+  struct leo_link_t
+  {
+    int origin;
+    int symbol;
+    int item;
+  };
+
+  // per-call state of a parse: the item sets, their links and transitions
+  // and the forest of the last parse. Leo completions are counted over
+  // every parse made with this context. One context per thread
+  struct parse_context_t
+  {
+    std::vector<int> tokens;
+    std::vector<item_t> items;
+    std::vector<std::size_t> set_begin;
+    std::vector<link_t> links;
+    std::vector<int> waiting;
+    std::vector<std::pair<int, int>> waiting_by_symbol;
+    std::vector<transition_t> transitions;
+    std::vector<std::size_t> transition_begin;
+    std::unordered_map<std::uint64_t, int> item_of;
+    std::vector<int> predicted_at;
+    std::unordered_map<std::uint64_t, std::vector<leo_link_t>> leo_links;
+
+    parse_forest_t forest;
+    bool build_forest = false;
+    bool rejected = false;
+    std::size_t leo_completions = 0;
+  };
+
+  // the interned grammar allocates from resource
+  Earley_syntax_analyser_t(const syntax_t &syntax, const symbol_t &start_symbol,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource())
+    : symbol2id(resource), id2symbol(resource), nullable(resource),
+      rule_lhs(resource), rule_dot(resource), rules_of_symbol(resource),
+      dot_rule(resource), dot_symbol(resource)
+  {
+    UTILS_TRACE_SCOPE("Earley/grammar");
+    auto add_symbol = [&](const std::string &name) {
+      auto &&[it, inserted] = symbol2id.emplace(name, id2symbol.size());
+      if (inserted)
+        id2symbol.push_back(name);
+      return it->second;
+    };
+    for (auto &&symbol : syntax.terminate_symbols())
+    {
+      if (symbol != epsilon_symbol())
+        add_symbol(symbol.symbol_id);
+    }
+    num_terminate_symbols = id2symbol.size();
+    auto non_terminate_symbols = syntax.non_terminate_symbols();
+    for (auto &&symbol : non_terminate_symbols)
+      add_symbol(symbol.symbol_id);
+    // rule 0 is the augmented rule S' -> S, never waited on, so that
+    // completing it is never skipped by a Leo chain
+    _start_id = add_symbol(start_symbol.symbol_id);
+    std::string augmented_name = start_symbol.symbol_id + "'";
+    while (symbol2id.count(augmented_name))
+      augmented_name += "'";
+    int augmented = add_symbol(augmented_name);
+    rules_of_symbol.resize(id2symbol.size());
+
+    auto add_rule = [&](int lhs, const std::vector<int> &rhs) {
+      int rule_id = rule_lhs.size();
+      rule_lhs.push_back(lhs);
+      rule_dot.push_back(dot_rule.size());
+      rules_of_symbol[lhs].push_back(rule_id);
+      for (auto symbol : rhs)
+      {
+        dot_rule.push_back(rule_id);
+        dot_symbol.push_back(symbol);
+      }
+      dot_rule.push_back(rule_id);
+      dot_symbol.push_back(-1);
+    };
+    add_rule(augmented, { _start_id });
+    std::vector<int> rhs;
+    for (auto &&symbol : non_terminate_symbols)
+    {
+      for (auto &&rule : syntax.rules(symbol))
+      {
+        rhs.clear();
+        if (!rule.is_epsilon())
+        {
+          for (auto &&rule_symbol : rule.rule_symbols)
+            rhs.push_back(symbol2id.at(rule_symbol.symbol_id));
+        }
+        add_rule(symbol2id.at(symbol.symbol_id), rhs);
+      }
+    }
+
+    // nullable symbols, till no rule adds one
+    nullable.assign(id2symbol.size(), false);
+    for (bool flag_added = true; flag_added;)
+    {
+      flag_added = false;
+      for (std::size_t rule_id = 0; rule_id < rule_lhs.size(); ++rule_id)
+      {
+        if (nullable[rule_lhs[rule_id]])
+          continue;
+        bool all_nullable = true;
+        for (int dot = rule_dot[rule_id]; dot_symbol[dot] >= 0 && all_nullable; ++dot)
+          all_nullable = nullable[dot_symbol[dot]];
+        if (all_nullable)
+          nullable[rule_lhs[rule_id]] = flag_added = true;
+      }
+    }
+  }
+
+  // id of the terminal named token_name for recognize_pull(), or
+  // unknown_terminal_id
+  int terminal_id(const std::string &token_name) const
+  {
+    auto it = symbol2id.find(token_name);
+    return (it == symbol2id.end() || it->second >= num_terminate_symbols)
+        ? unknown_terminal_id : it->second;
+  }
+
+  const std::string &symbol_name(int symbol) const
+  {
+    return id2symbol[symbol];
+  }
+
+  std::size_t num_rules() const
+  {
+    return rule_lhs.size();
+  }
+
+  // parses [it_begin, it_end) into context.forest, returns whether it is
+  // accepted
+  template <typename ForwardIterator>
+  bool analysis(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end,
+      parse_context_t &context) const
+  {
+    context.build_forest = true;
+    return _analysis(context, it_begin, it_end);
+  }
+
+  // parses [it_begin, it_end), printing the forest to std::cout
+  template <typename ForwardIterator>
+  bool analysis(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    bool is_accepted = analysis(it_begin, it_end, context);
+    context.forest.print(std::cout, [&](int symbol) -> const std::string & {
+      return symbol_name(symbol);
+    });
+    return is_accepted;
+  }
+
+  // parses [it_begin, it_end) without building a forest
+  template <typename ForwardIterator>
+  bool recognize(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    return recognize(it_begin, it_end, context);
+  }
+
+  template <typename ForwardIterator>
+  bool recognize(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end,
+      parse_context_t &context) const
+  {
+    context.build_forest = false;
+    return _analysis(context, it_begin, it_end);
+  }
+
+  // parses the terminal ids returned by next_token() until it returns
+  // end_of_input_id, without building a forest
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token) const
+  {
+    parse_context_t context;
+    return recognize_pull(next_token, context);
+  }
+
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token, parse_context_t &context) const
+  {
+    context.build_forest = false;
+    return _parse(context, next_token);
+  }
+
+private:
+  template <typename ForwardIterator>
+  bool _analysis(parse_context_t &context,
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    auto it = it_begin;
+    return _parse(context, [&]() {
+      if (it == it_end)
+        return end_of_input_id;
+      int symbol = terminal_id((*it).symbol_id);
+      ++it;
+      return symbol;
+    });
+  }
+
+  template <typename NextTerminal>
+  bool _parse(parse_context_t &context, NextTerminal &&next_terminal) const
+  {
+    UTILS_TRACE_SCOPE("Earley/parse");
+    context.tokens.clear();
+    context.items.clear();
+    context.set_begin.assign(1, 0);
+    context.links.clear();
+    context.waiting.clear();
+    context.transitions.clear();
+    context.transition_begin.assign(1, 0);
+    context.leo_links.clear();
+    context.forest.clear();
+    context.predicted_at.assign(id2symbol.size(), -1);
+    context.rejected = false;
+
+    context.item_of.clear();
+    _add_item(context, rule_dot[0], 0, -1, -1, -1);
+    for (int position = 0;; ++position)
+    {
+      _complete_set(context, position);
+      int symbol = next_terminal();
+      if (symbol == end_of_input_id)
+        break;
+      context.tokens.push_back(symbol);
+      // scan: the items of this set waiting on the token move into the next
+      context.item_of.clear();
+      context.set_begin.push_back(context.items.size());
+      auto transition = symbol < 0 ? nullptr : _find_transition(context, position, symbol);
+      if (!transition)
+      {
+        context.rejected = true;
+        return false;
+      }
+      for (int idx = 0; idx < transition->num_waiting; ++idx)
+      {
+        int item = context.waiting[transition->first_waiting + idx];
+        _add_item(context, context.items[item].dot + 1, context.items[item].origin, item, symbol, position);
+      }
+    }
+
+    int position = context.tokens.size();
+    int accepted_dot = rule_dot[0] + 1;
+    context.rejected = std::none_of(context.items.begin() + context.set_begin[position], context.items.end(),
+        [&](const item_t &item) { return item.dot == accepted_dot && item.origin == 0; });
+    if (!context.rejected && context.build_forest)
+      _build_forest(context);
+    return !context.rejected;
+  }
+
+  static std::uint64_t item_key(int dot, int origin)
+  {
+    return (std::uint64_t(dot) << 32) | std::uint32_t(origin);
+  }
+
+  // adds the item to the last set unless it is there, and the link it
+  // was reached by when building a forest
+  void _add_item(parse_context_t &context, int dot, int origin,
+      int predecessor, int symbol, int link_origin) const
+  {
+    auto &&[it, inserted] = context.item_of.try_emplace(item_key(dot, origin), (int)context.items.size());
+    if (inserted)
+      context.items.push_back(item_t { dot, origin, -1 });
+    if (!context.build_forest || predecessor < 0)
+      return;
+    auto &item = context.items[it->second];
+    for (int link = item.first_link; link >= 0; link = context.links[link].next_link)
+    {
+      auto &exist = context.links[link];
+      if (exist.predecessor == predecessor && exist.symbol == symbol && exist.origin == link_origin)
+        return;
+    }
+    context.links.push_back(link_t { predecessor, symbol, link_origin, item.first_link });
+    item.first_link = context.links.size() - 1;
+  }
+
+  const transition_t *_find_transition(const parse_context_t &context, int position, int symbol) const
+  {
+    auto begin = context.transitions.begin() + context.transition_begin[position];
+    auto end = context.transitions.begin() + context.transition_begin[position + 1];
+    auto it = std::lower_bound(begin, end, symbol,
+        [](const transition_t &transition, int symbol) { return transition.symbol < symbol; });
+    return (it != end && it->symbol == symbol) ? &*it : nullptr;
+  }
+
+  // predicts and completes the set at position till no item is added,
+  // then indexes it by the symbols its items wait on
+  void _complete_set(parse_context_t &context, int position) const
+  {
+    auto &items = context.items;
+    for (std::size_t idx = context.set_begin[position]; idx < items.size(); ++idx)
+    {
+      auto [dot, origin, first_link] = items[idx];
+      int symbol = dot_symbol[dot];
+      if (symbol < 0)
+      {
+        // nullable completions are done when predicted
+        if (origin == position)
+          continue;
+        int lhs = rule_lhs[dot_rule[dot]];
+        auto transition = _find_transition(context, origin, lhs);
+        if (!transition)
+          continue;
+        if (transition->leo_item >= 0)
+        {
+          auto &leo_item = items[transition->leo_item];
+          _add_item(context, leo_item.dot + 1, leo_item.origin,
+              transition->leo_item, transition->leo_symbol, transition->leo_origin);
+          ++context.leo_completions;
+          continue;
+        }
+        for (int idx = 0; idx < transition->num_waiting; ++idx)
+        {
+          int item = context.waiting[transition->first_waiting + idx];
+          _add_item(context, items[item].dot + 1, items[item].origin, item, lhs, origin);
+        }
+      }
+      else if (symbol >= num_terminate_symbols)
+      {
+        if (context.predicted_at[symbol] != position)
+        {
+          context.predicted_at[symbol] = position;
+          for (auto rule_id : rules_of_symbol[symbol])
+            _add_item(context, rule_dot[rule_id], position, -1, -1, -1);
+        }
+        if (nullable[symbol])
+          _add_item(context, dot + 1, origin, idx, symbol, position);
+      }
+    }
+
+    // transitions, by symbol waited on
+    std::size_t first_item = context.set_begin[position];
+    auto &waiting = context.waiting_by_symbol;
+    waiting.clear();
+    for (std::size_t idx = first_item; idx < items.size(); ++idx)
+    {
+      int symbol = dot_symbol[items[idx].dot];
+      if (symbol >= 0)
+        waiting.emplace_back(symbol, idx);
+    }
+    std::sort(waiting.begin(), waiting.end());
+    for (std::size_t idx = 0; idx < waiting.size();)
+    {
+      int symbol = waiting[idx].first;
+      transition_t transition { symbol, (int)context.waiting.size(), 0, -1, -1, -1 };
+      for (; idx < waiting.size() && waiting[idx].first == symbol; ++idx)
+      {
+        context.waiting.push_back(waiting[idx].second);
+        ++transition.num_waiting;
+      }
+      if (symbol >= num_terminate_symbols && transition.num_waiting == 1)
+        _set_leo_item(context, position, transition);
+      context.transitions.push_back(transition);
+    }
+    context.transition_begin.push_back(context.transitions.size());
+  }
+
+  // Leo's topmost item of a transition with a single item, when that item
+  // ends its rule: the topmost item of its own origin set's transition on
+  // its rule's symbol, or the item itself
+  void _set_leo_item(parse_context_t &context, int position, transition_t &transition) const
+  {
+    int item = context.waiting[transition.first_waiting];
+    int dot = context.items[item].dot;
+    if (dot_symbol[dot + 1] >= 0)
+      return;
+    int origin = context.items[item].origin;
+    int lhs = rule_lhs[dot_rule[dot]];
+    transition.leo_item = item;
+    transition.leo_symbol = transition.symbol;
+    transition.leo_origin = position;
+    // the transitions of this set are not searchable yet, a chain ends
+    // here when it comes back to it
+    if (origin < position)
+    {
+      auto above = _find_transition(context, origin, lhs);
+      if (above && above->leo_item >= 0)
+      {
+        transition.leo_item = above->leo_item;
+        transition.leo_symbol = above->leo_symbol;
+        transition.leo_origin = above->leo_origin;
+      }
+    }
+    if (context.build_forest)
+      context.leo_links[item_key(lhs, origin)].push_back(leo_link_t { position, transition.symbol, item });
+  }
+
+  // the forest of the accepted input, from the node of the start symbol
+  // over the whole input down. A node (symbol, begin, end) exists when an
+  // item of set end completes the symbol from begin, or when a chain Leo
+  // skipped does: a symbol completed from a set with a Leo item completes
+  // that item's rule as well
+  void _build_forest(parse_context_t &context) const
+  {
+    UTILS_TRACE_SCOPE("Earley/forest");
+    auto &items = context.items;
+    auto &forest = context.forest;
+    int num_sets = context.set_begin.size();
+
+    // per set, lazily: its completed items and the forest nodes ending
+    // there, by (symbol, begin); -1 for a node known not to exist, -2
+    // while it is looked for
+    struct set_index_t
+    {
+      bool built = false;
+      std::unordered_map<std::uint64_t, std::vector<int>> completed;
+      std::unordered_map<std::uint64_t, int> nodes;
+    };
+    std::vector<set_index_t> sets(num_sets);
+    auto set_index = [&](int position) -> set_index_t & {
+      auto &index = sets[position];
+      if (!index.built)
+      {
+        index.built = true;
+        std::size_t end = position + 1 < num_sets ? context.set_begin[position + 1] : items.size();
+        for (std::size_t idx = context.set_begin[position]; idx < end; ++idx)
+        {
+          if (dot_symbol[items[idx].dot] < 0)
+            index.completed[item_key(rule_lhs[dot_rule[items[idx].dot]], items[idx].origin)].push_back(idx);
+        }
+      }
+      return index;
+    };
+    auto leo_links_of = [&](std::uint64_t key) -> const std::vector<leo_link_t> * {
+      auto it = context.leo_links.find(key);
+      return it != context.leo_links.end() ? &it->second : nullptr;
+    };
+
+    std::vector<int> pending;
+    auto new_node = [&](std::uint64_t key, int end) {
+      int node = forest.add_node(key >> 32, std::uint32_t(key), end);
+      pending.push_back(node);
+      return node;
+    };
+    // the node of a nonterminal, found down the skipped chains without
+    // recursion: on the stack, each key is completed if the one above it
+    // is. A key given up while one below it is still looked for may be
+    // completed through that one, so it is looked for again next time
+    struct frame_t
+    {
+      std::uint64_t key;
+      std::size_t next;
+      bool cyclic;
+    };
+    std::vector<frame_t> stack;
+    auto find_node = [&](int symbol, int begin, int end) {
+      auto &index = set_index(end);
+      auto key = item_key(symbol, begin);
+      if (symbol < num_terminate_symbols)
+      {
+        auto &&[it, inserted] = index.nodes.try_emplace(key, -1);
+        if (inserted)
+          it->second = forest.add_node(symbol, begin, end);
+        return it->second;
+      }
+      auto it = index.nodes.find(key);
+      if (it != index.nodes.end())
+        return it->second;
+      index.nodes[key] = -2;
+      stack.push_back(frame_t { key, 0, false });
+      while (!stack.empty())
+      {
+        auto &[top, next, cyclic] = stack.back();
+        if (next == 0 && index.completed.count(top))
+        {
+          index.nodes[top] = new_node(top, end);
+          stack.pop_back();
+          break;
+        }
+        auto links = leo_links_of(top);
+        if (!links || next == links->size())
+        {
+          bool given_up = cyclic;
+          if (given_up)
+            index.nodes.erase(top);
+          else
+            index.nodes[top] = -1;
+          stack.pop_back();
+          if (given_up && !stack.empty())
+            stack.back().cyclic = true;
+          continue;
+        }
+        auto &link = (*links)[next++];
+        if (link.origin > end)
+          continue;
+        auto child = item_key(link.symbol, link.origin);
+        auto &&[child_it, inserted] = index.nodes.try_emplace(child, -2);
+        if (inserted)
+          stack.push_back(frame_t { child, 0, false });
+        else if (child_it->second >= 0)
+        {
+          index.nodes[top] = new_node(top, end);
+          stack.pop_back();
+          break;
+        }
+        else if (child_it->second == -2)
+          cyclic = true;
+      }
+      // the keys left are completed through the one found
+      for (; !stack.empty(); stack.pop_back())
+        index.nodes[stack.back().key] = new_node(stack.back().key, end);
+      auto found = index.nodes.find(key);
+      return found != index.nodes.end() ? found->second : -1;
+    };
+
+    // the children of item, in set position, for every way it was
+    // reached; the predecessors' children come first
+    std::vector<int> children;
+    auto add_families = [&](int node, int item, int position, int last_child) {
+      auto walk = [&](auto &self, int item, int position) -> void {
+        if (items[item].dot == rule_dot[dot_rule[items[item].dot]])
+        {
+          std::vector<int> family(children.rbegin(), children.rend());
+          forest.add_family(node, dot_rule[items[item].dot], family.data(), family.size());
+          return;
+        }
+        for (int link = items[item].first_link; link >= 0; link = context.links[link].next_link)
+        {
+          auto [predecessor, symbol, origin, next_link] = context.links[link];
+          int child = find_node(symbol, origin, position);
+          if (child < 0)
+            continue;
+          children.push_back(child);
+          self(self, predecessor, origin);
+          children.pop_back();
+        }
+      };
+      children.clear();
+      if (last_child >= 0)
+        children.push_back(last_child);
+      walk(walk, item, position);
+    };
+
+    int position = num_sets - 1;
+    forest.root = find_node(_start_id, 0, position);
+    while (!pending.empty())
+    {
+      int node = pending.back();
+      pending.pop_back();
+      auto [symbol, begin, end, first_family] = forest.nodes[node];
+      auto key = item_key(symbol, begin);
+      auto &index = set_index(end);
+      auto completed = index.completed.find(key);
+      if (completed != index.completed.end())
+      {
+        for (auto item : completed->second)
+          add_families(node, item, end, -1);
+      }
+      if (auto links = leo_links_of(key))
+      {
+        for (auto &&link : *links)
+        {
+          if (link.origin > end)
+            continue;
+          int child = find_node(link.symbol, link.origin, end);
+          if (child >= 0)
+            add_families(node, link.item, link.origin, child);
+        }
+      }
+    }
+  }
+
+  std::pmr::unordered_map<std::string, int> symbol2id;
+  std::pmr::vector<std::string> id2symbol;
+  int num_terminate_symbols = 0;
+  int _start_id = 0;
+  std::pmr::vector<bool> nullable;
+
+  // rules by id, rule 0 augmented; a dot is a rule with a position in it,
+  // numbered so that rule_dot[rule_id] + idx is the dot before its
+  // idx-th symbol, and dot_symbol is that symbol, -1 at the end
+  std::pmr::vector<int> rule_lhs;
+  std::pmr::vector<int> rule_dot;
+  std::pmr::vector<std::pmr::vector<int>> rules_of_symbol;
+  std::pmr::vector<int> dot_rule;
+  std::pmr::vector<int> dot_symbol;
+};
+} // namespace compiler
+
+#endif // COMPILER_SYNTAX_ANALYSIS_EARLEY_HPP
@@ -0,0 +1,493 @@
+#ifndef COMPILER_SYNTAX_ANALYSIS_GLR_HPP
+#define COMPILER_SYNTAX_ANALYSIS_GLR_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <utils/profile/trace.hpp>
+#include <compiler/parse_forest.hpp>
+#include <compiler/syntax.hpp>
+#include <compiler/syntax_analysis_lr.hpp>
+
+namespace compiler
+{
+// generalized LR parser over the tables of an LR_syntax_analyser_t, which
+// keeps every conflicting action of a grammar that is not LR(1). Where the
+// input meets no conflict it runs the plain LR loop on one stack; from a
+// conflicting table entry on, the stacks are kept in a graph-structured
+// stack, with Farshi's re-examination of reductions through each link
+// added to a merged node, until they merge back into one. The parses are
+// kept in a parse_forest_t. The LR analyser must outlive this one
+class GLR_syntax_analyser_t
+{
+  using action_t = LR_syntax_analyser_t::action_t;
+
+public:
+  // node of the graph-structured stack: an LR state at an input position
+  // with its links to the nodes below, linear while there is one path
+  // down to the bottom
+  struct gss_node_t
+  {
+    int block;
+    int position;
+    int first_link;
+    bool linear;
+  };
+
+  struct gss_link_t
+  {
+    int node;
+    int tree;
+    int next_link;
+  };
+
+  // a reduction by rule_id from node, along the paths through link only
+  // unless it is -1
+  struct reduction_t
+  {
+    int node;
+    int rule_id;
+    int link;
+  };
+
+  // per-call state of a parse: the single LR stack with the input
+  // position and forest node of every entry, the graph-structured stack
+  // while there are several, and the forest of the last parse. Tokens are
+  // counted by the mode they were parsed in over every parse made with
+  // this context. One context per thread
+  struct parse_context_t
+  {
+    std::vector<int> condition;
+    std::vector<int> positions;
+    std::vector<int> trees;
+
+    std::vector<gss_node_t> nodes;
+    std::vector<gss_link_t> links;
+    std::vector<int> frontier;
+    std::vector<int> node_of_block;
+    std::vector<reduction_t> reductions;
+    std::vector<int> path;
+    std::unordered_map<std::uint64_t, int> symbol_nodes;
+
+    parse_forest_t forest;
+    bool build_forest = false;
+    bool rejected = false;
+    std::size_t deterministic_tokens = 0;
+    std::size_t generalized_tokens = 0;
+    std::size_t max_stacks = 0;
+  };
+
+  explicit GLR_syntax_analyser_t(const LR_syntax_analyser_t &tables)
+    : _tables(tables), _any_conflicts(tables.num_conflicts() > 0)
+  {
+  }
+
+  // parses [it_begin, it_end) into context.forest, returns whether it is
+  // accepted
+  template <typename ForwardIterator>
+  bool analysis(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end,
+      parse_context_t &context) const
+  {
+    context.build_forest = true;
+    return _analysis(context, it_begin, it_end);
+  }
+
+  // parses [it_begin, it_end), printing the forest to std::cout
+  template <typename ForwardIterator>
+  bool analysis(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    bool accepted = analysis(it_begin, it_end, context);
+    context.forest.print(std::cout, [&](int symbol) -> const std::string & {
+      return _tables.symbol_name(symbol);
+    });
+    return accepted;
+  }
+
+  // parses [it_begin, it_end) without building a forest
+  template <typename ForwardIterator>
+  bool recognize(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    return recognize(it_begin, it_end, context);
+  }
+
+  template <typename ForwardIterator>
+  bool recognize(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end,
+      parse_context_t &context) const
+  {
+    context.build_forest = false;
+    return _analysis(context, it_begin, it_end);
+  }
+
+  // parses the terminal ids returned by next_token() until it returns
+  // end_of_input_id, without building a forest
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token) const
+  {
+    parse_context_t context;
+    return recognize_pull(next_token, context);
+  }
+
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token, parse_context_t &context) const
+  {
+    context.build_forest = false;
+    return _parse(context, next_token);
+  }
+
+  int terminal_id(const std::string &token_name) const
+  {
+    return _tables.terminal_id(token_name);
+  }
+
+  const LR_syntax_analyser_t &tables() const
+  {
+    return _tables;
+  }
+
+private:
+  // what pushing one token did; push_conflict when the plain LR loop
+  // stopped at a conflicting table entry
+  enum push_result_t { push_rejected = -1, push_accepted = 0, push_shifted = 1, push_conflict = 2 };
+
+  template <typename ForwardIterator>
+  bool _analysis(parse_context_t &context,
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    auto it = it_begin;
+    return _parse(context, [&]() {
+      if (it == it_end)
+        return end_of_input_id;
+      int symbol = _tables.terminal_id((*it).symbol_id);
+      ++it;
+      return symbol;
+    });
+  }
+
+  template <typename NextTerminal>
+  bool _parse(parse_context_t &context, NextTerminal &&next_terminal) const
+  {
+    UTILS_TRACE_SCOPE("GLR/parse");
+    context.condition.assign(1, 0);
+    context.positions.assign(1, 0);
+    context.trees.assign(1, -1);
+    context.nodes.clear();
+    context.links.clear();
+    context.frontier.clear();
+    context.forest.clear();
+    context.rejected = false;
+
+    for (int position = 0;; ++position)
+    {
+      int symbol = next_terminal();
+      if (symbol == end_of_input_id)
+        symbol = _tables.delimiter_id();
+      push_result_t result = symbol < 0 ? push_rejected : push_conflict;
+      if (symbol >= 0 && context.nodes.empty())
+      {
+        result = _push_deterministic(context, symbol, position);
+        if (result == push_conflict)
+          _generalize(context, position);
+        else
+          ++context.deterministic_tokens;
+      }
+      if (result == push_conflict)
+      {
+        result = _push_generalized(context, symbol, position);
+        ++context.generalized_tokens;
+      }
+      if (result != push_shifted || symbol == _tables.delimiter_id())
+      {
+        context.rejected = result != push_accepted;
+        _clear_frontier(context);
+        return !context.rejected;
+      }
+    }
+  }
+
+  // the plain LR loop on one stack, until the symbol is shifted or a
+  // conflicting table entry is met
+  push_result_t _push_deterministic(parse_context_t &context, int symbol, int position) const
+  {
+    auto &condition = context.condition;
+    auto &positions = context.positions;
+    auto &trees = context.trees;
+    auto &forest = context.forest;
+    while (true)
+    {
+      int block = condition.back();
+      if (_any_conflicts && _tables.has_conflicts(block) && _tables.find_conflicts(block, symbol))
+        return push_conflict;
+      auto op = _tables.find_action(block, symbol);
+      if (op.kind == action_t::error)
+        return push_rejected;
+      if (op.kind == action_t::shift)
+      {
+        condition.push_back(op.value);
+        if (context.build_forest)
+        {
+          positions.push_back(position + 1);
+          trees.push_back(forest.add_node(symbol, position, position + 1));
+        }
+        return push_shifted;
+      }
+      if (op.kind == action_t::accept)
+      {
+        if (context.build_forest)
+          forest.root = trees.back();
+        return push_accepted;
+      }
+      int rule_id = op.value;
+      int lhs = _tables.rule_symbol(rule_id);
+      std::size_t length = _tables.rule_symbols(rule_id).size();
+      if (context.build_forest)
+      {
+        std::size_t size = trees.size() - length;
+        int tree = forest.add_node(lhs, positions[size - 1], position);
+        forest.add_family(tree, rule_id, trees.data() + size, length);
+        trees.resize(size);
+        positions.resize(size);
+        trees.push_back(tree);
+        positions.push_back(position);
+      }
+      condition.resize(condition.size() - length);
+      int next_block = _tables.find_goto(condition.back(), lhs);
+      if (next_block < 0)
+        return push_rejected;
+      condition.push_back(next_block);
+    }
+  }
+
+  // turns the single stack into a graph-structured one, the forest nodes
+  // ending at position becoming shareable
+  void _generalize(parse_context_t &context, int position) const
+  {
+    UTILS_TRACE_SCOPE("GLR/generalize");
+    auto &nodes = context.nodes;
+    // allocated on the first conflict, most parses never need it
+    if (context.node_of_block.size() != _tables.num_states())
+      context.node_of_block.assign(_tables.num_states(), -1);
+    context.symbol_nodes.clear();
+    for (std::size_t idx = 0; idx < context.condition.size(); ++idx)
+    {
+      int node_position = context.build_forest ? context.positions[idx] : 0;
+      nodes.push_back(gss_node_t { context.condition[idx], node_position, -1, true });
+      if (idx > 0)
+        _add_link(context, idx, idx - 1, context.build_forest ? context.trees[idx] : -1);
+      if (context.build_forest && idx > 0 && node_position == position)
+      {
+        auto &tree = context.forest.nodes[context.trees[idx]];
+        context.symbol_nodes.emplace(symbol_key(tree.symbol, tree.begin), context.trees[idx]);
+      }
+    }
+    context.frontier.assign(1, nodes.size() - 1);
+    context.node_of_block[nodes.back().block] = nodes.size() - 1;
+  }
+
+  // back to the plain LR loop once one stack is left with one path down
+  void _linearize(parse_context_t &context) const
+  {
+    auto &nodes = context.nodes;
+    context.condition.clear();
+    context.positions.clear();
+    context.trees.clear();
+    for (int node = context.frontier[0]; node >= 0;)
+    {
+      int link = nodes[node].first_link;
+      context.condition.push_back(nodes[node].block);
+      context.positions.push_back(nodes[node].position);
+      context.trees.push_back(link >= 0 ? context.links[link].tree : -1);
+      node = link >= 0 ? context.links[link].node : -1;
+    }
+    std::reverse(context.condition.begin(), context.condition.end());
+    std::reverse(context.positions.begin(), context.positions.end());
+    std::reverse(context.trees.begin(), context.trees.end());
+    _clear_frontier(context);
+    nodes.clear();
+    context.links.clear();
+  }
+
+  void _clear_frontier(parse_context_t &context) const
+  {
+    for (auto node : context.frontier)
+      context.node_of_block[context.nodes[node].block] = -1;
+    context.frontier.clear();
+  }
+
+  static std::uint64_t symbol_key(int symbol, int begin)
+  {
+    return (std::uint64_t(symbol) << 32) | std::uint32_t(begin);
+  }
+
+  int _add_link(parse_context_t &context, int node, int next_node, int tree) const
+  {
+    auto &nodes = context.nodes;
+    context.links.push_back(gss_link_t { next_node, tree, nodes[node].first_link });
+    nodes[node].linear = nodes[node].first_link < 0 && nodes[next_node].linear;
+    nodes[node].first_link = context.links.size() - 1;
+    return nodes[node].first_link;
+  }
+
+  template <typename Function>
+  void for_each_action(int block, int symbol, Function &&function) const
+  {
+    auto op = _tables.find_action(block, symbol);
+    if (op.kind == action_t::error)
+      return;
+    function(op);
+    if (auto conflicts = _tables.find_conflicts(block, symbol))
+    {
+      for (auto other : *conflicts)
+        function(other);
+    }
+  }
+
+  // queues the reductions of node on symbol, only those with a path to
+  // walk when restricted to link
+  void _enqueue_reductions(parse_context_t &context, int node, int symbol, int link) const
+  {
+    for_each_action(context.nodes[node].block, symbol, [&](action_t op) {
+      if (op.kind == action_t::reduce && (link < 0 || !_tables.rule_symbols(op.value).empty()))
+        context.reductions.push_back(reduction_t { node, op.value, link });
+    });
+  }
+
+  // one token on the graph-structured stack: every reduction of every
+  // stack, then the shifts
+  push_result_t _push_generalized(parse_context_t &context, int symbol, int position) const
+  {
+    auto &nodes = context.nodes;
+    auto &frontier = context.frontier;
+    auto &forest = context.forest;
+    context.reductions.clear();
+    for (auto node : frontier)
+      _enqueue_reductions(context, node, symbol, -1);
+    for (std::size_t idx = 0; idx < context.reductions.size(); ++idx)
+      _reduce(context, context.reductions[idx], symbol, position);
+    context.max_stacks = std::max(context.max_stacks, frontier.size());
+
+    bool is_accepted = false;
+    std::vector<std::pair<int, int>> shifts;
+    for (auto node : frontier)
+    {
+      for_each_action(nodes[node].block, symbol, [&](action_t op) {
+        if (op.kind == action_t::shift)
+          shifts.emplace_back(node, op.value);
+        else if (op.kind == action_t::accept && !is_accepted)
+        {
+          is_accepted = true;
+          if (context.build_forest)
+            forest.root = context.links[nodes[node].first_link].tree;
+        }
+      });
+    }
+    if (is_accepted)
+      return push_accepted;
+
+    _clear_frontier(context);
+    context.symbol_nodes.clear();
+    int tree = context.build_forest ? forest.add_node(symbol, position, position + 1) : -1;
+    for (auto &&[node, next_block] : shifts)
+    {
+      int next_node = context.node_of_block[next_block];
+      if (next_node < 0)
+      {
+        next_node = nodes.size();
+        nodes.push_back(gss_node_t { next_block, position + 1, -1, true });
+        context.node_of_block[next_block] = next_node;
+        frontier.push_back(next_node);
+      }
+      _add_link(context, next_node, node, tree);
+    }
+    if (frontier.empty())
+      return push_rejected;
+    if (frontier.size() == 1 && nodes[frontier[0]].linear)
+      _linearize(context);
+    return push_shifted;
+  }
+
+  void _reduce(parse_context_t &context, reduction_t reduction, int symbol, int position) const
+  {
+    auto &nodes = context.nodes;
+    auto &links = context.links;
+    auto &path = context.path;
+    int rule_id = reduction.rule_id;
+    int lhs = _tables.rule_symbol(rule_id);
+    int length = _tables.rule_symbols(rule_id).size();
+    path.resize(length);
+
+    // the end of a path: the tree of the reduction and the goto from it
+    auto reduce_path = [&](int next_node) {
+      int tree = -1;
+      if (context.build_forest)
+      {
+        auto &&[it, inserted] = context.symbol_nodes.try_emplace(
+            symbol_key(lhs, nodes[next_node].position), (int)context.forest.nodes.size());
+        if (inserted)
+          context.forest.add_node(lhs, nodes[next_node].position, position);
+        tree = it->second;
+        context.forest.add_family(tree, rule_id, path.data(), length);
+      }
+      int next_block = _tables.find_goto(nodes[next_node].block, lhs);
+      if (next_block < 0)
+        return;
+      int node = context.node_of_block[next_block];
+      if (node < 0)
+      {
+        node = nodes.size();
+        nodes.push_back(gss_node_t { next_block, position, -1, true });
+        context.node_of_block[next_block] = node;
+        context.frontier.push_back(node);
+        _add_link(context, node, next_node, tree);
+        _enqueue_reductions(context, node, symbol, -1);
+        return;
+      }
+      for (int link = nodes[node].first_link; link >= 0; link = links[link].next_link)
+      {
+        if (links[link].node == next_node)
+          return;
+      }
+      // a new path under a node whose reductions are queued already: the
+      // reductions of every stack are walked again through the new link.
+      // The stacks above it are no longer linear either
+      int link = _add_link(context, node, next_node, tree);
+      for (auto frontier_node : context.frontier)
+      {
+        nodes[frontier_node].linear = false;
+        _enqueue_reductions(context, frontier_node, symbol, link);
+      }
+    };
+
+    // the paths of length links down from the node, children in input order
+    auto walk = [&](auto &self, int node, int depth, bool through_link) -> void {
+      if (depth == length)
+      {
+        if (reduction.link < 0 || through_link)
+          reduce_path(node);
+        return;
+      }
+      for (int link = nodes[node].first_link; link >= 0; link = links[link].next_link)
+      {
+        path[length - 1 - depth] = links[link].tree;
+        self(self, links[link].node, depth + 1, through_link || link == reduction.link);
+      }
+    };
+    walk(walk, reduction.node, 0, false);
+  }
+
+  const LR_syntax_analyser_t &_tables;
+  // false for LR(1) grammars, whose parses never leave the plain loop
+  bool _any_conflicts;
+};
+} // namespace compiler
+
+#endif // COMPILER_SYNTAX_ANALYSIS_GLR_HPP
@@ -1,30 +1,127 @@
 #ifndef COMPILER_SYNTAX_ANALYSIS_LR_HPP
 #define COMPILER_SYNTAX_ANALYSIS_LR_HPP
 
+#include <algorithm>
 #include <iostream>
-#include <stack>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
 #include <unordered_set>
 #include <unordered_map>
+#include <vector>
 
+#include <utils/concurrency/sharded_map.hpp>
+#include <utils/concurrency/work_stealing_pool.hpp>
+#include <utils/container/comb_vector.hpp>
+#include <utils/container/dynamic_bitset.hpp>
+#include <utils/hash/xxhash64.hpp>
+#include <utils/profile/counters.hpp>
+#include <utils/profile/trace.hpp>
 #include <compiler/syntax.hpp>
 
 namespace compiler
 {
 class LR_syntax_analyser_t
 {
+  // LR(1) item packed as rule id (24 bits), dot (8 bits), lookahead (32 bits)
+  using item_t = std::uint64_t;
+  static constexpr std::size_t max_item_rules = std::size_t(1) << 24;
+  static constexpr std::size_t max_item_index = 0xff;
+
+  struct kernel_hash
+  {
+    std::size_t operator()(const std::pmr::vector<item_t> &kernel) const
+    {
+      std::size_t result = kernel.size();
+      for (auto item : kernel)
+        result ^= std::hash<item_t>()(item) + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+      return result;
+    }
+  };
+
+public:
+  struct action_t
+  {
+    enum kind_t : std::uint8_t { error, shift, reduce, accept } kind;
+    int value;
+  };
+
+private:
+  // item set kernels, deduplicated by every exploring thread at once, to
+  // their state number (-1 until numbered)
+  using kernel_table_t = utils::concurrency::sharded_map_t<std::pmr::vector<item_t>, int, kernel_hash>;
+  using kernel_entry_t = kernel_table_t::value_type;
+
+  // what exploring one item set yields: its reductions, the actions that
+  // conflict with them and, in order of first appearance, the symbols it
+  // moves on with their kernels
+  struct block_result_t
+  {
+    std::vector<std::pair<int, action_t>> action_row;
+    std::vector<std::pair<int, action_t>> conflicts;
+    std::vector<std::pair<int, kernel_entry_t *>> successors;
+  };
+
+  // breadth-first levels smaller than this are explored on the calling
+  // thread
+  static constexpr std::size_t min_parallel_level = 64;
+
 public:
-  LR_syntax_analyser_t(const syntax_t &syntax, const symbol_t &start_symbol)
-    : _is_valid(true), _syntax(syntax), _start_symbol(start_symbol)
+  // how the tables are finished once built
+  struct options_t
+  {
+    // skip the reductions by chain rules where the tables allow it, but
+    // not those of keep_symbols; see chain_elimination()
+    bool eliminate_chain_rules = false;
+    std::unordered_set<std::string> keep_symbols;
+    // pack the tables the way yacc and bison do, see table_size()
+    bool compress = false;
+  };
+
+  // the grammar copy, the tables and the kernels of the item sets
+  // allocate from resource, scratch space of the construction does not.
+  // The item sets are explored on up to num_threads threads; the tables
+  // do not depend on it. Throws std::length_error for a grammar whose
+  // items do not fit item_t: more than 2^24 rules, or a rule longer than
+  // 255 symbols
+  LR_syntax_analyser_t(const syntax_t &syntax, const symbol_t &start_symbol,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      std::size_t num_threads = std::thread::hardware_concurrency())
+    : LR_syntax_analyser_t(syntax, start_symbol, options_t(), resource, num_threads)
+  {
+  }
+
+  LR_syntax_analyser_t(const syntax_t &syntax, const symbol_t &start_symbol,
+      const options_t &options,
+      std::pmr::memory_resource *resource = std::pmr::get_default_resource(),
+      std::size_t num_threads = std::thread::hardware_concurrency())
+    : _is_valid(true), _syntax(syntax, resource), _start_symbol(start_symbol),
+      _first_set(resource), id2rule(resource), rule2id(resource),
+      symbol2id(resource), id2symbol(resource),
+      rule_lhs(resource), rule_rhs(resource), rules_of_symbol(resource),
+      suffix_first(resource), suffix_nullable(resource),
+      ACTION(resource), GOTO(resource), _conflicts(resource), _conflict_blocks(resource),
+      _action_default(resource), _action_error_row(resource), _action_valid(resource),
+      _action_comb(resource), _goto_default(resource), _goto_comb(resource)
   {
-    
     _build_first_set();
     get_all_rules();
-    get_item();
+    get_item(num_threads);
+    if (options.eliminate_chain_rules && _is_valid)
+      _chain_elimination = _eliminate_chain_rules(options.keep_symbols);
+    if (options.compress)
+      _compress();
   }
 
-  auto get_first_set(symbol_t symbol)
+  // the getters and the parse functions are const and keep no state in the
+  // analyser, so one analyser can serve any number of threads
+  std::pmr::unordered_set<symbol_t> get_first_set(const symbol_t &symbol) const
   {
-    auto first_set = _first_set[symbol];
+    auto it = _first_set.find(symbol);
+    auto first_set = it != _first_set.end() ? it->second : std::pmr::unordered_set<symbol_t>();
     if (symbol == epsilon_symbol())
     {
       first_set.insert(epsilon_symbol());
@@ -35,14 +132,9 @@ public:
     return first_set;
   }
 
-  auto actions()
-  {
-    return ACTION;
-  }
-
   template <typename ForwardIterator>
   auto get_first_set(
-      ForwardIterator it_begin, ForwardIterator it_end)
+      ForwardIterator it_begin, ForwardIterator it_end) const
   {
     symbol_t epsilon = epsilon_symbol();
     std::unordered_set<symbol_t> first_set;
@@ -71,24 +163,40 @@ public:
     return first_set;
   }
 
-  auto terminate_symbols()
+  auto terminate_symbols() const
   {
     return _syntax.terminate_symbols();
   }
 
-  auto non_terminate_symbols()
+  auto non_terminate_symbols() const
   {
     return _syntax.non_terminate_symbols();
   }
 
-  auto rules(symbol_t symbol)
+  auto rules(const symbol_t &symbol) const
   {
     return _syntax.rules(symbol);
   }
 
+  // per-call state of a parse, so that the analyser itself is never
+  // written to: the state stack, whether the input was rejected, the
+  // reductions made by every parse with this context and the states
+  // consulted for an action and reductions by rule id, counted only with
+  // UTILS_PROFILE_ENABLE_COUNTERS. One context per thread; it can be
+  // reused by push_start(context) without reallocating the stack
+  struct parse_context_t
+  {
+    std::vector<int> condition;
+    bool rejected = false;
+    std::size_t reductions = 0;
+    utils::profile::counter_table_t state_counters;
+    utils::profile::counter_table_t reduction_counters;
+  };
+
 private:
   void _build_first_set()
   {
+    UTILS_TRACE_SCOPE("LR/first_set");
     symbol_t epsilon = epsilon_symbol();
 
     // X is a ternimate symbol
@@ -117,28 +225,31 @@ private:
           else
           {
             // X -> Y_1 Y_2 ... Y_k (k >= 1)
+            bool flag_all_contain_epsilon = true;
             for (auto &&Yi : rule.rule_symbols)
             {
               // FIRST[Y_1] ... FIRST[Y_{i-1}] all contain epsilon, add
-              // all symbols in FIRST[Y_i] into FIRST[X]
+              // all symbols in FIRST[Y_i] but epsilon into FIRST[X]
               for (auto &&exist_symbol : _first_set[Yi])
               {
+                if (exist_symbol == epsilon)
+                  continue;
                 auto &&[_, inserted] = _first_set[X].insert(exist_symbol);
-                if (!inserted)
-                {
-                  break;
-                }
-                else
-                {
-                  flag_added = true;
-                }
+                flag_added |= inserted;
               }
               // FIRST[Y_i] doesn't contain epsilon
               if (_first_set[Yi].count(epsilon) == 0)
               {
+                flag_all_contain_epsilon = false;
                 break;
               }
             }
+            // every Y_i derives epsilon
+            if (flag_all_contain_epsilon)
+            {
+              auto &&[_, inserted] = _first_set[X].insert(epsilon);
+              flag_added |= inserted;
+            }
           }
         }
       }
@@ -148,7 +259,11 @@ private:
 
   void get_all_rules()
   {
-    int cnt = 0, tot = 0;
+    // rule 0 is the augmented rule S' -> S, reducing it accepts the input
+    std::vector<std::string> augmented_rule { _start_symbol.symbol_id };
+    id2rule.emplace(0, production_rule_t(
+        _start_symbol.symbol_id + "'", augmented_rule.begin(), augmented_rule.end()));
+    int cnt = 0;
     auto _non_terminate_symbols = non_terminate_symbols();
     for (auto &&symbol : _non_terminate_symbols)
     {
@@ -161,146 +276,718 @@ private:
     }
   }
 
-  auto get_closure(int number)
+  int add_symbol(const symbol_t &symbol)
   {
-    for (bool flag = true; flag;)
+    auto &&[it, inserted] = symbol2id.emplace(symbol.symbol_id, id2symbol.size());
+    if (inserted)
+      id2symbol.push_back(symbol);
+    return it->second;
+  }
+
+  // interns symbols (terminals, $ included, before non-terminals) and
+  // rules, and precomputes FIRST and nullability of every rule suffix
+  void build_symbol_tables()
+  {
+    UTILS_TRACE_SCOPE("LR/symbol_tables");
+    for (auto &&symbol : terminate_symbols())
     {
-      flag = false;
-      for (auto p : project[number])
+      if (symbol != epsilon_symbol())
+        add_symbol(symbol);
+    }
+    _delimiter_id = add_symbol(delimiter_symbol());
+    num_terminate_symbols = id2symbol.size();
+    for (auto &&symbol : non_terminate_symbols())
+      add_symbol(symbol);
+    add_symbol(id2rule.at(0).symbol);
+
+    if (id2rule.size() > max_item_rules)
+      throw std::length_error("LR_syntax_analyser_t: more than 2^24 rules");
+    int num_rules = id2rule.size();
+    rule_lhs.resize(num_rules);
+    rule_rhs.resize(num_rules);
+    rules_of_symbol.resize(id2symbol.size());
+    suffix_first.resize(num_rules);
+    suffix_nullable.resize(num_rules);
+    for (int rule_id = 0; rule_id < num_rules; ++rule_id)
+    {
+      auto &rule = id2rule.at(rule_id);
+      rule_lhs[rule_id] = symbol2id.at(rule.symbol.symbol_id);
+      rules_of_symbol[rule_lhs[rule_id]].push_back(rule_id);
+      if (!rule.is_epsilon())
       {
-        bool flag = false;
-        int rule_id = p.first;
-        int idx = p.second.first;
-        if (idx == id2rule[rule_id].rule_symbols.size()) 
-          break;
-        symbol_t next = symbol_t(p.second.second);
-        std::vector<symbol_t> vec;
-        if (id2rule[rule_id].rule_symbols[idx].is_terminate)
-          continue;
-        vec.emplace_back(id2rule[rule_id].rule_symbols[idx]);
-        vec.emplace_back(next);
-        auto first_set = get_first_set(vec.begin(), vec.end());
-        for (auto &&ru : rules(id2rule[rule_id].rule_symbols[idx]))
+        for (auto &&rule_symbol : rule.rule_symbols)
+          rule_rhs[rule_id].push_back(add_symbol(rule_symbol));
+      }
+      if (rule_rhs[rule_id].size() > max_item_index)
+        throw std::length_error("LR_syntax_analyser_t: a rule is longer than 255 symbols");
+    }
+
+    for (int rule_id = 0; rule_id < num_rules; ++rule_id)
+    {
+      auto &rule = id2rule.at(rule_id);
+      int length = rule_rhs[rule_id].size();
+      // FIRST(X_{idx+1} ... X_n) for the item A -> X_1 ... X_idx . X_{idx+1} ... X_n
+      for (int idx = 0; idx <= length; ++idx)
+      {
+        utils::container::dynamic_bitset_t first(num_terminate_symbols);
+        bool nullable = true;
+        if (idx < length)
         {
-          auto y = rule2id[ru];
+          auto first_set = get_first_set(rule.rule_symbols.begin() + idx + 1, rule.rule_symbols.end());
           for (auto &&symbol : first_set)
-            _project[number].push_back({y, {0, symbol.symbol_id}});
-          flag = true;
+          {
+            if (symbol != epsilon_symbol())
+              first.set(symbol2id.at(symbol.symbol_id));
+          }
+          nullable = first_set.count(epsilon_symbol()) > 0;
         }
+        suffix_first[rule_id].push_back(std::move(first));
+        suffix_nullable[rule_id].push_back(nullable);
+      }
+    }
+  }
+
+  static item_t make_item(int rule_id, int idx, int lookahead)
+  {
+    return (item_t(rule_id) << 40) | (item_t(idx) << 32) | item_t(lookahead);
+  }
+
+  static int item_rule(item_t item)
+  {
+    return item >> 40;
+  }
+
+  static int item_index(item_t item)
+  {
+    return (item >> 32) & 0xff;
+  }
+
+  static int item_lookahead(item_t item)
+  {
+    return item & 0xffffffff;
+  }
+
+  // LR(1) closure of a kernel, grouped as (rule id, dot) -> lookaheads
+  std::vector<std::pair<std::pair<int, int>, utils::container::dynamic_bitset_t>>
+  get_closure(const std::pmr::vector<item_t> &kernel) const
+  {
+    std::vector<std::pair<std::pair<int, int>, utils::container::dynamic_bitset_t>> closure;
+    std::map<std::pair<int, int>, std::size_t> index;
+    std::vector<std::size_t> worklist;
+    auto add_items = [&](int rule_id, int idx, const utils::container::dynamic_bitset_t &lookaheads) {
+      auto &&[it, inserted] = index.emplace(std::make_pair(rule_id, idx), closure.size());
+      if (inserted)
+      {
+        closure.emplace_back(std::make_pair(rule_id, idx), lookaheads);
+        worklist.push_back(it->second);
+        return;
+      }
+      auto &exist_lookaheads = closure[it->second].second;
+      auto before = exist_lookaheads;
+      exist_lookaheads |= lookaheads;
+      if (exist_lookaheads != before)
+        worklist.push_back(it->second);
+    };
+
+    for (auto item : kernel)
+    {
+      utils::container::dynamic_bitset_t lookaheads(num_terminate_symbols);
+      lookaheads.set(item_lookahead(item));
+      add_items(item_rule(item), item_index(item), lookaheads);
+    }
+    while (!worklist.empty())
+    {
+      auto idx_item = worklist.back();
+      worklist.pop_back();
+      int rule_id = closure[idx_item].first.first;
+      int idx = closure[idx_item].first.second;
+      if (idx == (int)rule_rhs[rule_id].size() || rule_rhs[rule_id][idx] < num_terminate_symbols)
+        continue;
+      // A -> a . B b, c: add B -> . g, d for every d in FIRST(b c)
+      auto lookaheads = suffix_first[rule_id][idx];
+      if (suffix_nullable[rule_id][idx])
+        lookaheads |= closure[idx_item].second;
+      for (auto y : rules_of_symbol[rule_rhs[rule_id][idx]])
+        add_items(y, 0, lookaheads);
+    }
+    return closure;
+  }
+
+  // keeps the first action set on symbol, the conflicting ones that
+  // follow go to conflicts once each
+  static void set_action(std::vector<std::pair<int, action_t>> &row,
+      std::vector<std::pair<int, action_t>> &conflicts, int symbol, action_t action)
+  {
+    auto same_action = [&](const std::pair<int, action_t> &entry) {
+      return entry.first == symbol && entry.second.kind == action.kind && entry.second.value == action.value;
+    };
+    for (auto &entry : row)
+    {
+      if (entry.first != symbol)
+        continue;
+      if (!same_action(entry) && std::none_of(conflicts.begin(), conflicts.end(), same_action))
+        conflicts.emplace_back(symbol, action);
+      return;
+    }
+    row.emplace_back(symbol, action);
+  }
+
+  // closure of one item set: its reductions go to result, its successor
+  // kernels into kernels; safe to run on several item sets at once
+  void explore_block(const std::pmr::vector<item_t> &kernel, kernel_table_t &kernels,
+      block_result_t &result) const
+  {
+    std::vector<int> next_symbols;
+    std::unordered_map<int, std::pmr::vector<item_t>> next_kernels;
+    result.action_row.clear();
+    result.conflicts.clear();
+    result.successors.clear();
+    for (auto &&[core, lookaheads] : get_closure(kernel))
+    {
+      auto [rule_id, idx] = core;
+      if (idx == (int)rule_rhs[rule_id].size())
+      {
+        // reduce, or accept on the augmented rule
+        lookaheads.for_each([&, rule_id = rule_id](std::size_t lookahead) {
+          set_action(result.action_row, result.conflicts, lookahead, rule_id == 0
+              ? action_t { action_t::accept, 0 } : action_t { action_t::reduce, rule_id });
+        });
       }
-      for (auto p : _project[number])
+      else
       {
-        project[number].push_back(p);
+        int next = rule_rhs[rule_id][idx];
+        auto &next_kernel = next_kernels[next];
+        if (next_kernel.empty())
+          next_symbols.push_back(next);
+        lookaheads.for_each([&, rule_id = rule_id, idx = idx](std::size_t lookahead) {
+          next_kernel.push_back(make_item(rule_id, idx + 1, lookahead));
+        });
       }
-      _project[number].clear();
     }
-    return project[number];
+    for (auto next : next_symbols)
+    {
+      auto &next_kernel = next_kernels[next];
+      std::sort(next_kernel.begin(), next_kernel.end());
+      result.successors.emplace_back(next, kernels.try_emplace(std::move(next_kernel), -1).first);
+    }
   }
 
-  void get_item()
+  // canonical collection of LR(1) item sets, states are numbered in
+  // breadth-first order with successors in order of first appearance.
+  // Each breadth-first level is explored in parallel; the new item sets it
+  // finds are then numbered on this thread in the order the sequential
+  // walk would meet them, so the tables do not depend on the schedule
+  void get_item(std::size_t num_threads)
   {
-    int block = 0 ,tot = 0;
-    int start = rule2id[rules(_start_symbol).front()];
-    project[block].push_back({start, {0, delimiter_symbol().symbol_id}});
-    get_closure(block);
-    for (; block <= tot; block++)
+    UTILS_TRACE_SCOPE("LR/item_sets");
+    build_symbol_tables();
+
+    // kernels are stored once, as keys of the dedup table
+    kernel_table_t kernels(64, ACTION.get_allocator().resource());
+    std::vector<const std::pmr::vector<item_t> *> kernel_of_block;
+    auto number_block = [&](kernel_entry_t *entry) {
+      if (entry->second < 0)
+      {
+        entry->second = kernel_of_block.size();
+        kernel_of_block.push_back(&entry->first);
+        ACTION.emplace_back();
+        GOTO.emplace_back();
+        ++_num_states;
+      }
+      return entry->second;
+    };
+    number_block(kernels.try_emplace(
+        std::pmr::vector<item_t> { make_item(0, 0, symbol2id.at(delimiter_symbol().symbol_id)) }, -1).first);
+
+    std::unique_ptr<utils::concurrency::work_stealing_pool_t> pool;
+    std::vector<block_result_t> results;
+    std::vector<std::pair<int, int>> goto_row;
+    for (std::size_t level_begin = 0, level_end; level_begin < kernel_of_block.size(); level_begin = level_end)
     {
-      get_closure(block);
-      for (auto x : terminate_symbols())
+      level_end = kernel_of_block.size();
+      results.resize(level_end - level_begin);
+      auto explore = [&](std::size_t begin, std::size_t end) {
+        for (auto block = begin; block < end; ++block)
+          explore_block(*kernel_of_block[block], kernels, results[block - level_begin]);
+      };
+      if (num_threads > 1 && level_end - level_begin >= min_parallel_level)
       {
-        for (auto y : project[block])
+        UTILS_TRACE_SCOPE("LR/item_sets_level");
+        if (!pool)
+          pool = std::make_unique<utils::concurrency::work_stealing_pool_t>(num_threads);
+        // a few chunks per thread, stealing evens out uneven closures
+        std::size_t chunk = std::max<std::size_t>((level_end - level_begin) / (pool->size() * 8), 1);
+        for (auto begin = level_begin; begin < level_end; begin += chunk)
         {
-          int rule_id = y.first;
-          int idx = y.second.first;
-          symbol_t next = symbol_t(y.second.second);
-          int sz = id2rule[rule_id].rule_symbols.size();
-          if (idx == sz)
-          {
-            // action
-            ACTION[std::make_pair(block, next.symbol_id)] = std::make_pair("r", rule_id);
-
-          } else {
-            // yiru
-            ACTION[std::make_pair(block, next.symbol_id)] = std::make_pair("s", tot + 1);
-            project[++tot].push_back({rule_id, {idx + 1, y.second.second}});
-          } 
+          pool->submit([&, begin, chunk](std::size_t) {
+            explore(begin, std::min(begin + chunk, level_end));
+          });
         }
+        pool->wait();
+      }
+      else
+      {
+        explore(level_begin, level_end);
       }
-      for (auto x : non_terminate_symbols())
+
+      // rows are collected in scratch vectors and copied once, at their
+      // final size, into the tables
+      for (auto block = level_begin; block < level_end; ++block)
       {
-        for (auto y : project[block])
+        auto &result = results[block - level_begin];
+        goto_row.clear();
+        for (auto &&[next, entry] : result.successors)
         {
-          int rule_id = y.first;
-          int idx = y.second.first;
-          symbol_t next = symbol_t(y.second.second);
-          int sz = id2rule[rule_id].rule_symbols.size();
-          if (idx == sz) {
-            // action
-            ACTION[std::make_pair(block, next.symbol_id)] = std::make_pair("r", rule_id);
-          } else {
-            // yiru
-            GOTO[std::make_pair(block, x.symbol_id)] = tot + 1;
-            project[++tot].push_back({rule_id, {idx + 1, y.second.second}});
-          }
+          int next_block = number_block(entry);
+          if (next >= num_terminate_symbols)
+            goto_row.emplace_back(next, next_block);
+          else
+            set_action(result.action_row, result.conflicts, next, action_t { action_t::shift, next_block });
+        }
+        for (auto &&[symbol, action] : result.conflicts)
+        {
+          _is_valid = false;
+          _conflicts[conflict_key(block, symbol)].push_back(action);
         }
+        auto &action_row = result.action_row;
+        std::sort(action_row.begin(), action_row.end(),
+            [](auto &lhs, auto &rhs) { return lhs.first < rhs.first; });
+        std::sort(goto_row.begin(), goto_row.end());
+        ACTION[block].assign(action_row.begin(), action_row.end());
+        GOTO[block].assign(goto_row.begin(), goto_row.end());
+      }
+    }
+    _conflict_blocks.assign(_num_states, false);
+    for (auto &&[key, actions] : _conflicts)
+      _conflict_blocks[key >> 32] = true;
+  }
+
+  static std::uint64_t conflict_key(int block, int symbol)
+  {
+    return (std::uint64_t(block) << 32) | std::uint32_t(symbol);
+  }
+
+  // compressed ACTION entries: the kind in the low two bits, the state or
+  // rule above, so that 0 is the error entry
+  static int encode_action(action_t action)
+  {
+    return (action.value << 2) | action.kind;
+  }
+
+  static action_t decode_action(int code)
+  {
+    return action_t { action_t::kind_t(code & 3), code >> 2 };
+  }
+
+public:
+  // table access for drivers other than the LR loop below, such as
+  // GLR_syntax_analyser_t. Symbols are the interned ids, terminals below
+  // num_terminals(); rules are numbered from 1, rule 0 being the augmented
+  // start rule
+
+  // action of block on terminal symbol, of kind error if there is none;
+  // the first one set where the grammar has a conflict
+  action_t find_action(int block, int symbol) const
+  {
+    if (_compressed)
+    {
+      int row = _action_error_row[block];
+      if (row >= 0)
+      {
+        std::size_t bit = std::size_t(row) * num_terminate_symbols + symbol;
+        if (!((_action_valid[bit / 64] >> (bit % 64)) & 1))
+          return action_t { action_t::error, 0 };
+      }
+      return decode_action(_action_comb.find(block, symbol, _action_default[block]));
+    }
+    auto &row = ACTION[block];
+    auto it = std::lower_bound(row.begin(), row.end(), symbol,
+        [](auto &entry, int symbol) { return entry.first < symbol; });
+    return (it != row.end() && it->first == symbol) ? it->second : action_t { action_t::error, 0 };
+  }
+
+  int find_goto(int block, int symbol) const
+  {
+    if (_compressed)
+    {
+      int column = symbol - num_terminate_symbols;
+      return _goto_comb.find(block, column, _goto_default[column]);
+    }
+    auto &row = GOTO[block];
+    auto it = std::lower_bound(row.begin(), row.end(), std::make_pair(symbol, 0));
+    return (it != row.end() && it->first == symbol) ? it->second : -1;
+  }
+
+  // the other actions of block on terminal symbol, nullptr if there are
+  // none; only grammars that are not LR(1) have any
+  const std::pmr::vector<action_t> *find_conflicts(int block, int symbol) const
+  {
+    if (!_conflict_blocks[block])
+      return nullptr;
+    auto it = _conflicts.find(conflict_key(block, symbol));
+    return it != _conflicts.end() ? &it->second : nullptr;
+  }
+
+  bool has_conflicts(int block) const
+  {
+    return _conflict_blocks[block];
+  }
+
+  // table entries holding more than one action
+  std::size_t num_conflicts() const
+  {
+    return _conflicts.size();
+  }
+
+  int num_terminals() const
+  {
+    return num_terminate_symbols;
+  }
+
+  int delimiter_id() const
+  {
+    return _delimiter_id;
+  }
+
+  const std::string &symbol_name(int symbol) const
+  {
+    return id2symbol[symbol].symbol_id;
+  }
+
+  int rule_symbol(int rule_id) const
+  {
+    return rule_lhs[rule_id];
+  }
+
+  const std::pmr::vector<int> &rule_symbols(int rule_id) const
+  {
+    return rule_rhs[rule_id];
+  }
+
+private:
+
+  // runs the automaton on one terminal id, returns 1 when the symbol is
+  // shifted, 0 on accept and -1 on error
+  int _push(std::ostream *out_stream, parse_context_t &context, int symbol) const
+  {
+    auto &condition = context.condition;
+    while (true)
+    {
+      UTILS_PROFILE_COUNT(context.state_counters, condition.back());
+      auto op = symbol < 0 ? action_t { action_t::error, 0 } : find_action(condition.back(), symbol);
+      if (op.kind == action_t::error)
+      {
+        if (out_stream)
+          *out_stream << "error" << "\n";
+        return -1;
+      }
+      if (op.kind == action_t::shift)
+      {
+        if (out_stream)
+          *out_stream << "s" << " " << op.value << "\n";
+        condition.push_back(op.value);
+        return 1;
+      }
+      if (op.kind == action_t::accept)
+      {
+        if (out_stream)
+          *out_stream << "acc" << "\n";
+        return 0;
+      }
+      if (out_stream)
+        *out_stream << "r" << " " << op.value << "\n";
+      int rule_id = op.value;
+      ++context.reductions;
+      UTILS_PROFILE_COUNT(context.reduction_counters, rule_id);
+      condition.resize(condition.size() - rule_rhs[rule_id].size());
+      int next_block = find_goto(condition.back(), rule_lhs[rule_id]);
+      if (next_block < 0)
+      {
+        if (out_stream)
+          *out_stream << "error" << "\n";
+        return -1;
       }
+      condition.push_back(next_block);
     }
   }
 
+  // parses the terminal ids returned by next_terminal() until it returns
+  // end_of_input_id, printing every action to out_stream if given
+  template <typename NextTerminal>
+  bool _parse(std::ostream *out_stream, parse_context_t &context, NextTerminal &&next_terminal) const
+  {
+    UTILS_TRACE_SCOPE("LR/parse");
+    push_start(context);
+    for (int symbol = next_terminal(); symbol != end_of_input_id; symbol = next_terminal())
+    {
+      if (_push(out_stream, context, symbol) != 1)
+      {
+        context.rejected = true;
+        return false;
+      }
+    }
+    context.rejected = _push(out_stream, context, _delimiter_id) != 0;
+    return !context.rejected;
+  }
+
+  template <typename ForwardIterator>
+  bool _analysis(std::ostream *out_stream, parse_context_t &context,
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    auto it = it_begin;
+    return _parse(out_stream, context, [&]() {
+      if (it == it_end)
+        return end_of_input_id;
+      int symbol = terminal_id((*it).symbol_id);
+      ++it;
+      return symbol;
+    });
+  }
+
 public:
   explicit operator bool() const
   {
     return _is_valid;
   }
 
-  template <typename ForwardIterator>
-  void analysis(
-      const ForwardIterator &it_begin, const ForwardIterator &it_end)
+  // id of the terminal named token_name for recognize_pull(), or
+  // unknown_terminal_id
+  int terminal_id(const std::string &token_name) const
+  {
+    auto it = symbol2id.find(token_name);
+    return (it == symbol2id.end() || it->second >= num_terminate_symbols)
+        ? unknown_terminal_id : it->second;
+  }
+
+  std::size_t num_states() const
   {
-    std::stack<symbol_t> symbols;
-    std::stack<int> condition;
-    symbols.push(delimiter_symbol());
-    condition.push(0);
-    
+    return _num_states;
+  }
 
-    auto match_or_output = [&](symbol_t terminate_symbol) {  
-      while (!symbols.empty())
+  // hash of the ACTION and GOTO tables, rules and terminal names, equal for
+  // analysers that accept the same token ids alike, compressed or not
+  std::uint64_t fingerprint() const
+  {
+    if (_compressed)
+      return _fingerprint;
+    std::uint64_t hash = utils::hash::xxhash64(rule_lhs, num_terminate_symbols);
+    for (int symbol = 0; symbol < num_terminate_symbols; ++symbol)
+    {
+      auto &name = id2symbol[symbol].symbol_id;
+      hash = utils::hash::xxhash64(name.data(), name.size() + 1, hash);
+    }
+    for (auto &&rhs : rule_rhs)
+    {
+      std::size_t size = rhs.size();
+      hash = utils::hash::xxhash64(rhs, utils::hash::xxhash64(&size, sizeof(size), hash));
+    }
+    // action_t has padding, so rows are flattened first
+    std::vector<int> row;
+    for (std::size_t block = 0; block < ACTION.size(); ++block)
+    {
+      row.clear();
+      for (auto &&[symbol, action] : ACTION[block])
       {
-        int id = condition.top();
-        if (ACTION.count(std::make_pair(id, terminate_symbol.symbol_id)) == 0)
+        row.push_back(symbol);
+        row.push_back(action.kind);
+        row.push_back(action.value);
+      }
+      row.push_back(-1);
+      hash = utils::hash::xxhash64(row, hash);
+      hash = utils::hash::xxhash64(GOTO[block], hash);
+    }
+    return hash;
+  }
+
+  void report_counters(std::ostream &out_stream, const parse_context_t &context,
+      std::size_t max_rows = 20) const
+  {
+    context.state_counters.report(out_stream, "LR(1) states",
+        [&](std::size_t block) { return "state " + std::to_string(block); }, max_rows);
+    context.reduction_counters.report(out_stream, "LR(1) reductions",
+        [&](std::size_t rule_id) {
+          std::string rule = id2symbol[rule_lhs[rule_id]].symbol_id + " ->";
+          for (auto symbol : rule_rhs[rule_id])
+            rule += " " + id2symbol[symbol].symbol_id;
+          return rule_rhs[rule_id].empty() ? rule + " epsilon" : rule;
+        }, max_rows);
+  }
+
+  // ACTION table keyed by (state, terminal), "s"/"r"/"acc" with the
+  // target state or rule id
+  auto actions() const
+  {
+    static const char *kind_names[] = { "", "s", "r", "acc" };
+    std::unordered_map<std::pair<int, std::string>, std::pair<std::string, int>> actions;
+    for (int block = 0; block < (int)_num_states; ++block)
+    {
+      for (int symbol = 0; symbol < num_terminate_symbols; ++symbol)
+      {
+        auto action = find_action(block, symbol);
+        if (action.kind != action_t::error)
         {
-          std :: cout << "error" << "\n";
-        }
-        else {
-          auto op = ACTION[std::make_pair(id, terminate_symbol.symbol_id)];
-          if (op.first[0] == 's') {
-            std :: cout << "s" << " " << op.second << "\n";
-            condition.push(op.second);
-            symbols.push(terminate_symbol);
-          }
-          else {
-            std::cout << "r" << " "  << op.second << "\n";
-            condition.pop();
-            int rule_id = op.second;
-            for(int i = 0;i < id2rule[rule_id].rule_symbols.size();i++) symbols.pop();
-            symbols.push(id2rule[rule_id].symbol);
-            if (GOTO.count(std::make_pair(condition.top(), symbols.top().symbol_id)) == 0)
-            {
-              std::cout << "error" << "\n";
-            }
-            else {
-              condition.push(GOTO[std::make_pair(condition.top(), symbols.top().symbol_id)]);
-            }
-          }
+          actions[std::make_pair(block, id2symbol[symbol].symbol_id)] =
+              std::make_pair(std::string(kind_names[action.kind]), action.value);
         }
       }
-    };
+    }
+    return actions;
+  }
 
-    for (auto it = it_begin; it < it_end; ++it)
+  // what options_t::eliminate_chain_rules did: the chain rules whose
+  // reductions were bypassed, the states only reached to make them and
+  // the GOTO entries rewritten past those states
+  struct chain_elimination_t
+  {
+    std::size_t chain_rules = 0;
+    std::size_t bypassed_states = 0;
+    std::size_t rewritten_gotos = 0;
+  };
+
+  chain_elimination_t chain_elimination() const
+  {
+    return _chain_elimination;
+  }
+
+  // sizes of the parse tables: as a dense state x symbol array of ints,
+  // as the sorted rows built first and, when built with
+  // options_t::compress, as the compressed tables. The tables are packed
+  // the way yacc and bison pack theirs; parses give the same results and
+  // actions either way. Every state with a reduction gets its most
+  // frequent one as default, its other entries go into a comb vector and
+  // a row of bits marks the terminals it has any action on, so errors are
+  // still caught before the default reduction. Every nonterminal gets its
+  // most frequent GOTO target as default, the other targets go into a
+  // second comb vector
+  struct table_size_t
+  {
+    std::size_t dense_bytes = 0;
+    std::size_t sparse_bytes = 0;
+    std::size_t compressed_bytes = 0;
+    std::size_t action_entries = 0;
+    std::size_t goto_entries = 0;
+    std::size_t default_reductions = 0;
+    std::size_t error_rows = 0;
+    std::size_t comb_entries = 0;
+    std::size_t comb_slots = 0;
+  };
+
+  table_size_t table_size() const
+  {
+    if (_compressed)
+      return _table_size;
+    table_size_t size;
+    size.dense_bytes = _num_states * id2symbol.size() * sizeof(int);
+    size.sparse_bytes = (ACTION.capacity() + GOTO.capacity()) * sizeof(ACTION[0]);
+    for (std::size_t block = 0; block < _num_states; ++block)
+    {
+      size.sparse_bytes += ACTION[block].capacity() * sizeof(ACTION[block][0])
+          + GOTO[block].capacity() * sizeof(GOTO[block][0]);
+      size.action_entries += ACTION[block].size();
+      size.goto_entries += GOTO[block].size();
+    }
+    return size;
+  }
+
+  bool compressed() const
+  {
+    return _compressed;
+  }
+
+  // parses [it_begin, it_end), printing every action to std::cout
+  template <typename ForwardIterator>
+  bool analysis(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    return _analysis(&std::cout, context, it_begin, it_end);
+  }
+
+  template <typename ForwardIterator>
+  bool analysis(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end,
+      parse_context_t &context) const
+  {
+    return _analysis(&std::cout, context, it_begin, it_end);
+  }
+
+  // parses [it_begin, it_end) without output, returns whether it is accepted
+  template <typename ForwardIterator>
+  bool recognize(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    parse_context_t context;
+    return _analysis(nullptr, context, it_begin, it_end);
+  }
+
+  template <typename ForwardIterator>
+  bool recognize(
+      const ForwardIterator &it_begin, const ForwardIterator &it_end,
+      parse_context_t &context) const
+  {
+    return _analysis(nullptr, context, it_begin, it_end);
+  }
+
+  // state of a push parse: the parse context, a plain value that can be
+  // copied away between feed() calls and resumed later
+  using push_state_t = parse_context_t;
+
+  push_state_t push_start() const
+  {
+    push_state_t state;
+    push_start(state);
+    return state;
+  }
+
+  // restarts the parse in context, keeping its counters
+  void push_start(parse_context_t &context) const
+  {
+    context.condition.assign(1, 0);
+    context.rejected = false;
+  }
+
+  // consumes one terminal id, false once the input is rejected
+  bool push(push_state_t &state, int symbol) const
+  {
+    if (!state.rejected && _push(nullptr, state, symbol) != 1)
+      state.rejected = true;
+    return !state.rejected;
+  }
+
+  // consumes the symbols [it_begin, it_end), returns false once rejected
+  template <typename ForwardIterator>
+  bool feed(push_state_t &state,
+      const ForwardIterator &it_begin, const ForwardIterator &it_end) const
+  {
+    for (auto it = it_begin; it != it_end && !state.rejected; ++it)
     {
-      match_or_output(*it);
+      push(state, terminal_id((*it).symbol_id));
     }
-    match_or_output(delimiter_symbol());
+    return !state.rejected;
+  }
+
+  // ends the input, returns whether it is accepted
+  bool finish(push_state_t &state) const
+  {
+    if (state.rejected)
+      return false;
+    state.rejected = _push(nullptr, state, _delimiter_id) != 0;
+    return !state.rejected;
+  }
+
+  // parses the terminal ids returned by next_token() until it returns
+  // end_of_input_id, no symbol is built per token
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token) const
+  {
+    parse_context_t context;
+    return _parse(nullptr, context, next_token);
+  }
+
+  template <typename NextToken>
+  bool recognize_pull(NextToken &&next_token, parse_context_t &context) const
+  {
+    return _parse(nullptr, context, next_token);
   }
 
 private:
@@ -308,12 +995,225 @@ private:
   syntax_t _syntax;
   symbol_t _start_symbol;
 
-  std::unordered_map<symbol_t, std::unordered_set<symbol_t>> _first_set;
-  std::unordered_map<int, production_rule_t> id2rule;
-  std::unordered_map<production_rule_t, int> rule2id;
-  std::unordered_map<int, std::vector<std::pair<int, std::pair<int, std::string>>>> project, _project;
-  std::unordered_map<std::pair<int, std::string>, std::pair<std::string, int>> ACTION;
-  std::unordered_map<std::pair<int, std::string>, int> GOTO;
+  std::pmr::unordered_map<symbol_t, std::pmr::unordered_set<symbol_t>> _first_set;
+  std::pmr::unordered_map<int, production_rule_t> id2rule;
+  std::pmr::unordered_map<production_rule_t, int> rule2id;
+
+  // interned symbols, ids below num_terminate_symbols are terminals
+  std::pmr::unordered_map<std::string, int> symbol2id;
+  std::pmr::vector<symbol_t> id2symbol;
+  int num_terminate_symbols = 0;
+  int _delimiter_id = 0;
+
+  std::pmr::vector<int> rule_lhs;
+  std::pmr::vector<std::pmr::vector<int>> rule_rhs;
+  std::pmr::vector<std::pmr::vector<int>> rules_of_symbol;
+  std::pmr::vector<std::pmr::vector<utils::container::dynamic_bitset_t>> suffix_first;
+  std::pmr::vector<std::pmr::vector<bool>> suffix_nullable;
+
+  // per-state rows sorted by symbol id, released by _compress()
+  std::pmr::vector<std::pmr::vector<std::pair<int, action_t>>> ACTION;
+  std::pmr::vector<std::pmr::vector<std::pair<int, int>>> GOTO;
+  std::size_t _num_states = 0;
+
+  // actions that lost their ACTION entry to the first one set, by
+  // conflict_key(), and the states that have any
+  std::pmr::unordered_map<std::uint64_t, std::pmr::vector<action_t>> _conflicts;
+  std::pmr::vector<bool> _conflict_blocks;
+
+  struct valid_row_hash
+  {
+    std::size_t operator()(const std::vector<std::uint64_t> &bits) const
+    {
+      return utils::hash::xxhash64(bits);
+    }
+  };
+
+  // skips the reductions by chain rules A -> B, B a nonterminal and A not
+  // in keep_symbols (those whose reductions carry semantic actions), where
+  // the tables allow it: a state reached by GOTO on B that does nothing
+  // but reduce by A -> B is bypassed by rewriting that GOTO entry to the
+  // GOTO on A, along whole chains. Only taken where the target has no
+  // action on a terminal the bypassed state rejects, so errors are caught
+  // on the same token. Parses accept the same inputs, with the bypassed
+  // reductions missing from their output. States whose chain reduction
+  // shares lookaheads with other items are left as they are. Runs on the
+  // sorted rows, before _compress()
+  chain_elimination_t _eliminate_chain_rules(const std::unordered_set<std::string> &keep_symbols)
+  {
+    chain_elimination_t result;
+    UTILS_TRACE_SCOPE("LR/chain_rules");
+
+    // the chain rule of every state that only reduces by it, or -1
+    std::vector<int> chain_rule(_num_states, -1);
+    for (std::size_t block = 0; block < _num_states; ++block)
+    {
+      auto &row = ACTION[block];
+      if (row.empty() || !GOTO[block].empty() || row.front().second.kind != action_t::reduce)
+        continue;
+      int rule_id = row.front().second.value;
+      if (rule_rhs[rule_id].size() != 1 || rule_rhs[rule_id][0] < num_terminate_symbols
+          || keep_symbols.count(id2symbol[rule_lhs[rule_id]].symbol_id))
+        continue;
+      bool only_rule = std::all_of(row.begin(), row.end(), [&](auto &entry) {
+        return entry.second.kind == action_t::reduce && entry.second.value == rule_id;
+      });
+      if (only_rule)
+        chain_rule[block] = rule_id;
+    }
+
+    auto by_symbol = [](auto &lhs, auto &rhs) { return lhs.first < rhs.first; };
+    std::vector<bool> rule_used(rule_lhs.size(), false), block_bypassed(_num_states, false);
+    for (std::size_t block = 0; block < _num_states; ++block)
+    {
+      for (auto &&[symbol, next_block] : GOTO[block])
+      {
+        // entries already rewritten lead to the end of their chain
+        auto &bypassed_row = ACTION[next_block];
+        int target = next_block;
+        while (chain_rule[target] >= 0)
+        {
+          int after = find_goto(block, rule_lhs[chain_rule[target]]);
+          if (after < 0 || !std::includes(bypassed_row.begin(), bypassed_row.end(),
+              ACTION[after].begin(), ACTION[after].end(), by_symbol))
+            break;
+          rule_used[chain_rule[target]] = true;
+          block_bypassed[target] = true;
+          target = after;
+        }
+        if (target != next_block)
+        {
+          next_block = target;
+          ++result.rewritten_gotos;
+        }
+      }
+    }
+    result.chain_rules = std::count(rule_used.begin(), rule_used.end(), true);
+    result.bypassed_states = std::count(block_bypassed.begin(), block_bypassed.end(), true);
+    return result;
+  }
+
+  // replaces the sorted ACTION and GOTO rows by the compressed tables,
+  // see table_size()
+  void _compress()
+  {
+    UTILS_TRACE_SCOPE("LR/compress");
+    auto size = table_size();
+    _fingerprint = fingerprint();
+
+    std::vector<utils::container::comb_vector_t::row_t> action_rows(_num_states);
+    std::unordered_map<std::vector<std::uint64_t>, int, valid_row_hash> error_rows;
+    std::vector<std::uint64_t> valid_row((num_terminate_symbols + 63) / 64);
+    _action_default.assign(_num_states, 0);
+    _action_error_row.assign(_num_states, -1);
+    for (std::size_t block = 0; block < _num_states; ++block)
+    {
+      auto &row = ACTION[block];
+      // most frequent reduction, the lowest rule on ties
+      std::unordered_map<int, int> reductions;
+      int default_code = 0, default_count = 0;
+      for (auto &&[symbol, action] : row)
+      {
+        if (action.kind != action_t::reduce)
+          continue;
+        int code = encode_action(action);
+        int count = ++reductions[code];
+        if (count > default_count || (count == default_count && code < default_code))
+        {
+          default_code = code;
+          default_count = count;
+        }
+      }
+      for (auto &&[symbol, action] : row)
+      {
+        int code = encode_action(action);
+        if (code != default_code)
+          action_rows[block].emplace_back(symbol, code);
+      }
+      if (default_code == 0)
+        continue;
+      _action_default[block] = default_code;
+      ++size.default_reductions;
+      std::fill(valid_row.begin(), valid_row.end(), 0);
+      for (auto &&[symbol, action] : row)
+        valid_row[symbol / 64] |= std::uint64_t(1) << (symbol % 64);
+      auto &&[it, inserted] = error_rows.emplace(valid_row, (int)error_rows.size());
+      _action_error_row[block] = it->second;
+    }
+    // rows of valid bits, num_terminate_symbols bits each
+    _action_valid.assign((error_rows.size() * num_terminate_symbols + 63) / 64, 0);
+    for (auto &&[bits, row] : error_rows)
+    {
+      for (int symbol = 0; symbol < num_terminate_symbols; ++symbol)
+      {
+        if ((bits[symbol / 64] >> (symbol % 64)) & 1)
+        {
+          std::size_t bit = std::size_t(row) * num_terminate_symbols + symbol;
+          _action_valid[bit / 64] |= std::uint64_t(1) << (bit % 64);
+        }
+      }
+    }
+    _action_comb.assign(action_rows);
+
+    // the most frequent GOTO target of every nonterminal as its default,
+    // the lowest on ties
+    int num_nonterminals = (int)id2symbol.size() - num_terminate_symbols;
+    std::vector<std::unordered_map<int, int>> targets(num_nonterminals);
+    std::vector<int> default_counts(num_nonterminals, 0);
+    _goto_default.assign(num_nonterminals, -1);
+    for (std::size_t block = 0; block < _num_states; ++block)
+    {
+      for (auto &&[symbol, next_block] : GOTO[block])
+      {
+        int column = symbol - num_terminate_symbols;
+        int count = ++targets[column][next_block];
+        if (count > default_counts[column]
+            || (count == default_counts[column] && next_block < _goto_default[column]))
+        {
+          _goto_default[column] = next_block;
+          default_counts[column] = count;
+        }
+      }
+    }
+    std::vector<utils::container::comb_vector_t::row_t> goto_rows(_num_states);
+    for (std::size_t block = 0; block < _num_states; ++block)
+    {
+      for (auto &&[symbol, next_block] : GOTO[block])
+      {
+        int column = symbol - num_terminate_symbols;
+        if (next_block != _goto_default[column])
+          goto_rows[block].emplace_back(column, next_block);
+      }
+    }
+    _goto_comb.assign(goto_rows);
+
+    decltype(ACTION)(ACTION.get_allocator()).swap(ACTION);
+    decltype(GOTO)(GOTO.get_allocator()).swap(GOTO);
+    _compressed = true;
+
+    size.error_rows = error_rows.size();
+    size.comb_entries = _action_comb.num_entries() + _goto_comb.num_entries();
+    size.comb_slots = _action_comb.num_slots() + _goto_comb.num_slots();
+    size.compressed_bytes = _action_comb.bytes() + _goto_comb.bytes()
+        + (_action_default.size() + _action_error_row.size() + _goto_default.size()) * sizeof(int)
+        + _action_valid.size() * sizeof(std::uint64_t);
+    _table_size = size;
+  }
+
+  chain_elimination_t _chain_elimination;
+
+  // the compressed tables, see _compress(); ACTION entries encoded by
+  // encode_action(), comb rows are states, columns are terminals for
+  // ACTION and nonterminals less num_terminate_symbols for GOTO
+  bool _compressed = false;
+  std::uint64_t _fingerprint = 0;
+  table_size_t _table_size;
+  std::pmr::vector<int> _action_default;
+  std::pmr::vector<int> _action_error_row;
+  std::pmr::vector<std::uint64_t> _action_valid;
+  utils::container::comb_vector_t _action_comb;
+  std::pmr::vector<int> _goto_default;
+  utils::container::comb_vector_t _goto_comb;
 };
 } // namespace compiler
 
@@ -0,0 +1,139 @@
+#ifndef COMPILER_SYNTAX_LOADER_HPP
+#define COMPILER_SYNTAX_LOADER_HPP
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <utils/io/smart_ifstream.hpp>
+#include <utils/profile/trace.hpp>
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+  // a grammar file load_production_rules() cannot take, what() tells why
+  class grammar_error_t : public std::runtime_error
+  {
+  public:
+    using std::runtime_error::runtime_error;
+  };
+
+  // reads rules in the syntax_default.txt format:
+  //   SYMBOL ::= X_1 X_2 ... | Y_1 Y_2 ... ;
+  // and operator tables, levels from the loosest binding to the tightest:
+  //   %operators SYMBOL OPERAND %left OP ... %right OP ... %prefix OP ...
+  //     %postfix OP ... ;
+  // each table stored into operator_tables and given as its chain of
+  // rules. The first defined symbol is stored into start_symbol_id.
+  // Throws grammar_error_t for an operator before the first level of its
+  // table, an unknown %keyword in a table or a table of more than
+  // operator_table_t::max_levels levels
+  inline std::vector<production_rule_t> load_production_rules(
+      utils::io::smart_ifstream& in_stream, std::string& start_symbol_id,
+      std::vector<operator_table_t>& operator_tables)
+  {
+    UTILS_TRACE_SCOPE("grammar/load");
+    std::vector<production_rule_t> rules;
+    start_symbol_id = "";
+    operator_tables.clear();
+    {
+      std::string s;
+      std::string symbol;
+      std::vector<std::string> rule;
+      operator_table_t table;
+
+label_symbol:
+      if (in_stream >> s) {
+        if (s == "%operators") {
+          goto label_operators;
+        }
+        symbol = s;
+        if (start_symbol_id == "") {
+          start_symbol_id = s;
+        }
+        goto label_is_defined_as;
+      } else {
+        goto label_terminate;
+      }
+
+label_is_defined_as:
+      in_stream >> s;
+      goto label_rule_start;
+
+label_rule_start:
+      in_stream >> s;
+      rule.push_back(s);
+      goto label_rule_loop;
+
+label_rule_loop:
+      in_stream >> s;
+      if (s == "|") {
+        rules.emplace_back(symbol, rule.begin(), rule.end());
+        rule.clear();
+        goto label_rule_start;
+      } else if (s == ";") {
+        rules.emplace_back(symbol, rule.begin(), rule.end());
+        rule.clear();
+        goto label_symbol;
+      } else {
+        rule.push_back(s);
+        goto label_rule_loop;
+      }
+
+label_operators:
+      table = operator_table_t();
+      in_stream >> table.symbol_id >> table.operand_id;
+      if (start_symbol_id == "") {
+        start_symbol_id = table.symbol_id;
+      }
+      goto label_operators_loop;
+
+label_operators_loop:
+      if (!(in_stream >> s)) {
+        goto label_terminate;
+      }
+      if (s == ";") {
+        if (table.levels.size() > operator_table_t::max_levels) {
+          throw grammar_error_t("%operators " + table.symbol_id + ": "
+              + std::to_string(table.levels.size()) + " levels, at most "
+              + std::to_string(operator_table_t::max_levels) + " are supported");
+        }
+        for (auto&& table_rule: table.rules()) {
+          rules.push_back(table_rule);
+        }
+        operator_tables.push_back(table);
+        goto label_symbol;
+      } else if (s == "%left") {
+        table.levels.push_back({ operator_table_t::left, {} });
+      } else if (s == "%right") {
+        table.levels.push_back({ operator_table_t::right, {} });
+      } else if (s == "%prefix") {
+        table.levels.push_back({ operator_table_t::prefix, {} });
+      } else if (s == "%postfix") {
+        table.levels.push_back({ operator_table_t::postfix, {} });
+      } else if (s[0] == '%') {
+        throw grammar_error_t("%operators " + table.symbol_id + ": unknown keyword " + s);
+      } else if (table.levels.empty()) {
+        throw grammar_error_t("%operators " + table.symbol_id + ": operator " + s
+            + " before the first level keyword");
+      } else {
+        table.levels.back().operators.push_back(s);
+      }
+      goto label_operators_loop;
+
+label_terminate:
+      ;
+    }
+    return rules;
+  }
+
+  inline std::vector<production_rule_t> load_production_rules(
+      utils::io::smart_ifstream& in_stream, std::string& start_symbol_id)
+  {
+    std::vector<operator_table_t> operator_tables;
+    return load_production_rules(in_stream, start_symbol_id, operator_tables);
+  }
+
+} // namespace compiler
+
+#endif // COMPILER_SYNTAX_LOADER_HPP
@@ -0,0 +1,195 @@
+#ifndef COMPILER_TOKEN_PIPELINE_HPP
+#define COMPILER_TOKEN_PIPELINE_HPP
+
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <utils/container/spsc_ring.hpp>
+#include <utils/profile/trace.hpp>
+#include <compiler/lexical_analysis.hpp>
+#include <compiler/syntax.hpp>
+
+namespace compiler
+{
+  // a scanned token as it travels through the ring, the symbol is built
+  // on the consumer side; token_name points into the DFA
+  struct token_t
+  {
+    const std::string* token_name;
+    std::size_t i_start;
+    std::size_t length;
+  };
+
+  using token_ring_t = utils::container::spsc_ring_t<token_t>;
+
+  // consumer side of a token ring: an input range over the symbols of the
+  // tokens, pulled from the ring in batches; usable once, by the consumer
+  // thread
+  class token_stream_t
+  {
+  public:
+    class iterator_t
+    {
+    public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = symbol_t;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const symbol_t*;
+      using reference = const symbol_t&;
+
+      iterator_t() = default;
+
+      explicit iterator_t(token_stream_t* stream)
+      : m_stream(stream && stream->fill() ? stream : nullptr)
+      { }
+
+      const symbol_t& operator*() const
+      {
+        return m_stream->m_batch[m_stream->m_idx];
+      }
+
+      const symbol_t* operator->() const
+      {
+        return &**this;
+      }
+
+      iterator_t& operator++()
+      {
+        ++m_stream->m_idx;
+        if (!m_stream->fill()) {
+          m_stream = nullptr;
+        }
+        return *this;
+      }
+
+      // end is the only iterator that compares unequal to a live one
+      bool operator==(const iterator_t& rhs) const
+      {
+        return m_stream == rhs.m_stream;
+      }
+
+      bool operator!=(const iterator_t& rhs) const
+      {
+        return !(*this == rhs);
+      }
+
+    private:
+      token_stream_t* m_stream = nullptr;
+    };
+
+    token_stream_t(token_ring_t& ring, const std::string& input_content, std::size_t batch_size)
+    : m_ring(ring), m_input_content(input_content), m_batch_size(batch_size)
+    { }
+
+    // the parser may stop before the end, let the producer stop too
+    ~token_stream_t()
+    {
+      m_ring.cancel();
+    }
+
+    iterator_t begin()
+    {
+      return iterator_t(this);
+    }
+
+    iterator_t end()
+    {
+      return iterator_t();
+    }
+
+  private:
+    // makes m_batch[m_idx] the current token, false at the end of stream
+    bool fill()
+    {
+      if (m_idx < m_batch.size()) {
+        return true;
+      }
+      m_batch.clear();
+      m_idx = 0;
+      while (true) {
+        // closed is read before popping, so a close that happened before
+        // the pop is seen together with every token pushed before it
+        bool closed = m_ring.closed();
+        m_ring.try_pop([&](token_t&& token) {
+          m_batch.emplace_back(*token.token_name, m_input_content.substr(token.i_start, token.length));
+        }, m_batch_size);
+        if (!m_batch.empty()) {
+          return true;
+        }
+        if (closed) {
+          return false;
+        }
+        std::this_thread::yield();
+      }
+    }
+
+    token_ring_t& m_ring;
+    const std::string& m_input_content;
+    std::size_t m_batch_size;
+    std::vector<symbol_t> m_batch;
+    std::size_t m_idx = 0;
+  };
+
+  // scans input_content on a separate thread while parse(it_begin, it_end)
+  // consumes the tokens (comments and invalid characters left out, as by
+  // scan()) on the calling thread; tokens travel through a lock-free ring
+  // of ring_capacity tokens in batches of batch_size, so lexing and parsing
+  // overlap and memory stays bounded by the ring; returns what parse returns
+  template <typename Parse>
+  auto pipelined_parse(
+      const lexical_automaton_t& dfa,
+      const std::string& input_content,
+      Parse&& parse,
+      std::size_t ring_capacity = 1 << 14,
+      std::size_t batch_size = 256)
+  {
+    token_ring_t ring(ring_capacity);
+
+    std::thread scanner([&]() {
+      UTILS_TRACE_SCOPE("pipeline/scan");
+      std::vector<token_t> batch;
+      batch.reserve(batch_size);
+      // false once the consumer has given up
+      auto flush = [&]() {
+        auto it = batch.begin();
+        while ((it = ring.try_push(it, batch.end())) != batch.end()) {
+          if (ring.cancelled()) {
+            return false;
+          }
+          std::this_thread::yield();
+        }
+        batch.clear();
+        return !ring.cancelled();
+      };
+      scan_tokens(dfa, input_content,
+          [&](const std::string& token_name, std::size_t i_start, std::size_t length) {
+            if (token_name != "invalid" && token_name != "comment") {
+              batch.push_back({ &token_name, i_start, length });
+              if (batch.size() == batch_size) {
+                return flush();
+              }
+            }
+            return true;
+          });
+      flush();
+      ring.close();
+    });
+
+    struct join_t
+    {
+      std::thread& thread;
+      ~join_t() { thread.join(); }
+    } join { scanner };
+
+    UTILS_TRACE_SCOPE("pipeline/parse");
+    token_stream_t stream(ring, input_content, batch_size);
+    return parse(stream.begin(), stream.end());
+  }
+
+} // namespace compiler
+
+#endif // COMPILER_TOKEN_PIPELINE_HPP
@@ -1,7 +1,13 @@
 #ifndef UTILS_AUTOMATON_AUTOMATON_HPP
 #define UTILS_AUTOMATON_AUTOMATON_HPP
 
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
 #include <memory>
+#include <memory_resource>
+#include <type_traits>
 #include <utility>
 #include <tuple>
 #include <unordered_map>
@@ -13,43 +19,271 @@ namespace utils {
 
   namespace automaton {
 
+    // dynamic-dispatch property bases, opt-in for automata that keep
+    // heterogeneous state or transition types behind one pointer type
     struct state_property_base
     {
-      virtual bool is_finalize()
-      { }
+      virtual ~state_property_base() = default;
+
+      virtual bool is_finalize() const
+      {
+        return false;
+      }
     };
 
     template <typename T>
     struct transition_property_base
     {
-      virtual bool is_epsilon()
-      { }
+      virtual ~transition_property_base() = default;
+
+      virtual bool is_epsilon() const
+      {
+        return false;
+      }
 
-      virtual bool accept(T value)
-      { }
+      virtual bool accept(T) const
+      {
+        return false;
+      }
     };
 
+    // static-dispatch transition over the 256 byte values, automaton_t
+    // compiles every state's out transitions of this kind into a dense
+    // next-state row, so transit() is a single table lookup
+    struct character_set_transition_t
+    {
+      bool m_is_epsilon = false;
+      std::bitset<256> m_character_set = 0;
+
+      bool is_epsilon() const
+      {
+        return m_is_epsilon;
+      }
+
+      bool accept(char value) const
+      {
+        return m_character_set[static_cast<unsigned char>(value)];
+      }
+    };
+
+    // policy checks: a state property provides `bool is_finalize() const`,
+    // a transition property provides `bool is_epsilon() const` and
+    // `bool accept(T) const`, resolved statically unless declared virtual
+    template <typename state_property_t, typename = void>
+    struct is_state_property : std::false_type
+    { };
+
+    template <typename state_property_t>
+    struct is_state_property<state_property_t, std::void_t<
+        decltype(bool(std::declval<const state_property_t&>().is_finalize()))>>
+    : std::true_type
+    { };
+
+    template <typename transition_property_t, typename T, typename = void>
+    struct is_transition_property : std::false_type
+    { };
+
+    template <typename transition_property_t, typename T>
+    struct is_transition_property<transition_property_t, T, std::void_t<
+        decltype(bool(std::declval<const transition_property_t&>().is_epsilon())),
+        decltype(bool(std::declval<const transition_property_t&>().accept(std::declval<T>())))>>
+    : std::true_type
+    { };
+
+    // the graph is a private base: adding or removing a transition through
+    // it would leave the next-state rows behind, so only its queries are
+    // exposed
     template <typename state_property_t, typename transition_property_t>
-    class automaton_t : public graph::directed_graph_t<state_property_t, transition_property_t>
+    class automaton_t : private graph::directed_graph_t<state_property_t, transition_property_t>
     {
     private:
       using base_graph_t = graph::directed_graph_t<state_property_t, transition_property_t>;
 
+      static_assert(is_state_property<state_property_t>::value,
+          "state_property_t must provide bool is_finalize() const");
+
+      static constexpr bool is_character_set_transition =
+          std::is_base_of_v<character_set_transition_t, transition_property_t>;
+
     public:
+      using vertex_property_pointer_t = typename base_graph_t::vertex_property_pointer_t;
+      using edge_property_pointer_t = typename base_graph_t::edge_property_pointer_t;
+      using edge_description_t = typename base_graph_t::edge_description_t;
+
+      using base_graph_t::resource;
+      using base_graph_t::exist_vertex;
+      using base_graph_t::add_vertex;
+      using base_graph_t::num_vertices;
+      using base_graph_t::vertices;
+      using base_graph_t::exist_edge_with_property;
+      using base_graph_t::exist_edge_with_endpoints;
+      using base_graph_t::num_edges;
+      using base_graph_t::edge_description;
+      using base_graph_t::edge_descriptions;
+      using base_graph_t::in_degree;
+      using base_graph_t::in_edge_descriptions;
+      using base_graph_t::out_degree;
+      using base_graph_t::out_edge_descriptions;
+      using base_graph_t::edges;
+
       automaton_t(
-          typename base_graph_t::vertex_property_pointer_t state_property)
-      : m_start_state(state_property)
+          vertex_property_pointer_t state_property,
+          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : base_graph_t(resource), m_start_state(state_property),
+        m_row_index(resource), m_rows(resource), m_target_index(resource),
+        m_targets(1, vertex_property_pointer_t(), resource), m_edge_order(resource)
       {
         this->add_vertex(state_property);
       }
 
-      typename base_graph_t::vertex_property_pointer_t start_state()
+      vertex_property_pointer_t start_state() const
       {
         return m_start_state;
       }
 
+      bool is_finalize(const vertex_property_pointer_t& state) const
+      {
+        return state->is_finalize();
+      }
+
+      // target of the first out transition of state accepting value, or a
+      // null pointer if there is none
+      template <typename T>
+      vertex_property_pointer_t transit(const vertex_property_pointer_t& state, T value) const
+      {
+        static_assert(is_transition_property<transition_property_t, T>::value,
+            "transition_property_t must provide bool is_epsilon() const and bool accept(T) const");
+        if constexpr (is_character_set_transition) {
+          auto it = m_row_index.find(state.get());
+          if (it == m_row_index.end()) {
+            return m_targets[0];
+          }
+          return m_targets[m_rows[it->second][static_cast<unsigned char>(value)]];
+        } else {
+          for (auto&& [state_in, state_out, transition]: this->out_edge_descriptions(state)) {
+            if (transition->accept(value)) {
+              return state_out;
+            }
+          }
+          return vertex_property_pointer_t();
+        }
+      }
+
+      bool add_edge(vertex_property_pointer_t vertex_in, vertex_property_pointer_t vertex_out, edge_property_pointer_t edge_property)
+      {
+        if (!base_graph_t::add_edge(vertex_in, vertex_out, edge_property)) {
+          return false;
+        }
+        if constexpr (is_character_set_transition) {
+          m_edge_order.emplace(edge_property.get(), m_next_edge_order++);
+          fill_row(row(vertex_in), target_index(vertex_out), *edge_property);
+        }
+        return true;
+      }
+
+      bool remove_edge(edge_property_pointer_t edge_property)
+      {
+        auto [description, found] = this->edge_description(edge_property);
+        if (!base_graph_t::remove_edge(edge_property)) {
+          return false;
+        }
+        if constexpr (is_character_set_transition) {
+          m_edge_order.erase(edge_property.get());
+          rebuild_row(std::get<0>(description));
+        }
+        return true;
+      }
+
+      bool remove_edge(const vertex_property_pointer_t& vertex_in, const vertex_property_pointer_t& vertex_out)
+      {
+        auto [description, found] = this->edge_description(vertex_in, vertex_out);
+        return found && remove_edge(std::get<2>(description));
+      }
+
+      bool remove_vertex(vertex_property_pointer_t vertex_property)
+      {
+        if constexpr (is_character_set_transition) {
+          for (auto&& [state_in, state_out, transition]: in_edge_descriptions(vertex_property)) {
+            m_edge_order.erase(transition.get());
+          }
+          for (auto&& [state_in, state_out, transition]: out_edge_descriptions(vertex_property)) {
+            m_edge_order.erase(transition.get());
+          }
+        }
+        if (!base_graph_t::remove_vertex(vertex_property)) {
+          return false;
+        }
+        if constexpr (is_character_set_transition) {
+          m_row_index.clear();
+          m_rows.clear();
+          m_target_index.clear();
+          m_targets.resize(1);
+          for (auto& state: this->vertices()) {
+            rebuild_row(state);
+          }
+        }
+        return true;
+      }
+
     private:
-      typename base_graph_t::vertex_property_pointer_t m_start_state;
+      using row_t = std::array<std::uint32_t, 256>;
+
+      std::uint32_t target_index(const vertex_property_pointer_t& state)
+      {
+        auto [it, inserted] = m_target_index.emplace(state.get(), m_targets.size());
+        if (inserted) {
+          m_targets.push_back(state);
+        }
+        return it->second;
+      }
+
+      row_t& row(const vertex_property_pointer_t& state)
+      {
+        auto [it, inserted] = m_row_index.emplace(state.get(), m_rows.size());
+        if (inserted) {
+          m_rows.emplace_back();
+          m_rows.back().fill(0);
+        }
+        return m_rows[it->second];
+      }
+
+      // transitions added earlier win on the characters they share
+      static void fill_row(row_t& row, std::uint32_t target, const character_set_transition_t& transition)
+      {
+        for (std::size_t ch = 0; ch < 256; ++ch) {
+          row[ch] = (row[ch] == 0 && transition.m_character_set[ch]) ? target : row[ch];
+        }
+      }
+
+      // refills the row of state in the order its transitions were added,
+      // which the graph's adjacency does not keep
+      void rebuild_row(const vertex_property_pointer_t& state)
+      {
+        std::vector<std::pair<std::uint64_t, edge_description_t>> transitions;
+        for (auto&& description: out_edge_descriptions(state)) {
+          transitions.emplace_back(m_edge_order.at(std::get<2>(description).get()), description);
+        }
+        std::sort(transitions.begin(), transitions.end(),
+            [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; });
+        auto& state_row = row(state);
+        state_row.fill(0);
+        for (auto&& [order, description]: transitions) {
+          fill_row(state_row, target_index(std::get<1>(description)), *std::get<2>(description));
+        }
+      }
+
+    private:
+      vertex_property_pointer_t m_start_state;
+
+      // dense next-state rows of character set transitions, index 0 of
+      // m_targets is the null state
+      std::pmr::unordered_map<const state_property_t*, std::size_t> m_row_index;
+      std::pmr::vector<row_t> m_rows;
+      std::pmr::unordered_map<const state_property_t*, std::uint32_t> m_target_index;
+      std::pmr::vector<vertex_property_pointer_t> m_targets;
+      // insertion order of the character set transitions, for rebuild_row()
+      std::pmr::unordered_map<const transition_property_t*, std::uint64_t> m_edge_order;
+      std::uint64_t m_next_edge_order = 0;
     };
 
   } // namespace automaton
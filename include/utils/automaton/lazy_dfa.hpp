@@ -0,0 +1,239 @@
+#ifndef UTILS_AUTOMATON_LAZY_DFA_HPP
+#define UTILS_AUTOMATON_LAZY_DFA_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <utils/automaton/nfa.hpp>
+#include <utils/automaton/subset_construction.hpp>
+#include <utils/container/dynamic_bitset.hpp>
+
+namespace utils {
+
+  namespace automaton {
+
+    // determinize-on-demand execution of an nfa_t: DFA states are built
+    // the first time a transition reaches them and cached, and once the
+    // cache outgrows its memory budget it is discarded as a whole and
+    // refilled from the running state, as RE2 does
+    class lazy_dfa_t
+    {
+    public:
+      using state_t = std::uint32_t;
+      using symbol_id_t = nfa_t::symbol_id_t;
+
+      static constexpr state_t dead_state = state_t(-1);
+
+      explicit lazy_dfa_t(const nfa_t& nfa, std::size_t max_memory = std::size_t(8) << 20)
+      : m_nfa(nfa), m_max_memory(max_memory), m_members(nfa.num_states())
+      {
+        m_byte_symbols.fill(symbol_id_t(nfa.num_symbols()));
+        for (symbol_id_t symbol_id = 0; symbol_id < nfa.num_symbols(); ++symbol_id) {
+          auto& symbol = nfa.symbol(symbol_id);
+          if (symbol.length() == 1) {
+            m_byte_symbols[static_cast<unsigned char>(symbol[0])] = symbol_id;
+          }
+        }
+      }
+
+      // the start state, rebuilt if a flush discarded it
+      state_t start_state()
+      {
+        if (m_start_state == dead_state) {
+          std::vector<nfa_t::state_t> nfa_states { 0 };
+          m_nfa.close(nfa_states, m_members);
+          m_start_state = add_state(std::move(nfa_states));
+        }
+        return m_start_state;
+      }
+
+      // follows symbol_id from state, computing and caching the target on a
+      // miss; a miss may flush the cache, invalidating every state id other
+      // than the returned one, so callers only keep their current state
+      state_t transit(state_t state, symbol_id_t symbol_id)
+      {
+        if (state == dead_state || symbol_id >= m_nfa.num_symbols()) {
+          return dead_state;
+        }
+        auto& cached = m_states[state].transitions[symbol_id];
+        if (cached != unknown_state) {
+          ++m_num_hits;
+          return cached;
+        }
+        ++m_num_misses;
+
+        std::vector<nfa_t::state_t> targets;
+        for (auto nfa_state: m_states[state].nfa_states) {
+          auto& edges = m_nfa.edges(nfa_state);
+          auto it = std::lower_bound(edges.begin(), edges.end(),
+              std::make_pair(symbol_id, nfa_t::state_t(0)));
+          for (; it != edges.end() && it->first == symbol_id; ++it) {
+            targets.push_back(it->second);
+          }
+        }
+        if (targets.empty()) {
+          m_states[state].transitions[symbol_id] = dead_state;
+          return dead_state;
+        }
+        m_nfa.close(targets, m_members);
+
+        auto it = m_state_ids.find(targets);
+        if (it != m_state_ids.end()) {
+          m_states[state].transitions[symbol_id] = it->second;
+          return it->second;
+        }
+        if (m_memory + state_memory(targets.size()) > m_max_memory) {
+          flush();
+          return add_state(std::move(targets));
+        }
+        auto target = add_state(std::move(targets));
+        m_states[state].transitions[symbol_id] = target;
+        return target;
+      }
+
+      state_t transit(state_t state, char value)
+      {
+        return transit(state, m_byte_symbols[static_cast<unsigned char>(value)]);
+      }
+
+      bool is_finalize(state_t state) const
+      {
+        return state != dead_state && m_states[state].finalize_nfa_state != nfa_t::state_t(-1);
+      }
+
+      const std::string& token_name(state_t state) const
+      {
+        static const std::string null_token_name;
+        return is_finalize(state) ? m_nfa.token_name(m_states[state].finalize_nfa_state) : null_token_name;
+      }
+
+      // whether the whole input is accepted
+      bool match(const std::string& input)
+      {
+        state_t state = start_state();
+        for (auto ch: input) {
+          state = transit(state, ch);
+          if (state == dead_state) {
+            return false;
+          }
+        }
+        return is_finalize(state);
+      }
+
+      // length of the longest accepted prefix of input[start..], 0 if none,
+      // storing the matched token name into token_name
+      std::size_t longest_match(const std::string& input, std::size_t start, std::string& token_name)
+      {
+        std::size_t length = 0;
+        state_t state = start_state();
+        for (std::size_t idx = start; idx < input.length(); ++idx) {
+          state = transit(state, input[idx]);
+          if (state == dead_state) {
+            break;
+          }
+          if (is_finalize(state)) {
+            length = idx - start + 1;
+            token_name = this->token_name(state);
+          }
+        }
+        return length;
+      }
+
+      std::size_t num_cached_states() const
+      {
+        return m_states.size();
+      }
+
+      std::size_t memory() const
+      {
+        return m_memory;
+      }
+
+      std::size_t num_flushes() const
+      {
+        return m_num_flushes;
+      }
+
+      std::size_t num_hits() const
+      {
+        return m_num_hits;
+      }
+
+      std::size_t num_misses() const
+      {
+        return m_num_misses;
+      }
+
+    private:
+      static constexpr state_t unknown_state = state_t(-2);
+
+      struct cached_state_t
+      {
+        std::vector<nfa_t::state_t> nfa_states;
+        std::vector<state_t> transitions;
+        nfa_t::state_t finalize_nfa_state;
+      };
+
+      std::size_t state_memory(std::size_t num_nfa_states) const
+      {
+        // set stored twice (state and hash key) plus the transition row
+        return sizeof(cached_state_t)
+            + 2 * num_nfa_states * sizeof(nfa_t::state_t)
+            + m_nfa.num_symbols() * sizeof(state_t);
+      }
+
+      state_t add_state(std::vector<nfa_t::state_t>&& nfa_states)
+      {
+        state_t state = m_states.size();
+        m_memory += state_memory(nfa_states.size());
+        auto finalize_nfa_state = nfa_t::state_t(-1);
+        for (auto nfa_state: nfa_states) {
+          if (m_nfa.is_finalize(nfa_state)) {
+            finalize_nfa_state = nfa_state;
+            break;
+          }
+        }
+        m_state_ids.emplace(nfa_states, state);
+        m_states.push_back(cached_state_t {
+            std::move(nfa_states),
+            std::vector<state_t>(m_nfa.num_symbols(), unknown_state),
+            finalize_nfa_state });
+        return state;
+      }
+
+      void flush()
+      {
+        ++m_num_flushes;
+        m_states.clear();
+        m_state_ids.clear();
+        m_memory = 0;
+        m_start_state = dead_state;
+      }
+
+    private:
+      const nfa_t& m_nfa;
+      std::size_t m_max_memory;
+      std::size_t m_memory = 0;
+
+      std::array<symbol_id_t, 256> m_byte_symbols;
+      container::dynamic_bitset_t m_members;
+
+      state_t m_start_state = dead_state;
+      std::vector<cached_state_t> m_states;
+      std::unordered_map<std::vector<nfa_t::state_t>, state_t, state_set_hash> m_state_ids;
+
+      std::size_t m_num_flushes = 0;
+      std::size_t m_num_hits = 0;
+      std::size_t m_num_misses = 0;
+    };
+
+  } // namespace automaton
+
+} // namespace utils
+
+#endif // UTILS_AUTOMATON_LAZY_DFA_HPP
@@ -0,0 +1,185 @@
+#ifndef UTILS_AUTOMATON_NFA_HPP
+#define UTILS_AUTOMATON_NFA_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <utils/container/dynamic_bitset.hpp>
+#include <utils/io/smart_ifstream.hpp>
+
+namespace utils {
+
+  namespace automaton {
+
+    // index-based NFA over string symbols, as read from nfa_define.txt:
+    // states are 0 .. num_states - 1 with 0 the start state, and edges
+    // labelled with the epsilon name ("null") are epsilon transitions
+    class nfa_t
+    {
+    public:
+      using state_t = std::uint32_t;
+      using symbol_id_t = std::uint32_t;
+
+      explicit nfa_t(std::size_t num_states, const std::string& epsilon_name = "null")
+      : m_epsilon_name(epsilon_name),
+        m_edges(num_states), m_epsilon_edges(num_states),
+        m_token_names(num_states), m_closures(num_states), m_closure_ready(num_states)
+      { }
+
+      std::size_t num_states() const
+      {
+        return m_edges.size();
+      }
+
+      std::size_t num_symbols() const
+      {
+        return m_symbols.size();
+      }
+
+      // id of symbol, registering it on first use; ids follow registration order
+      symbol_id_t add_symbol(const std::string& symbol)
+      {
+        auto [it, inserted] = m_symbol_ids.emplace(symbol, m_symbols.size());
+        if (inserted) {
+          m_symbols.push_back(symbol);
+        }
+        return it->second;
+      }
+
+      // id of symbol, or num_symbols() if it never appears on an edge
+      symbol_id_t symbol_id(const std::string& symbol) const
+      {
+        auto it = m_symbol_ids.find(symbol);
+        return it == m_symbol_ids.end() ? m_symbols.size() : it->second;
+      }
+
+      const std::string& symbol(symbol_id_t symbol_id) const
+      {
+        return m_symbols[symbol_id];
+      }
+
+      void add_transition(state_t state_in, state_t state_out, const std::string& symbol)
+      {
+        if (symbol == m_epsilon_name) {
+          m_epsilon_edges[state_in].push_back(state_out);
+        } else {
+          auto& edges = m_edges[state_in];
+          auto edge = std::make_pair(add_symbol(symbol), state_out);
+          edges.insert(std::upper_bound(edges.begin(), edges.end(), edge), edge);
+        }
+      }
+
+      // edges of state as (symbol id, target) pairs, sorted by symbol id
+      const std::vector<std::pair<symbol_id_t, state_t>>& edges(state_t state) const
+      {
+        return m_edges[state];
+      }
+
+      void set_finalize(state_t state, const std::string& token_name)
+      {
+        m_token_names[state] = token_name;
+      }
+
+      bool is_finalize(state_t state) const
+      {
+        return !m_token_names[state].empty();
+      }
+
+      const std::string& token_name(state_t state) const
+      {
+        return m_token_names[state];
+      }
+
+      // states reachable from state through epsilon edges (state included),
+      // computed on first request and memoized, so it is not safe to call
+      // concurrently before every closure has been computed once
+      const std::vector<state_t>& epsilon_closure(state_t state) const
+      {
+        if (!m_closure_ready[state]) {
+          auto& closure = m_closures[state];
+          std::vector<state_t> stack { state };
+          m_visited.resize(num_states());
+          m_visited.set(state);
+          while (!stack.empty()) {
+            auto current = stack.back();
+            stack.pop_back();
+            closure.push_back(current);
+            for (auto next: m_epsilon_edges[current]) {
+              if (m_visited.set(next)) {
+                stack.push_back(next);
+              }
+            }
+          }
+          for (auto reachable: closure) {
+            m_visited.reset(reachable);
+          }
+          std::sort(closure.begin(), closure.end());
+          m_closure_ready[state] = true;
+        }
+        return m_closures[state];
+      }
+
+      // replaces states with the sorted union of their epsilon closures,
+      // members is scratch space of num_states() bits, left cleared
+      void close(std::vector<state_t>& states, container::dynamic_bitset_t& members) const
+      {
+        std::vector<state_t> result;
+        for (auto state: states) {
+          for (auto reachable: epsilon_closure(state)) {
+            if (members.set(reachable)) {
+              result.push_back(reachable);
+            }
+          }
+        }
+        for (auto state: result) {
+          members.reset(state);
+        }
+        std::sort(result.begin(), result.end());
+        states.swap(result);
+      }
+
+    private:
+      std::string m_epsilon_name;
+      std::vector<std::string> m_symbols;
+      std::unordered_map<std::string, symbol_id_t> m_symbol_ids;
+
+      std::vector<std::vector<std::pair<symbol_id_t, state_t>>> m_edges;
+      std::vector<std::vector<state_t>> m_epsilon_edges;
+      std::vector<std::string> m_token_names;
+
+      mutable std::vector<std::vector<state_t>> m_closures;
+      mutable std::vector<bool> m_closure_ready;
+      mutable container::dynamic_bitset_t m_visited;
+    };
+
+    // reads an automaton in the nfa_define.txt format
+    inline nfa_t read_nfa(utils::io::smart_ifstream& in_stream, const std::string& epsilon_name = "null")
+    {
+      std::size_t num_states, num_finalize_states;
+      in_stream >> num_states >> num_finalize_states;
+      nfa_t nfa(num_states, epsilon_name);
+      while (num_finalize_states--) {
+        std::size_t idx_state;
+        std::string token_name;
+        in_stream >> idx_state >> token_name;
+        nfa.set_finalize(idx_state, token_name);
+      }
+      {
+        std::size_t idx_state_in, idx_state_out;
+        std::string parameter;
+        while (in_stream >> idx_state_in >> idx_state_out >> parameter) {
+          nfa.add_transition(idx_state_in, idx_state_out, parameter);
+        }
+      }
+      return nfa;
+    }
+
+  } // namespace automaton
+
+} // namespace utils
+
+#endif // UTILS_AUTOMATON_NFA_HPP
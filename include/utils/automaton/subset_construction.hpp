@@ -0,0 +1,144 @@
+#ifndef UTILS_AUTOMATON_SUBSET_CONSTRUCTION_HPP
+#define UTILS_AUTOMATON_SUBSET_CONSTRUCTION_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <utils/automaton/nfa.hpp>
+#include <utils/container/dynamic_bitset.hpp>
+
+namespace utils {
+
+  namespace automaton {
+
+    struct state_set_hash
+    {
+      std::size_t operator()(const std::vector<nfa_t::state_t>& states) const
+      {
+        std::size_t result = states.size();
+        for (auto state: states) {
+          result ^= std::hash<nfa_t::state_t>()(state) + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+        }
+        return result;
+      }
+    };
+
+    // determinizes an nfa_t, DFA state 0 is the epsilon closure of NFA
+    // state 0 and states are numbered in breadth-first order with symbols
+    // tried by increasing symbol id; empty target sets get no DFA state
+    class subset_construction_t
+    {
+    public:
+      using state_t = std::uint32_t;
+      using symbol_id_t = nfa_t::symbol_id_t;
+
+      explicit subset_construction_t(const nfa_t& nfa)
+      : m_nfa(nfa)
+      {
+        container::dynamic_bitset_t members(nfa.num_states());
+        // per-symbol target buckets, only the touched ones are visited
+        std::vector<std::vector<nfa_t::state_t>> buckets(nfa.num_symbols());
+        std::vector<symbol_id_t> touched_symbols;
+
+        std::vector<nfa_t::state_t> start_states { 0 };
+        nfa.close(start_states, members);
+        add_state(std::move(start_states));
+
+        for (state_t state = 0; state < m_states.size(); ++state) {
+          for (auto nfa_state: m_states[state]) {
+            for (auto&& [symbol_id, target]: nfa.edges(nfa_state)) {
+              if (buckets[symbol_id].empty()) {
+                touched_symbols.push_back(symbol_id);
+              }
+              buckets[symbol_id].push_back(target);
+            }
+          }
+          std::sort(touched_symbols.begin(), touched_symbols.end());
+          for (auto symbol_id: touched_symbols) {
+            auto& targets = buckets[symbol_id];
+            nfa.close(targets, members);
+            auto target_state = add_state(std::move(targets));
+            m_transitions[state].emplace_back(symbol_id, target_state);
+            targets.clear();
+          }
+          touched_symbols.clear();
+        }
+      }
+
+      std::size_t num_states() const
+      {
+        return m_states.size();
+      }
+
+      std::size_t num_transitions() const
+      {
+        std::size_t result = 0;
+        for (auto& transitions: m_transitions) {
+          result += transitions.size();
+        }
+        return result;
+      }
+
+      // sorted NFA states making up DFA state
+      const std::vector<nfa_t::state_t>& nfa_states(state_t state) const
+      {
+        return m_states[state];
+      }
+
+      // (symbol id, target) pairs of DFA state, sorted by symbol id
+      const std::vector<std::pair<symbol_id_t, state_t>>& transitions(state_t state) const
+      {
+        return m_transitions[state];
+      }
+
+      bool is_finalize(state_t state) const
+      {
+        return m_finalize_nfa_states[state] != nfa_t::state_t(-1);
+      }
+
+      // token of the lowest-numbered finalize NFA state in DFA state
+      const std::string& token_name(state_t state) const
+      {
+        static const std::string null_token_name;
+        return is_finalize(state) ? m_nfa.token_name(m_finalize_nfa_states[state]) : null_token_name;
+      }
+
+    private:
+      state_t add_state(std::vector<nfa_t::state_t>&& nfa_states)
+      {
+        auto it = m_state_ids.find(nfa_states);
+        if (it != m_state_ids.end()) {
+          return it->second;
+        }
+        state_t state = m_states.size();
+        auto finalize_nfa_state = nfa_t::state_t(-1);
+        for (auto nfa_state: nfa_states) {
+          if (m_nfa.is_finalize(nfa_state)) {
+            finalize_nfa_state = nfa_state;
+            break;
+          }
+        }
+        m_finalize_nfa_states.push_back(finalize_nfa_state);
+        m_transitions.emplace_back();
+        m_states.push_back(nfa_states);
+        m_state_ids.emplace(std::move(nfa_states), state);
+        return state;
+      }
+
+    private:
+      const nfa_t& m_nfa;
+      std::vector<std::vector<nfa_t::state_t>> m_states;
+      std::vector<std::vector<std::pair<symbol_id_t, state_t>>> m_transitions;
+      std::vector<nfa_t::state_t> m_finalize_nfa_states;
+      std::unordered_map<std::vector<nfa_t::state_t>, state_t, state_set_hash> m_state_ids;
+    };
+
+  } // namespace automaton
+
+} // namespace utils
+
+#endif // UTILS_AUTOMATON_SUBSET_CONSTRUCTION_HPP
@@ -0,0 +1,115 @@
+#ifndef UTILS_CONCURRENCY_SHARDED_MAP_HPP
+#define UTILS_CONCURRENCY_SHARDED_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <utils/concurrency/synchronized_resource.hpp>
+
+namespace utils {
+
+  namespace concurrency {
+
+    // hash map split into shards with a lock each, for many threads
+    // inserting at once: a key only locks the shard its hash selects.
+    // Entries never move, so the pointers handed out stay valid as long as
+    // the map. Each shard allocates from a pool of its own, guarded by the
+    // shard's lock, and only the pools' refills go to resource through one
+    // shared lock
+    template <typename Key, typename Value, typename Hash = std::hash<Key>,
+              typename KeyEqual = std::equal_to<Key>>
+    class sharded_map_t
+    {
+    public:
+      using map_t = std::pmr::unordered_map<Key, Value, Hash, KeyEqual>;
+      using value_type = typename map_t::value_type;
+
+      explicit sharded_map_t(std::size_t num_shards = 64,
+          std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : m_resource(resource)
+      {
+        num_shards = std::max<std::size_t>(num_shards, 1);
+        for (std::size_t idx = 0; idx < num_shards; ++idx) {
+          m_shards.push_back(std::make_unique<shard_t>(&m_resource));
+        }
+      }
+
+      sharded_map_t(const sharded_map_t&) = delete;
+      sharded_map_t& operator=(const sharded_map_t&) = delete;
+
+      // the entry of key, inserted with value if there was none; the
+      // second member tells whether it was inserted
+      template <typename K>
+      std::pair<value_type*, bool> try_emplace(K&& key, Value value)
+      {
+        auto& shard = shard_of(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        // look up first, emplace would copy the key into resource even
+        // when it is already there
+        auto it = shard.map.find(key);
+        if (it != shard.map.end()) {
+          return { &*it, false };
+        }
+        it = shard.map.emplace(std::forward<K>(key), std::move(value)).first;
+        return { &*it, true };
+      }
+
+      value_type* find(const Key& key)
+      {
+        auto& shard = shard_of(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.map.find(key);
+        return it == shard.map.end() ? nullptr : &*it;
+      }
+
+      std::size_t size() const
+      {
+        std::size_t size = 0;
+        for (auto&& shard: m_shards) {
+          std::lock_guard<std::mutex> lock(shard->mutex);
+          size += shard->map.size();
+        }
+        return size;
+      }
+
+      std::size_t num_shards() const
+      {
+        return m_shards.size();
+      }
+
+    private:
+      struct shard_t
+      {
+        explicit shard_t(std::pmr::memory_resource* upstream)
+        : pool(upstream), map(&pool)
+        { }
+
+        mutable std::mutex mutex;
+        std::pmr::unsynchronized_pool_resource pool;
+        map_t map;
+      };
+
+      template <typename K>
+      shard_t& shard_of(const K& key)
+      {
+        // fold in the high bits, kernel-like hashes vary most there
+        std::size_t hash = Hash()(key);
+        return *m_shards[(hash ^ (hash >> 32)) % m_shards.size()];
+      }
+
+      synchronized_resource_t m_resource;
+      std::vector<std::unique_ptr<shard_t>> m_shards;
+    };
+
+  } // namespace concurrency
+
+} // namespace utils
+
+#endif // UTILS_CONCURRENCY_SHARDED_MAP_HPP
@@ -0,0 +1,55 @@
+#ifndef UTILS_CONCURRENCY_SYNCHRONIZED_RESOURCE_HPP
+#define UTILS_CONCURRENCY_SYNCHRONIZED_RESOURCE_HPP
+
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+
+namespace utils {
+
+  namespace concurrency {
+
+    // forwards to an upstream resource under a lock, so that a resource
+    // that is not thread-safe (an arena, a counting resource) can back
+    // containers filled by several threads
+    class synchronized_resource_t : public std::pmr::memory_resource
+    {
+    public:
+      explicit synchronized_resource_t(
+          std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : m_upstream(upstream)
+      { }
+
+      std::pmr::memory_resource* upstream() const
+      {
+        return m_upstream;
+      }
+
+    private:
+      void* do_allocate(std::size_t bytes, std::size_t alignment) override
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_upstream->allocate(bytes, alignment);
+      }
+
+      void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_upstream->deallocate(pointer, bytes, alignment);
+      }
+
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+      {
+        return this == &other;
+      }
+
+    private:
+      std::pmr::memory_resource* m_upstream;
+      std::mutex m_mutex;
+    };
+
+  } // namespace concurrency
+
+} // namespace utils
+
+#endif // UTILS_CONCURRENCY_SYNCHRONIZED_RESOURCE_HPP
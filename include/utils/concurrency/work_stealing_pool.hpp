@@ -0,0 +1,182 @@
+#ifndef UTILS_CONCURRENCY_WORK_STEALING_POOL_HPP
+#define UTILS_CONCURRENCY_WORK_STEALING_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace utils {
+
+  namespace concurrency {
+
+    // fixed set of workers, each with its own task deque: a worker runs its
+    // own tasks in submission order and, when it runs out, steals from the
+    // back of another worker's deque. Tasks receive the index of the worker
+    // running them, so per-worker scratch state needs no locking
+    class work_stealing_pool_t
+    {
+    public:
+      using task_t = std::function<void(std::size_t worker)>;
+
+      explicit work_stealing_pool_t(std::size_t num_threads = std::thread::hardware_concurrency())
+      {
+        num_threads = std::max<std::size_t>(num_threads, 1);
+        for (std::size_t idx = 0; idx < num_threads; ++idx) {
+          m_queues.push_back(std::make_unique<queue_t>());
+        }
+        for (std::size_t idx = 0; idx < num_threads; ++idx) {
+          m_threads.emplace_back([this, idx]() { run(idx); });
+        }
+      }
+
+      work_stealing_pool_t(const work_stealing_pool_t&) = delete;
+      work_stealing_pool_t& operator=(const work_stealing_pool_t&) = delete;
+
+      // finishes the queued tasks before joining
+      ~work_stealing_pool_t()
+      {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_stop = true;
+        }
+        m_work_cv.notify_all();
+        for (auto& thread: m_threads) {
+          thread.join();
+        }
+      }
+
+      std::size_t size() const
+      {
+        return m_threads.size();
+      }
+
+      // queues task on the deques round robin
+      void submit(task_t task)
+      {
+        auto& queue = *m_queues[m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size()];
+        m_num_pending.fetch_add(1);
+        {
+          // counted before a worker can pop it, so its decrement never
+          // runs ahead of this increment
+          std::lock_guard<std::mutex> queue_lock(queue.mutex);
+          m_num_queued.fetch_add(1);
+          queue.tasks.push_back(std::move(task));
+        }
+        // a worker counts itself sleeping before it checks m_num_queued,
+        // so one of the two sees the other
+        if (m_num_sleeping.load() > 0) {
+          { std::lock_guard<std::mutex> lock(m_mutex); }
+          m_work_cv.notify_one();
+        }
+      }
+
+      // blocks until every submitted task has finished, rethrowing the
+      // first exception a task threw
+      void wait()
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idle_cv.wait(lock, [this]() { return m_num_pending.load() == 0; });
+        if (m_exception) {
+          std::rethrow_exception(std::exchange(m_exception, nullptr));
+        }
+      }
+
+      std::size_t num_steals() const
+      {
+        return m_num_steals.load(std::memory_order_relaxed);
+      }
+
+    private:
+      struct queue_t
+      {
+        std::mutex mutex;
+        std::deque<task_t> tasks;
+      };
+
+      bool pop(std::size_t worker, task_t& task)
+      {
+        {
+          auto& queue = *m_queues[worker];
+          std::lock_guard<std::mutex> lock(queue.mutex);
+          if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+          }
+        }
+        for (std::size_t offset = 1; offset < m_queues.size(); ++offset) {
+          auto& queue = *m_queues[(worker + offset) % m_queues.size()];
+          std::lock_guard<std::mutex> lock(queue.mutex);
+          if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            m_num_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+          }
+        }
+        return false;
+      }
+
+      void run(std::size_t worker)
+      {
+        task_t task;
+        while (true) {
+          if (pop(worker, task)) {
+            m_num_queued.fetch_sub(1);
+            try {
+              task(worker);
+            } catch (...) {
+              std::lock_guard<std::mutex> lock(m_mutex);
+              if (!m_exception) {
+                m_exception = std::current_exception();
+              }
+            }
+            task = nullptr;
+            if (m_num_pending.fetch_sub(1) == 1) {
+              { std::lock_guard<std::mutex> lock(m_mutex); }
+              m_idle_cv.notify_all();
+            }
+            continue;
+          }
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_num_sleeping.fetch_add(1);
+          m_work_cv.wait(lock, [this]() { return m_stop || m_num_queued.load() > 0; });
+          m_num_sleeping.fetch_sub(1);
+          if (m_stop && m_num_queued.load() == 0) {
+            return;
+          }
+        }
+      }
+
+      std::vector<std::unique_ptr<queue_t>> m_queues;
+      std::vector<std::thread> m_threads;
+
+      // tasks are counted without locking; the mutex is only taken to
+      // sleep, to wake sleepers and for m_stop and m_exception
+      std::atomic<std::size_t> m_next_queue { 0 };
+      std::atomic<std::size_t> m_num_queued { 0 };
+      std::atomic<std::size_t> m_num_pending { 0 };
+      std::atomic<std::size_t> m_num_sleeping { 0 };
+      std::mutex m_mutex;
+      std::condition_variable m_work_cv;
+      std::condition_variable m_idle_cv;
+      bool m_stop = false;
+      std::exception_ptr m_exception;
+
+      std::atomic<std::size_t> m_num_steals { 0 };
+    };
+
+  } // namespace concurrency
+
+} // namespace utils
+
+#endif // UTILS_CONCURRENCY_WORK_STEALING_POOL_HPP
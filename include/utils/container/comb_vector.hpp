@@ -0,0 +1,175 @@
+#ifndef UTILS_CONTAINER_COMB_VECTOR_HPP
+#define UTILS_CONTAINER_COMB_VECTOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <numeric>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <utils/hash/xxhash64.hpp>
+
+namespace utils {
+
+  namespace container {
+
+    // sparse rows of a table packed by row displacement into one array, as
+    // yacc and bison pack their parse tables: the entry of row r at column
+    // c sits at base(r) + c, tagged with c so that a lookup can tell it
+    // from the entries of other rows overlapping there. Rows with the same
+    // entries share their slots, all other rows have distinct bases
+    class comb_vector_t
+    {
+    public:
+      using row_t = std::vector<std::pair<int, int>>;
+
+      explicit comb_vector_t(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : m_base(resource), m_value(resource), m_check(resource)
+      { }
+
+      // packs rows given as (column, value) pairs by increasing column,
+      // columns non-negative; the larger rows are placed first, each at
+      // about the lowest base where it fits. Meant for narrow rows: a row
+      // as wide as the table leaves most of its span empty
+      void assign(const std::vector<row_t>& rows)
+      {
+        m_base.assign(rows.size(), empty_base);
+        m_value.clear();
+        m_check.clear();
+        m_num_entries = 0;
+
+        std::vector<std::size_t> order(rows.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(),
+            [&](std::size_t lhs, std::size_t rhs) { return rows[lhs].size() > rows[rhs].size(); });
+
+        struct row_hash
+        {
+          std::size_t operator()(const row_t& row) const
+          {
+            return hash::xxhash64(row);
+          }
+        };
+        std::unordered_map<row_t, int, row_hash> bases;
+        std::vector<bool> base_used;
+        // next_free[slot] leads to the lowest free slot at or after slot,
+        // shortened on every lookup as in union-find
+        std::vector<std::size_t> next_free;
+        std::size_t frontier = 0, max_width = 0;
+        auto find_free = [&](std::size_t slot) {
+          std::size_t root = slot;
+          while (root < next_free.size() && next_free[root] != root) {
+            root = next_free[root];
+          }
+          while (slot < next_free.size() && next_free[slot] != slot) {
+            slot = std::exchange(next_free[slot], root);
+          }
+          return root;
+        };
+        for (auto idx: order) {
+          auto& row = rows[idx];
+          if (row.empty()) {
+            break;
+          }
+          auto it = bases.find(row);
+          if (it != bases.end()) {
+            m_base[idx] = it->second;
+            continue;
+          }
+          // bases are tried where the first entry lands on a free slot,
+          // from the lowest one; past max_attempts the gaps down there are
+          // given up for the region just behind the last row placed, which
+          // keeps packing linear
+          std::size_t first_column = row.front().first, base = 0;
+          std::size_t slot = find_free(first_column);
+          max_width = std::max<std::size_t>(max_width, row.back().first - first_column + 1);
+          for (std::size_t attempt = 0;; ++attempt, slot = find_free(slot + 1)) {
+            if (attempt == max_attempts && slot < frontier) {
+              slot = find_free(std::max(frontier, first_column));
+            }
+            base = slot - first_column;
+            if (base < base_used.size() && base_used[base]) {
+              continue;
+            }
+            bool fits = std::all_of(row.begin() + 1, row.end(), [&](auto& entry) {
+              return base + entry.first >= m_check.size() || m_check[base + entry.first] == free_slot;
+            });
+            if (fits) {
+              break;
+            }
+          }
+          std::size_t end = base + row.back().first + 1;
+          if (end > m_check.size()) {
+            std::size_t size = m_check.size();
+            m_check.resize(end, free_slot);
+            m_value.resize(end, 0);
+            next_free.resize(end);
+            std::iota(next_free.begin() + size, next_free.end(), size);
+          }
+          for (auto&& [column, value]: row) {
+            m_check[base + column] = column;
+            m_value[base + column] = value;
+            next_free[base + column] = base + column + 1;
+          }
+          if (base >= base_used.size()) {
+            base_used.resize(base + 1, false);
+          }
+          base_used[base] = true;
+          frontier = std::max(frontier, base + first_column > max_width ? base + first_column - max_width : 0);
+          m_base[idx] = int(base);
+          bases.emplace(row, int(base));
+          m_num_entries += row.size();
+        }
+      }
+
+      // the value at (row, column), or missing
+      int find(std::size_t row, int column, int missing) const
+      {
+        auto slot = std::size_t(std::ptrdiff_t(m_base[row]) + column);
+        return slot < m_check.size() && m_check[slot] == column ? m_value[slot] : missing;
+      }
+
+      std::size_t num_rows() const
+      {
+        return m_base.size();
+      }
+
+      // entries stored, once for rows sharing their slots, and the slots
+      // they are spread over
+      std::size_t num_entries() const
+      {
+        return m_num_entries;
+      }
+
+      std::size_t num_slots() const
+      {
+        return m_check.size();
+      }
+
+      std::size_t bytes() const
+      {
+        return (m_base.size() + m_value.size() + m_check.size()) * sizeof(int);
+      }
+
+    private:
+      // slots are at most the number of entries plus the widest row, so a
+      // base this low keeps every lookup of an empty row out of range
+      static constexpr int empty_base = std::numeric_limits<int>::min() / 2;
+      static constexpr int free_slot = -1;
+      static constexpr std::size_t max_attempts = 256;
+
+      std::pmr::vector<int> m_base;
+      std::pmr::vector<int> m_value;
+      std::pmr::vector<int> m_check;
+      std::size_t m_num_entries = 0;
+    };
+
+  } // namespace container
+
+} // namespace utils
+
+#endif // UTILS_CONTAINER_COMB_VECTOR_HPP
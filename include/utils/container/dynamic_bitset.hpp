@@ -0,0 +1,166 @@
+#ifndef UTILS_CONTAINER_DYNAMIC_BITSET_HPP
+#define UTILS_CONTAINER_DYNAMIC_BITSET_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace utils {
+
+  namespace container {
+
+    // bitset whose size is chosen at run time, stored as 64-bit words
+    class dynamic_bitset_t
+    {
+    public:
+      using word_t = std::uint64_t;
+      static constexpr std::size_t word_bits = 64;
+
+      dynamic_bitset_t()
+      { }
+
+      explicit dynamic_bitset_t(std::size_t num_bits)
+      : m_num_bits(num_bits), m_words((num_bits + word_bits - 1) / word_bits, 0)
+      { }
+
+      std::size_t size() const
+      {
+        return m_num_bits;
+      }
+
+      void resize(std::size_t num_bits)
+      {
+        m_num_bits = num_bits;
+        m_words.resize((num_bits + word_bits - 1) / word_bits, 0);
+        clear_tail();
+      }
+
+      bool test(std::size_t idx) const
+      {
+        return (m_words[idx / word_bits] >> (idx % word_bits)) & 1;
+      }
+
+      bool operator[](std::size_t idx) const
+      {
+        return test(idx);
+      }
+
+      // sets bit idx, returns whether it was unset before
+      bool set(std::size_t idx)
+      {
+        word_t mask = word_t(1) << (idx % word_bits);
+        word_t& word = m_words[idx / word_bits];
+        bool inserted = (word & mask) == 0;
+        word |= mask;
+        return inserted;
+      }
+
+      void reset(std::size_t idx)
+      {
+        m_words[idx / word_bits] &= ~(word_t(1) << (idx % word_bits));
+      }
+
+      void reset()
+      {
+        std::fill(m_words.begin(), m_words.end(), 0);
+      }
+
+      bool any() const
+      {
+        for (auto word: m_words) {
+          if (word != 0) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      bool none() const
+      {
+        return !any();
+      }
+
+      std::size_t count() const
+      {
+        std::size_t result = 0;
+        for (auto word: m_words) {
+          result += __builtin_popcountll(word);
+        }
+        return result;
+      }
+
+      dynamic_bitset_t& operator|=(const dynamic_bitset_t& rhs)
+      {
+        for (std::size_t idx = 0; idx < m_words.size() && idx < rhs.m_words.size(); ++idx) {
+          m_words[idx] |= rhs.m_words[idx];
+        }
+        return *this;
+      }
+
+      dynamic_bitset_t& operator&=(const dynamic_bitset_t& rhs)
+      {
+        for (std::size_t idx = 0; idx < m_words.size(); ++idx) {
+          m_words[idx] &= idx < rhs.m_words.size() ? rhs.m_words[idx] : 0;
+        }
+        return *this;
+      }
+
+      // calls function(idx) for every set bit in increasing order
+      template <typename Function>
+      void for_each(Function&& function) const
+      {
+        for (std::size_t idx = 0; idx < m_words.size(); ++idx) {
+          for (word_t word = m_words[idx]; word != 0; word &= word - 1) {
+            function(idx * word_bits + __builtin_ctzll(word));
+          }
+        }
+      }
+
+      const std::vector<word_t>& words() const
+      {
+        return m_words;
+      }
+
+      friend bool operator==(const dynamic_bitset_t& lhs, const dynamic_bitset_t& rhs)
+      {
+        return lhs.m_num_bits == rhs.m_num_bits && lhs.m_words == rhs.m_words;
+      }
+
+      friend bool operator!=(const dynamic_bitset_t& lhs, const dynamic_bitset_t& rhs)
+      {
+        return !(lhs == rhs);
+      }
+
+    private:
+      void clear_tail()
+      {
+        if (m_num_bits % word_bits != 0) {
+          m_words.back() &= (word_t(1) << (m_num_bits % word_bits)) - 1;
+        }
+      }
+
+    private:
+      std::size_t m_num_bits = 0;
+      std::vector<word_t> m_words;
+    };
+
+  } // namespace container
+
+} // namespace utils
+
+template <>
+struct std::hash<utils::container::dynamic_bitset_t>
+{
+  std::size_t operator()(const utils::container::dynamic_bitset_t& bitset) const
+  {
+    std::size_t result = bitset.size();
+    for (auto word: bitset.words()) {
+      result ^= std::hash<std::uint64_t>()(word) + 0x9e3779b97f4a7c15ull + (result << 6) + (result >> 2);
+    }
+    return result;
+  }
+};
+
+#endif // UTILS_CONTAINER_DYNAMIC_BITSET_HPP
@@ -0,0 +1,143 @@
+#ifndef UTILS_CONTAINER_SPSC_RING_HPP
+#define UTILS_CONTAINER_SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace utils {
+
+  namespace container {
+
+    // bounded lock-free ring for exactly one producer and one consumer
+    // thread; capacity is rounded up to a power of two, and T need not be
+    // assignable (slots are constructed and destroyed in place)
+    template <typename T>
+    class spsc_ring_t
+    {
+    public:
+      explicit spsc_ring_t(std::size_t capacity)
+      {
+        std::size_t size = 1;
+        while (size < capacity) {
+          size <<= 1;
+        }
+        m_mask = size - 1;
+        m_slots.reset(new slot_t[size]);
+      }
+
+      spsc_ring_t(const spsc_ring_t&) = delete;
+      spsc_ring_t& operator=(const spsc_ring_t&) = delete;
+
+      ~spsc_ring_t()
+      {
+        auto head = m_head.load(std::memory_order_relaxed);
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        for (; head != tail; ++head) {
+          element(head)->~T();
+        }
+      }
+
+      std::size_t capacity() const
+      {
+        return m_mask + 1;
+      }
+
+      // producer: moves elements of [it_begin, it_end) in until the ring is
+      // full, returns the iterator to the first element not pushed
+      template <typename Iterator>
+      Iterator try_push(Iterator it_begin, Iterator it_end)
+      {
+        auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cached_head == capacity()) {
+          m_cached_head = m_head.load(std::memory_order_acquire);
+        }
+        for (; it_begin != it_end && tail - m_cached_head < capacity(); ++it_begin, ++tail) {
+          new (element(tail)) T(std::move(*it_begin));
+        }
+        m_tail.store(tail, std::memory_order_release);
+        return it_begin;
+      }
+
+      // consumer: moves up to max_count elements out through consume(T&&),
+      // returns how many
+      template <typename Consume>
+      std::size_t try_pop(Consume&& consume, std::size_t max_count)
+      {
+        auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cached_tail) {
+          m_cached_tail = m_tail.load(std::memory_order_acquire);
+        }
+        std::size_t count = 0;
+        for (; head != m_cached_tail && count < max_count; ++head, ++count) {
+          T* value = element(head);
+          consume(std::move(*value));
+          value->~T();
+        }
+        m_head.store(head, std::memory_order_release);
+        return count;
+      }
+
+      // producer: no element follows; consumer: nothing more will arrive
+      // once this is set and the ring is drained
+      void close()
+      {
+        m_closed.store(true, std::memory_order_release);
+      }
+
+      bool closed() const
+      {
+        return m_closed.load(std::memory_order_acquire);
+      }
+
+      // consumer: the producer should stop, nothing will be popped anymore
+      void cancel()
+      {
+        m_cancelled.store(true, std::memory_order_release);
+      }
+
+      bool cancelled() const
+      {
+        return m_cancelled.load(std::memory_order_acquire);
+      }
+
+      bool empty() const
+      {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+      }
+
+    private:
+      struct slot_t
+      {
+        alignas(T) unsigned char storage[sizeof(T)];
+      };
+
+      T* element(std::size_t idx)
+      {
+        return std::launder(reinterpret_cast<T*>(m_slots[idx & m_mask].storage));
+      }
+
+      // indices grow without wrapping (2^64 elements), producer and consumer
+      // state on separate cache lines, each caching the other's index
+      static constexpr std::size_t cache_line = 64;
+
+      std::unique_ptr<slot_t[]> m_slots;
+      std::size_t m_mask;
+
+      alignas(cache_line) std::atomic<std::size_t> m_tail { 0 };
+      std::size_t m_cached_head = 0;
+
+      alignas(cache_line) std::atomic<std::size_t> m_head { 0 };
+      std::size_t m_cached_tail = 0;
+
+      alignas(cache_line) std::atomic<bool> m_closed { false };
+      std::atomic<bool> m_cancelled { false };
+    };
+
+  } // namespace container
+
+} // namespace utils
+
+#endif // UTILS_CONTAINER_SPSC_RING_HPP
@@ -1,7 +1,10 @@
 #ifndef UTILS_GRAPH_DIRECTED_GRAPH_HPP
 #define UTILS_GRAPH_DIRECTED_GRAPH_HPP
 
+#include <cstddef>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
 #include <unordered_set>
 #include <unordered_map>
 #include <tuple>
@@ -22,15 +25,173 @@ namespace utils {
       using edge_description_t = std::tuple<vertex_property_pointer_t, vertex_property_pointer_t, edge_property_pointer_t>;
 
     private:
+      // every container allocates from the memory resource given at
+      // construction, nested maps included
+      using vertex_set_t = std::pmr::unordered_set<vertex_property_pointer_t>;
+      using adjacency_map_t = std::pmr::unordered_map<vertex_property_pointer_t, edge_property_pointer_t>;
+      using endpoints_map_t = std::pmr::unordered_map<
+          edge_property_pointer_t,
+          std::pair<vertex_property_pointer_t, vertex_property_pointer_t>
+      >;
+      using edge_map_t = std::pmr::unordered_map<vertex_property_pointer_t, adjacency_map_t>;
+
+    public:
+      // lightweight [begin, end) view over the graph's own containers, the
+      // view is invalidated by any modification of the graph
+      template <typename iterator_t>
+      class range_t
+      {
+      public:
+        range_t(iterator_t it_begin, iterator_t it_end)
+        : m_begin(it_begin), m_end(it_end)
+        { }
+
+        iterator_t begin() const
+        {
+          return m_begin;
+        }
+
+        iterator_t end() const
+        {
+          return m_end;
+        }
+
+        bool empty() const
+        {
+          return m_begin == m_end;
+        }
+
+      private:
+        iterator_t m_begin, m_end;
+      };
+
+      // iterates the edges of m_endpoints_map, yielding edge descriptions
+      class edge_iterator_t
+      {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = edge_description_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = edge_description_t;
+
+        edge_iterator_t() = default;
+
+        explicit edge_iterator_t(typename endpoints_map_t::const_iterator it)
+        : m_it(it)
+        { }
+
+        edge_description_t operator*() const
+        {
+          return edge_description_t(m_it->second.first, m_it->second.second, m_it->first);
+        }
+
+        edge_iterator_t& operator++()
+        {
+          ++m_it;
+          return *this;
+        }
+
+        edge_iterator_t operator++(int)
+        {
+          auto it = *this;
+          ++m_it;
+          return it;
+        }
+
+        bool operator==(const edge_iterator_t& rhs) const
+        {
+          return m_it == rhs.m_it;
+        }
+
+        bool operator!=(const edge_iterator_t& rhs) const
+        {
+          return m_it != rhs.m_it;
+        }
+
+      private:
+        typename endpoints_map_t::const_iterator m_it;
+      };
+
+      // iterates the in (or out) edges of a single vertex, yielding edge
+      // descriptions with the fixed vertex placed at the matching endpoint
+      template <bool is_in_edge>
+      class adjacent_edge_iterator_t
+      {
+      public:
+        using iterator_category = std::input_iterator_tag;
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type = edge_description_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = edge_description_t;
+
+        adjacent_edge_iterator_t() = default;
+
+        adjacent_edge_iterator_t(
+            const vertex_property_pointer_t* vertex,
+            typename adjacency_map_t::const_iterator it)
+        : m_vertex(vertex), m_it(it)
+        { }
+
+        edge_description_t operator*() const
+        {
+          if constexpr (is_in_edge) {
+            return edge_description_t(m_it->first, *m_vertex, m_it->second);
+          } else {
+            return edge_description_t(*m_vertex, m_it->first, m_it->second);
+          }
+        }
+
+        adjacent_edge_iterator_t& operator++()
+        {
+          ++m_it;
+          return *this;
+        }
+
+        adjacent_edge_iterator_t operator++(int)
+        {
+          auto it = *this;
+          ++m_it;
+          return it;
+        }
+
+        bool operator==(const adjacent_edge_iterator_t& rhs) const
+        {
+          return m_it == rhs.m_it;
+        }
+
+        bool operator!=(const adjacent_edge_iterator_t& rhs) const
+        {
+          return m_it != rhs.m_it;
+        }
+
+      private:
+        const vertex_property_pointer_t* m_vertex = nullptr;
+        typename adjacency_map_t::const_iterator m_it;
+      };
+
+      using vertex_range_t = range_t<typename vertex_set_t::const_iterator>;
+      using edge_range_t = range_t<edge_iterator_t>;
+      using in_edge_range_t = range_t<adjacent_edge_iterator_t<true>>;
+      using out_edge_range_t = range_t<adjacent_edge_iterator_t<false>>;
 
     public:
-      directed_graph_t()
+      explicit directed_graph_t(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : m_vertex_properties(resource), m_endpoints_map(resource),
+        m_edge_property_map(resource), m_in_edge_map(resource)
       { }
 
+      std::pmr::memory_resource* resource() const
+      {
+        return m_vertex_properties.get_allocator().resource();
+      }
+
       ~directed_graph_t()
       { }
 
-      bool exist_vertex(vertex_property_pointer_t vertex_property)
+      bool exist_vertex(const vertex_property_pointer_t& vertex_property) const
       {
         return m_vertex_properties.count(vertex_property) > 0;
       }
@@ -47,14 +208,15 @@ namespace utils {
       bool remove_vertex(vertex_property_pointer_t vertex_property)
       {
         if (exist_vertex(vertex_property)) {
-          for (auto&& [in, out, edge]: in_edge_descriptions(vertex_property)) {
-            remove_edge(edge);
+          // the views are invalidated by remove_edge, so always restart from
+          // the first remaining edge
+          while (in_degree(vertex_property) > 0) {
+            remove_edge(std::get<2>(*in_edge_descriptions(vertex_property).begin()));
           }
-          for (auto&& [in, out, edge]: out_edge_descriptions(vertex_property)) {
-            remove_edge(edge);
+          while (out_degree(vertex_property) > 0) {
+            remove_edge(std::get<2>(*out_edge_descriptions(vertex_property).begin()));
           }
           m_in_edge_map.erase(vertex_property);
-          m_out_edge_map.erase(vertex_property);
           m_edge_property_map.erase(vertex_property);
           m_vertex_properties.erase(vertex_property);
           return true;
@@ -62,39 +224,34 @@ namespace utils {
         return false;
       }
 
-      std::size_t num_vertices()
+      std::size_t num_vertices() const
       {
         return m_vertex_properties.size();
       }
 
-      std::vector<vertex_property_pointer_t> vertices()
+      vertex_range_t vertices() const
       {
-        std::vector<vertex_property_pointer_t> vertices(
-            m_vertex_properties.begin(), 
-            m_vertex_properties.end());
-        return vertices;
+        return vertex_range_t(m_vertex_properties.begin(), m_vertex_properties.end());
       }
 
-      bool exist_edge_with_property(edge_property_pointer_t edge_property)
+      bool exist_edge_with_property(const edge_property_pointer_t& edge_property) const
       {
-        return m_edge_properties.count(edge_property) > 0;
+        return m_endpoints_map.count(edge_property) > 0;
       }
 
-      bool exist_edge_with_endpoints(vertex_property_pointer_t vertex_in, vertex_property_pointer_t vertex_out)
+      bool exist_edge_with_endpoints(
+          const vertex_property_pointer_t& vertex_in, 
+          const vertex_property_pointer_t& vertex_out) const
       {
-        return m_edge_property_map.count(vertex_in) > 0 && m_edge_property_map[vertex_in].count(vertex_out) > 0;
+        return out_adjacency(vertex_in).count(vertex_out) > 0;
       }
 
       bool add_edge(vertex_property_pointer_t vertex_in, vertex_property_pointer_t vertex_out, edge_property_pointer_t edge_property)
       {
         if (!exist_edge_with_property(edge_property) && !exist_edge_with_endpoints(vertex_in, vertex_out)) {
-          m_edge_properties.insert(edge_property);
-
           m_endpoints_map[edge_property] = std::make_pair(vertex_in, vertex_out);
           m_edge_property_map[vertex_in][vertex_out] = edge_property;
-
-          m_in_edge_map[vertex_out].insert(vertex_in);
-          m_out_edge_map[vertex_in].insert(vertex_out);
+          m_in_edge_map[vertex_out][vertex_in] = edge_property;
           return true;
         }
         return false;
@@ -102,130 +259,143 @@ namespace utils {
 
       bool remove_edge(edge_property_pointer_t edge_property)
       {
-        if (exist_edge_with_property(edge_property)) {
-          auto& [in, out] = m_endpoints_map[edge_property];
+        auto it = m_endpoints_map.find(edge_property);
+        if (it != m_endpoints_map.end()) {
+          auto [in, out] = it->second;
           m_edge_property_map[in].erase(out);
           m_in_edge_map[out].erase(in);
-          m_out_edge_map[in].erase(out);
-          m_edge_properties.erase(edge_property);
+          m_endpoints_map.erase(it);
           return true;
         }
         return false;
       }
 
-      bool remove_edge(vertex_property_pointer_t vertex_in, vertex_property_pointer_t vertex_out)
+      bool remove_edge(const vertex_property_pointer_t& vertex_in, const vertex_property_pointer_t& vertex_out)
       {
-        if (exist_edge_with_endpoints(vertex_in, vertex_out)) {
-          return remove_edge(m_edge_property_map[vertex_in][vertex_out]);
+        auto& adjacency = out_adjacency(vertex_in);
+        auto it = adjacency.find(vertex_out);
+        if (it != adjacency.end()) {
+          return remove_edge(it->second);
         }
         return false;
       }
 
-      std::size_t num_edges()
+      std::size_t num_edges() const
       {
-        return m_edge_properties.size();
+        return m_endpoints_map.size();
       }
 
     private:
-      edge_description_t null_edge_description()
+      edge_description_t null_edge_description() const
       {
         static auto null_edge_description = std::make_tuple(vertex_property_pointer_t(), vertex_property_pointer_t(), edge_property_pointer_t());
         return null_edge_description;
       }
 
+      const adjacency_map_t& null_adjacency() const
+      {
+        static const adjacency_map_t null_adjacency;
+        return null_adjacency;
+      }
+
+      const adjacency_map_t& in_adjacency(const vertex_property_pointer_t& vertex_out) const
+      {
+        auto it = m_in_edge_map.find(vertex_out);
+        return it == m_in_edge_map.end() ? null_adjacency() : it->second;
+      }
+
+      const adjacency_map_t& out_adjacency(const vertex_property_pointer_t& vertex_in) const
+      {
+        auto it = m_edge_property_map.find(vertex_in);
+        return it == m_edge_property_map.end() ? null_adjacency() : it->second;
+      }
+
+      template <bool is_in_edge>
+      range_t<adjacent_edge_iterator_t<is_in_edge>> adjacent_edges(
+          const edge_map_t& edge_map,
+          const vertex_property_pointer_t& vertex) const
+      {
+        // the fixed endpoint is referenced from the key stored in edge_map, so
+        // the view never dangles on a temporary vertex pointer
+        auto it = edge_map.find(vertex);
+        if (it == edge_map.end()) {
+          return range_t<adjacent_edge_iterator_t<is_in_edge>>(
+              adjacent_edge_iterator_t<is_in_edge>(nullptr, null_adjacency().begin()),
+              adjacent_edge_iterator_t<is_in_edge>(nullptr, null_adjacency().end()));
+        }
+        return range_t<adjacent_edge_iterator_t<is_in_edge>>(
+            adjacent_edge_iterator_t<is_in_edge>(&it->first, it->second.begin()),
+            adjacent_edge_iterator_t<is_in_edge>(&it->first, it->second.end()));
+      }
+
     public:
-      std::pair<edge_description_t, bool> edge_description(vertex_property_pointer_t vertex_in, vertex_property_pointer_t vertex_out)
+      std::pair<edge_description_t, bool> edge_description(
+          const vertex_property_pointer_t& vertex_in, 
+          const vertex_property_pointer_t& vertex_out) const
       {
-        if (exist_edge_with_endpoints(vertex_in, vertex_out)) {
+        auto& adjacency = out_adjacency(vertex_in);
+        auto it = adjacency.find(vertex_out);
+        if (it != adjacency.end()) {
           return std::make_pair(
-              std::make_tuple(vertex_in, vertex_out, m_edge_property_map[vertex_in][vertex_out]), 
+              std::make_tuple(vertex_in, vertex_out, it->second), 
               true
           );
         }
         return std::make_pair(null_edge_description(), false);
       }
 
-      std::pair<edge_description_t, bool> edge_description(edge_property_pointer_t edge_property)
+      std::pair<edge_description_t, bool> edge_description(const edge_property_pointer_t& edge_property) const
       {
-        if (exist_edge_with_property(edge_property)) {
-          auto endpoints = m_endpoints_map[edge_property];
+        auto it = m_endpoints_map.find(edge_property);
+        if (it != m_endpoints_map.end()) {
           return std::make_pair(
-              std::make_tuple(endpoints.first, endpoints.second, edge_property), 
+              std::make_tuple(it->second.first, it->second.second, edge_property), 
               true
           );
         }
         return std::make_pair(null_edge_description(), false);
       }
 
-      std::vector<edge_description_t> edge_descriptions()
+      edge_range_t edge_descriptions() const
       {
-        std::vector<edge_description_t> edge_descriptions;
-        for (auto it0: m_edge_property_map) {
-          for (auto it1: it0.second) {
-            edge_descriptions.emplace_back(it0.first, it1.first, it1.second);
-          }
-        }
-        return edge_descriptions;
+        return edges();
       }
 
-      std::size_t in_degree(vertex_property_pointer_t vertex_out)
+      std::size_t in_degree(const vertex_property_pointer_t& vertex_out) const
       {
-        return m_in_edge_map[vertex_out].size();
+        return in_adjacency(vertex_out).size();
       }
 
-      std::vector<edge_description_t> in_edge_descriptions(vertex_property_pointer_t vertex_out)
+      in_edge_range_t in_edge_descriptions(const vertex_property_pointer_t& vertex_out) const
       {
-        std::vector<edge_description_t> edge_descriptions;
-        for (auto& vertex_in: m_in_edge_map[vertex_out]) {
-          edge_descriptions.push_back(edge_description(vertex_in, vertex_out).first);
-        }
-        return edge_descriptions;
+        return adjacent_edges<true>(m_in_edge_map, vertex_out);
       }
 
-      std::size_t out_degree(vertex_property_pointer_t vertex_in)
+      std::size_t out_degree(const vertex_property_pointer_t& vertex_in) const
       {
-        return m_out_edge_map[vertex_in].size();
+        return out_adjacency(vertex_in).size();
       }
 
-      std::vector<edge_description_t> out_edge_descriptions(vertex_property_pointer_t vertex_in)
+      out_edge_range_t out_edge_descriptions(const vertex_property_pointer_t& vertex_in) const
       {
-        std::vector<edge_description_t> edge_descriptions;
-        for (auto& vertex_out: m_out_edge_map[vertex_in]) {
-          edge_descriptions.push_back(edge_description(vertex_in, vertex_out).first);
-        }
-        return edge_descriptions;
+        return adjacent_edges<false>(m_edge_property_map, vertex_in);
       }
 
-      std::vector<edge_description_t> edges()
+      edge_range_t edges() const
       {
-        std::vector<edge_description_t> edges;
-        for (auto& edge_property: m_edge_properties) {
-          edges.push_back(edge_description(edge_property).first);
-        }
-        return edges;
+        return edge_range_t(
+            edge_iterator_t(m_endpoints_map.begin()),
+            edge_iterator_t(m_endpoints_map.end()));
       }
 
     private:
-      std::unordered_set<vertex_property_pointer_t> m_vertex_properties;
-      std::unordered_set<edge_property_pointer_t> m_edge_properties;
+      vertex_set_t m_vertex_properties;
 
-      std::unordered_map<
-          edge_property_pointer_t,
-          std::pair<vertex_property_pointer_t, vertex_property_pointer_t>
-      > m_endpoints_map;
-      std::unordered_map<
-          vertex_property_pointer_t, 
-          std::unordered_map<vertex_property_pointer_t, edge_property_pointer_t>
-      > m_edge_property_map;
-
-      std::unordered_map<
-          vertex_property_pointer_t, 
-          std::unordered_set<vertex_property_pointer_t>
-      > m_in_edge_map;
-      std::unordered_map<
-          vertex_property_pointer_t, 
-          std::unordered_set<vertex_property_pointer_t>
-      > m_out_edge_map;
+      endpoints_map_t m_endpoints_map;
+      // vertex_in -> vertex_out -> edge
+      edge_map_t m_edge_property_map;
+      // vertex_out -> vertex_in -> edge
+      edge_map_t m_in_edge_map;
     };
 
   } // namespace graph
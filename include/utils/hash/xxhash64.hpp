@@ -0,0 +1,118 @@
+#ifndef UTILS_HASH_XXHASH64_HPP
+#define UTILS_HASH_XXHASH64_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace utils {
+
+  namespace hash {
+
+    namespace detail {
+
+      constexpr std::uint64_t prime_1 = 11400714785074694791ull;
+      constexpr std::uint64_t prime_2 = 14029467366897019727ull;
+      constexpr std::uint64_t prime_3 = 1609587929392839161ull;
+      constexpr std::uint64_t prime_4 = 9650029242287828579ull;
+      constexpr std::uint64_t prime_5 = 2870177450012600261ull;
+
+      inline std::uint64_t rotl(std::uint64_t value, int bits)
+      {
+        return (value << bits) | (value >> (64 - bits));
+      }
+
+      inline std::uint64_t read_64(const unsigned char* bytes)
+      {
+        std::uint64_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+      }
+
+      inline std::uint32_t read_32(const unsigned char* bytes)
+      {
+        std::uint32_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+      }
+
+      inline std::uint64_t round(std::uint64_t accumulator, std::uint64_t input)
+      {
+        accumulator += input * prime_2;
+        return rotl(accumulator, 31) * prime_1;
+      }
+
+      inline std::uint64_t merge_round(std::uint64_t hash, std::uint64_t accumulator)
+      {
+        hash ^= round(0, accumulator);
+        return hash * prime_1 + prime_4;
+      }
+
+    } // namespace detail
+
+    // XXH64 of [data, data + length), reading the input as little-endian
+    // words like the reference implementation does on x86 and ARM
+    inline std::uint64_t xxhash64(const void* data, std::size_t length, std::uint64_t seed = 0)
+    {
+      using namespace detail;
+      auto bytes = static_cast<const unsigned char*>(data);
+      auto end = bytes + length;
+      std::uint64_t hash;
+      if (length >= 32) {
+        std::uint64_t v1 = seed + prime_1 + prime_2, v2 = seed + prime_2, v3 = seed, v4 = seed - prime_1;
+        for (auto limit = end - 32; bytes <= limit; bytes += 32) {
+          v1 = round(v1, read_64(bytes));
+          v2 = round(v2, read_64(bytes + 8));
+          v3 = round(v3, read_64(bytes + 16));
+          v4 = round(v4, read_64(bytes + 24));
+        }
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = merge_round(hash, v1);
+        hash = merge_round(hash, v2);
+        hash = merge_round(hash, v3);
+        hash = merge_round(hash, v4);
+      } else {
+        hash = seed + prime_5;
+      }
+      hash += length;
+      for (; bytes + 8 <= end; bytes += 8) {
+        hash ^= round(0, read_64(bytes));
+        hash = rotl(hash, 27) * prime_1 + prime_4;
+      }
+      if (bytes + 4 <= end) {
+        hash ^= std::uint64_t(read_32(bytes)) * prime_1;
+        hash = rotl(hash, 23) * prime_2 + prime_3;
+        bytes += 4;
+      }
+      for (; bytes < end; ++bytes) {
+        hash ^= *bytes * prime_5;
+        hash = rotl(hash, 11) * prime_1;
+      }
+      hash ^= hash >> 33;
+      hash *= prime_2;
+      hash ^= hash >> 29;
+      hash *= prime_3;
+      hash ^= hash >> 32;
+      return hash;
+    }
+
+    inline std::uint64_t xxhash64(std::string_view bytes, std::uint64_t seed = 0)
+    {
+      return xxhash64(bytes.data(), bytes.size(), seed);
+    }
+
+    // hash of a table of trivially copyable values without padding, chained
+    // through seed so several tables fold into one fingerprint
+    template <typename T, typename Allocator>
+    std::uint64_t xxhash64(const std::vector<T, Allocator>& values, std::uint64_t seed = 0)
+    {
+      return xxhash64(values.data(), values.size() * sizeof(T), seed);
+    }
+
+  } // namespace hash
+
+} // namespace utils
+
+#endif // UTILS_HASH_XXHASH64_HPP
@@ -0,0 +1,447 @@
+#ifndef UTILS_IO_BATCH_READER_HPP
+#define UTILS_IO_BATCH_READER_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define UTILS_IO_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace utils {
+
+  namespace io {
+
+    // reads many whole files, handing each one to a callback as soon as it
+    // is complete. On Linux the opens, reads and closes of up to
+    // queue_depth files are in flight at once through io_uring, reading
+    // into registered buffers; without io_uring (old kernel, seccomp,
+    // io_uring_disabled) every file is read with open, fstat, pread and
+    // close. Files are assumed not to shrink or grow while being read
+    class batch_reader_t
+    {
+    public:
+      explicit batch_reader_t(bool use_io_uring = true,
+          unsigned queue_depth = 64, std::size_t buffer_size = 1 << 16)
+      : m_queue_depth(std::max(queue_depth, 1u)), m_buffer_size(std::max<std::size_t>(buffer_size, 4096))
+      {
+#if defined(UTILS_IO_HAS_IO_URING)
+        if (use_io_uring) {
+          setup_ring();
+        } else {
+          m_error = "io_uring not requested";
+        }
+#else
+        m_error = "io_uring is only available on Linux";
+        (void)use_io_uring;
+#endif
+      }
+
+      batch_reader_t(const batch_reader_t&) = delete;
+      batch_reader_t& operator=(const batch_reader_t&) = delete;
+
+      ~batch_reader_t()
+      {
+#if defined(UTILS_IO_HAS_IO_URING)
+        teardown_ring();
+#endif
+      }
+
+      bool uses_io_uring() const
+      {
+        return m_ring_fd >= 0;
+      }
+
+      // why io_uring is not used, or whether buffers could not be registered
+      const std::string& error() const
+      {
+        return m_error;
+      }
+
+      // system calls made by read() so far
+      std::size_t num_syscalls() const
+      {
+        return m_num_syscalls;
+      }
+
+      // calls on_file(index, content, error) once for every path, in
+      // completion order; error is 0 or an errno value and content is only
+      // valid during the call
+      template <typename OnFile>
+      void read(const std::vector<std::string>& paths, OnFile&& on_file)
+      {
+#if defined(UTILS_IO_HAS_IO_URING)
+        if (uses_io_uring()) {
+          read_io_uring(paths, on_file);
+          return;
+        }
+#endif
+        for (std::size_t idx = 0; idx < paths.size(); ++idx) {
+          int error = read_pread(paths[idx], m_content);
+          on_file(idx, std::string_view(m_content), error);
+        }
+      }
+
+    private:
+      int read_pread(const std::string& path, std::string& content)
+      {
+        content.clear();
+#if defined(__unix__)
+        ++m_num_syscalls;
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+          return errno;
+        }
+        int error = 0;
+        struct stat status;
+        ++m_num_syscalls;
+        if (::fstat(fd, &status) < 0) {
+          error = errno;
+        } else {
+          content.resize(status.st_size);
+          std::size_t length = 0;
+          while (length < content.size()) {
+            ++m_num_syscalls;
+            auto num_read = ::pread(fd, &content[length], content.size() - length, length);
+            if (num_read < 0 && errno == EINTR) {
+              continue;
+            }
+            if (num_read <= 0) {
+              error = num_read < 0 ? errno : 0;
+              break;
+            }
+            length += num_read;
+          }
+          content.resize(length);
+        }
+        ++m_num_syscalls;
+        ::close(fd);
+        return error;
+#else
+        std::FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+          return errno;
+        }
+        char buffer[1 << 14];
+        for (std::size_t length; (length = std::fread(buffer, 1, sizeof buffer, file)) > 0; ) {
+          content.append(buffer, length);
+        }
+        std::fclose(file);
+        return 0;
+#endif
+      }
+
+#if defined(UTILS_IO_HAS_IO_URING)
+      // user_data of a close, whose completion is only counted
+      static constexpr std::uint64_t close_flag = std::uint64_t(1) << 63;
+
+      enum class slot_state_t { idle, opening, reading };
+
+      struct slot_t
+      {
+        slot_state_t state = slot_state_t::idle;
+        std::size_t index = 0;
+        int fd = -1;
+        std::uint64_t offset = 0;
+        // bytes of the file before the ones in the slot's buffer
+        std::string content;
+      };
+
+      void setup_ring()
+      {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        // every slot has at most an open or read and a close in flight
+        int fd = (int)syscall(__NR_io_uring_setup, 2 * m_queue_depth, &params);
+        if (fd < 0) {
+          m_error = std::string("io_uring_setup: ") + std::strerror(errno);
+          return;
+        }
+        m_ring_fd = fd;
+        m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single_mmap) {
+          m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+        }
+        m_sq_ring = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        m_cq_ring = single_mmap ? m_sq_ring
+            : mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+        m_sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (m_sq_ring == MAP_FAILED || m_cq_ring == MAP_FAILED || m_sqes == MAP_FAILED) {
+          m_error = std::string("io_uring mmap: ") + std::strerror(errno);
+          teardown_ring();
+          return;
+        }
+        auto sq = static_cast<char*>(m_sq_ring);
+        m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        auto cq = static_cast<char*>(m_cq_ring);
+        m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+        m_slots.resize(m_queue_depth);
+        m_buffers.reset(new char[m_queue_depth * m_buffer_size]);
+        std::vector<iovec> iovecs(m_queue_depth);
+        for (unsigned slot = 0; slot < m_queue_depth; ++slot) {
+          iovecs[slot].iov_base = m_buffers.get() + slot * m_buffer_size;
+          iovecs[slot].iov_len = m_buffer_size;
+        }
+        // registering pins the buffers, which RLIMIT_MEMLOCK may refuse;
+        // plain reads into the same buffers are used then
+        m_fixed_buffers = syscall(__NR_io_uring_register, fd, IORING_REGISTER_BUFFERS,
+            iovecs.data(), m_queue_depth) == 0;
+        if (!m_fixed_buffers) {
+          m_error = std::string("io_uring buffers not registered: ") + std::strerror(errno);
+        }
+      }
+
+      void teardown_ring()
+      {
+        if (m_sqes && m_sqes != MAP_FAILED) {
+          munmap(m_sqes, m_sqes_size);
+        }
+        if (m_cq_ring && m_cq_ring != MAP_FAILED && m_cq_ring != m_sq_ring) {
+          munmap(m_cq_ring, m_cq_size);
+        }
+        if (m_sq_ring && m_sq_ring != MAP_FAILED) {
+          munmap(m_sq_ring, m_sq_size);
+        }
+        m_sqes = m_cq_ring = m_sq_ring = nullptr;
+        if (m_ring_fd >= 0) {
+          ::close(m_ring_fd);
+          m_ring_fd = -1;
+        }
+      }
+
+      io_uring_sqe* next_sqe(std::uint64_t user_data)
+      {
+        // only this thread produces, the kernel reads the tail
+        unsigned tail = *m_sq_tail;
+        unsigned idx = tail & m_sq_mask;
+        auto sqe = static_cast<io_uring_sqe*>(m_sqes) + idx;
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->user_data = user_data;
+        m_sq_array[idx] = idx;
+        __atomic_store_n(m_sq_tail, tail + 1, __ATOMIC_RELEASE);
+        ++m_num_to_submit;
+        return sqe;
+      }
+
+      void submit_open(unsigned slot, const std::string& path)
+      {
+        auto sqe = next_sqe(slot);
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<std::uint64_t>(path.c_str());
+        sqe->open_flags = O_RDONLY | O_CLOEXEC;
+      }
+
+      void submit_read(unsigned slot)
+      {
+        auto sqe = next_sqe(slot);
+        sqe->opcode = m_fixed_buffers ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        sqe->fd = m_slots[slot].fd;
+        sqe->addr = reinterpret_cast<std::uint64_t>(m_buffers.get() + slot * m_buffer_size);
+        sqe->len = m_buffer_size;
+        sqe->off = m_slots[slot].offset;
+        if (m_fixed_buffers) {
+          sqe->buf_index = slot;
+        }
+      }
+
+      void submit_close(int fd)
+      {
+        auto sqe = next_sqe(close_flag);
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->fd = fd;
+        ++m_num_closing;
+      }
+
+      // submits the queued entries and waits for min_complete completions,
+      // false if the ring itself fails
+      bool enter(unsigned min_complete)
+      {
+        while (true) {
+          ++m_num_syscalls;
+          int result = (int)syscall(__NR_io_uring_enter, m_ring_fd, m_num_to_submit, min_complete,
+              min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+          if (result >= 0) {
+            m_num_to_submit -= std::min<unsigned>(result, m_num_to_submit);
+            return true;
+          }
+          if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            m_error = std::string("io_uring_enter: ") + std::strerror(errno);
+            return false;
+          }
+        }
+      }
+
+      template <typename OnFile>
+      void read_io_uring(const std::vector<std::string>& paths, OnFile& on_file)
+      {
+        std::size_t next_path = 0, num_done = 0;
+        auto start_next = [&](unsigned slot) {
+          auto& state = m_slots[slot];
+          state.state = slot_state_t::idle;
+          if (next_path < paths.size()) {
+            state.state = slot_state_t::opening;
+            state.index = next_path++;
+            state.offset = 0;
+            state.content.clear();
+            submit_open(slot, paths[state.index]);
+          }
+        };
+        auto finish = [&](unsigned slot, std::string_view content, int error) {
+          auto& state = m_slots[slot];
+          on_file(state.index, content, error);
+          ++num_done;
+          if (state.fd >= 0) {
+            submit_close(state.fd);
+            state.fd = -1;
+          }
+          start_next(slot);
+        };
+
+        for (unsigned slot = 0; slot < m_queue_depth; ++slot) {
+          start_next(slot);
+        }
+        while (num_done < paths.size()) {
+          if (!enter(1)) {
+            // give up on the ring, the files in flight are read again from
+            // the start with pread, as is the rest
+            std::vector<std::size_t> in_flight;
+            for (auto& state: m_slots) {
+              if (state.state != slot_state_t::idle) {
+                in_flight.push_back(state.index);
+                state.state = slot_state_t::idle;
+              }
+              if (state.fd >= 0) {
+                ::close(state.fd);
+                state.fd = -1;
+              }
+            }
+            teardown_ring();
+            for (auto index: in_flight) {
+              int error = read_pread(paths[index], m_content);
+              on_file(index, std::string_view(m_content), error);
+            }
+            for (; next_path < paths.size(); ++next_path) {
+              int error = read_pread(paths[next_path], m_content);
+              on_file(next_path, std::string_view(m_content), error);
+            }
+            return;
+          }
+          unsigned head = *m_cq_head;
+          unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+          for (; head != tail; ++head) {
+            auto cqe = m_cqes[head & m_cq_mask];
+            // release the entry before handling it, which queues new ones
+            __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+            if (cqe.user_data & close_flag) {
+              --m_num_closing;
+              continue;
+            }
+            unsigned slot = (unsigned)cqe.user_data;
+            auto& state = m_slots[slot];
+            if (state.state == slot_state_t::opening) {
+              if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                // kernel without IORING_OP_OPENAT
+                int error = read_pread(paths[state.index], m_content);
+                finish(slot, m_content, error);
+              } else if (cqe.res < 0) {
+                finish(slot, std::string_view(), -cqe.res);
+              } else {
+                state.fd = cqe.res;
+                state.state = slot_state_t::reading;
+                submit_read(slot);
+              }
+            } else if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN) {
+              finish(slot, std::string_view(), -cqe.res);
+            } else if (cqe.res < 0 || cqe.res == (int)m_buffer_size) {
+              // full buffer, there may be more
+              if (cqe.res > 0) {
+                state.content.append(m_buffers.get() + slot * m_buffer_size, cqe.res);
+                state.offset += cqe.res;
+              }
+              submit_read(slot);
+            } else {
+              const char* buffer = m_buffers.get() + slot * m_buffer_size;
+              if (state.content.empty()) {
+                // the whole file is in the buffer, handed out without a copy
+                finish(slot, std::string_view(buffer, cqe.res), 0);
+              } else {
+                state.content.append(buffer, cqe.res);
+                finish(slot, state.content, 0);
+              }
+            }
+          }
+        }
+        // the last closes, so no descriptor outlives read()
+        while (m_num_closing > 0 && enter(1)) {
+          unsigned head = *m_cq_head;
+          unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+          for (; head != tail; ++head) {
+            m_num_closing -= (m_cqes[head & m_cq_mask].user_data & close_flag) != 0;
+          }
+          __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+        }
+      }
+
+      int m_ring_fd = -1;
+      void* m_sq_ring = nullptr;
+      void* m_cq_ring = nullptr;
+      void* m_sqes = nullptr;
+      std::size_t m_sq_size = 0, m_cq_size = 0, m_sqes_size = 0;
+      unsigned* m_sq_tail = nullptr;
+      unsigned* m_sq_array = nullptr;
+      unsigned m_sq_mask = 0;
+      unsigned* m_cq_head = nullptr;
+      unsigned* m_cq_tail = nullptr;
+      unsigned m_cq_mask = 0;
+      io_uring_cqe* m_cqes = nullptr;
+      unsigned m_num_to_submit = 0;
+      std::size_t m_num_closing = 0;
+
+      bool m_fixed_buffers = false;
+      std::unique_ptr<char[]> m_buffers;
+      std::vector<slot_t> m_slots;
+#else
+      int m_ring_fd = -1;
+#endif
+
+      unsigned m_queue_depth;
+      std::size_t m_buffer_size;
+      std::string m_error;
+      std::size_t m_num_syscalls = 0;
+      // file read by the pread fallback
+      std::string m_content;
+    };
+
+  } // namespace io
+
+} // namespace utils
+
+#endif // UTILS_IO_BATCH_READER_HPP
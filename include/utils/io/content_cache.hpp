@@ -0,0 +1,220 @@
+#ifndef UTILS_IO_CONTENT_CACHE_HPP
+#define UTILS_IO_CONTENT_CACHE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#if defined(__unix__)
+#include <unistd.h>
+#endif
+
+#include <utils/hash/xxhash64.hpp>
+
+namespace utils {
+
+  namespace io {
+
+    // on-disk cache of byte strings keyed by a content hash and a context
+    // hash (whatever else the value depends on), one file per entry under
+    // directory/xx/. Entries are written to a temporary file and renamed
+    // into place, so concurrent processes never see a partial entry; a read
+    // checks the header, the key and a hash of the payload and treats
+    // anything else as a miss. A hit refreshes the entry's modification
+    // time, which evict() uses as the LRU order. Entries use host byte
+    // order
+    class content_cache_t
+    {
+    public:
+      content_cache_t(const std::string& directory, std::uint64_t max_bytes = std::uint64_t(1) << 30)
+      : m_directory(directory), m_max_bytes(max_bytes)
+      {
+        std::error_code error;
+        std::filesystem::create_directories(m_directory, error);
+      }
+
+      const std::filesystem::path& directory() const
+      {
+        return m_directory;
+      }
+
+      bool get(std::uint64_t content_hash, std::uint64_t context_hash, std::string& payload)
+      {
+        auto path = entry_path(content_hash, context_hash);
+        std::ifstream entry_in_stream(path, std::ios::binary | std::ios::ate);
+        if (!entry_in_stream) {
+          ++m_num_misses;
+          return false;
+        }
+        auto size = std::uint64_t(entry_in_stream.tellg());
+        header_t header;
+        if (size < sizeof(header)
+            || !entry_in_stream.seekg(0).read(reinterpret_cast<char*>(&header), sizeof(header))
+            || header.magic != magic || header.version != version
+            || header.content_hash != content_hash || header.context_hash != context_hash
+            || header.payload_size != size - sizeof(header)) {
+          ++m_num_misses;
+          return false;
+        }
+        payload.resize(header.payload_size);
+        if (!entry_in_stream.read(payload.data(), payload.size())
+            || hash::xxhash64(payload) != header.payload_hash) {
+          ++m_num_misses;
+          return false;
+        }
+        std::error_code error;
+        std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+        ++m_num_hits;
+        return true;
+      }
+
+      bool put(std::uint64_t content_hash, std::uint64_t context_hash, std::string_view payload)
+      {
+        auto path = entry_path(content_hash, context_hash);
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+        auto temporary_path = path;
+        temporary_path += temporary_suffix();
+
+        header_t header { magic, version, content_hash, context_hash,
+                          payload.size(), hash::xxhash64(payload) };
+        {
+          std::ofstream entry_out_stream(temporary_path, std::ios::binary | std::ios::trunc);
+          if (!entry_out_stream
+              || !entry_out_stream.write(reinterpret_cast<const char*>(&header), sizeof(header))
+              || !entry_out_stream.write(payload.data(), payload.size())
+              || !entry_out_stream.flush()) {
+            std::filesystem::remove(temporary_path, error);
+            return false;
+          }
+        }
+        std::filesystem::rename(temporary_path, path, error);
+        if (error) {
+          std::filesystem::remove(temporary_path, error);
+          return false;
+        }
+        ++m_num_writes;
+        return true;
+      }
+
+      // removes the least recently used entries until the cache holds at
+      // most 90% of max_bytes, and temporary files left behind by crashed
+      // writers; returns the number of files removed
+      std::size_t evict()
+      {
+        using clock = std::filesystem::file_time_type::clock;
+        std::vector<std::tuple<std::filesystem::file_time_type, std::uint64_t, std::filesystem::path>> entries;
+        std::uint64_t total_bytes = 0;
+        std::size_t num_removed = 0;
+        std::error_code error;
+        auto stale_time = clock::now() - std::chrono::hours(1);
+        for (auto&& entry: std::filesystem::recursive_directory_iterator(m_directory, error)) {
+          if (!entry.is_regular_file(error)) {
+            continue;
+          }
+          auto size = entry.file_size(error);
+          auto time = entry.last_write_time(error);
+          if (error) {
+            continue;
+          }
+          if (entry.path().filename().string().find(".tmp.") != std::string::npos) {
+            if (time < stale_time && std::filesystem::remove(entry.path(), error)) {
+              ++num_removed;
+            }
+            continue;
+          }
+          total_bytes += size;
+          entries.emplace_back(time, size, entry.path());
+        }
+        if (total_bytes <= m_max_bytes) {
+          return num_removed;
+        }
+        std::sort(entries.begin(), entries.end());
+        auto target_bytes = m_max_bytes / 10 * 9;
+        for (auto&& [time, size, path]: entries) {
+          if (total_bytes <= target_bytes) {
+            break;
+          }
+          // another process may have removed or refreshed it meanwhile
+          if (std::filesystem::remove(path, error)) {
+            ++num_removed;
+          }
+          total_bytes -= size;
+        }
+        return num_removed;
+      }
+
+      std::size_t num_hits() const
+      {
+        return m_num_hits;
+      }
+
+      std::size_t num_misses() const
+      {
+        return m_num_misses;
+      }
+
+      std::size_t num_writes() const
+      {
+        return m_num_writes;
+      }
+
+    private:
+      static constexpr std::uint32_t magic = 0x43434531; // "CCE1"
+      static constexpr std::uint32_t version = 1;
+
+      struct header_t
+      {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t content_hash;
+        std::uint64_t context_hash;
+        std::uint64_t payload_size;
+        std::uint64_t payload_hash;
+      };
+
+      std::filesystem::path entry_path(std::uint64_t content_hash, std::uint64_t context_hash) const
+      {
+        char name[40];
+        std::snprintf(name, sizeof(name), "%016llx%016llx",
+            (unsigned long long)content_hash, (unsigned long long)context_hash);
+        return m_directory / std::string(name, 2) / std::string(name + 2);
+      }
+
+      // unique per process, thread and call
+      std::string temporary_suffix()
+      {
+        long long pid = 0;
+#if defined(__unix__)
+        pid = ::getpid();
+#endif
+        return ".tmp." + std::to_string(pid) + "."
+            + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + "."
+            + std::to_string(m_num_temporaries++);
+      }
+
+      std::filesystem::path m_directory;
+      std::uint64_t m_max_bytes;
+      std::atomic<std::size_t> m_num_hits { 0 };
+      std::atomic<std::size_t> m_num_misses { 0 };
+      std::atomic<std::size_t> m_num_writes { 0 };
+      std::atomic<std::size_t> m_num_temporaries { 0 };
+    };
+
+  } // namespace io
+
+} // namespace utils
+
+#endif // UTILS_IO_CONTENT_CACHE_HPP
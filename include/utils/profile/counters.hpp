@@ -0,0 +1,95 @@
+#ifndef UTILS_PROFILE_COUNTERS_HPP
+#define UTILS_PROFILE_COUNTERS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+  namespace profile {
+
+    // dense hit counters indexed by a small id (rule id, state id, ...),
+    // grown on demand
+    class counter_table_t
+    {
+    public:
+      void hit(std::size_t id)
+      {
+        if (id >= m_counts.size()) {
+          m_counts.resize(id + 1, 0);
+        }
+        ++m_counts[id];
+      }
+
+      std::uint64_t count(std::size_t id) const
+      {
+        return id < m_counts.size() ? m_counts[id] : 0;
+      }
+
+      std::uint64_t total() const
+      {
+        return std::accumulate(m_counts.begin(), m_counts.end(), std::uint64_t(0));
+      }
+
+      const std::vector<std::uint64_t>& counts() const
+      {
+        return m_counts;
+      }
+
+      void clear()
+      {
+        m_counts.clear();
+      }
+
+      // the max_rows most frequent ids, by decreasing count, with their
+      // share of the total; label(id) names an id
+      template <typename Label>
+      void report(std::ostream& out_stream, const std::string& title, Label&& label,
+          std::size_t max_rows = 20) const
+      {
+        std::vector<std::size_t> ids;
+        for (std::size_t id = 0; id < m_counts.size(); ++id) {
+          if (m_counts[id] > 0) {
+            ids.push_back(id);
+          }
+        }
+        std::stable_sort(ids.begin(), ids.end(), [&](std::size_t lhs, std::size_t rhs) {
+          return m_counts[lhs] > m_counts[rhs];
+        });
+        auto sum = total();
+        auto flags = out_stream.flags();
+        auto precision = out_stream.precision();
+        out_stream << title << ": " << sum << " hits over " << ids.size() << " ids\n";
+        for (std::size_t row = 0; row < ids.size() && row < max_rows; ++row) {
+          auto id = ids[row];
+          out_stream << "  " << std::right << std::setw(12) << m_counts[id]
+                     << std::setw(8) << std::fixed << std::setprecision(2)
+                     << 100.0 * m_counts[id] / sum << "%  " << label(id) << "\n";
+        }
+        out_stream.flags(flags);
+        out_stream.precision(precision);
+      }
+
+    private:
+      std::vector<std::uint64_t> m_counts;
+    };
+
+  } // namespace profile
+
+} // namespace utils
+
+// UTILS_PROFILE_COUNT(table, id) counts a hit only when the translation
+// unit is compiled with UTILS_PROFILE_ENABLE_COUNTERS, and is nothing
+// otherwise
+#ifdef UTILS_PROFILE_ENABLE_COUNTERS
+#define UTILS_PROFILE_COUNT(table, id) (table).hit(id)
+#else
+#define UTILS_PROFILE_COUNT(table, id) ((void)0)
+#endif
+
+#endif // UTILS_PROFILE_COUNTERS_HPP
@@ -0,0 +1,86 @@
+#ifndef UTILS_PROFILE_COUNTING_RESOURCE_HPP
+#define UTILS_PROFILE_COUNTING_RESOURCE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+
+namespace utils {
+
+  namespace profile {
+
+    // forwards to an upstream resource, counting what one component asks
+    // for; give every component its own instance to split the totals
+    class counting_resource_t : public std::pmr::memory_resource
+    {
+    public:
+      explicit counting_resource_t(
+          std::pmr::memory_resource* upstream = std::pmr::get_default_resource())
+      : m_upstream(upstream)
+      { }
+
+      std::pmr::memory_resource* upstream() const
+      {
+        return m_upstream;
+      }
+
+      // bytes and allocations requested in total, deallocations not
+      // subtracted
+      std::size_t bytes_requested() const
+      {
+        return m_bytes_requested.load(std::memory_order_relaxed);
+      }
+
+      std::size_t num_allocations() const
+      {
+        return m_num_allocations.load(std::memory_order_relaxed);
+      }
+
+      // bytes currently allocated and their high-water mark
+      std::size_t bytes_in_use() const
+      {
+        return m_bytes_in_use.load(std::memory_order_relaxed);
+      }
+
+      std::size_t peak_bytes_in_use() const
+      {
+        return m_peak_bytes_in_use.load(std::memory_order_relaxed);
+      }
+
+    private:
+      void* do_allocate(std::size_t bytes, std::size_t alignment) override
+      {
+        void* pointer = m_upstream->allocate(bytes, alignment);
+        m_bytes_requested.fetch_add(bytes, std::memory_order_relaxed);
+        m_num_allocations.fetch_add(1, std::memory_order_relaxed);
+        auto in_use = m_bytes_in_use.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        auto peak = m_peak_bytes_in_use.load(std::memory_order_relaxed);
+        while (in_use > peak && !m_peak_bytes_in_use.compare_exchange_weak(peak, in_use, std::memory_order_relaxed))
+        { }
+        return pointer;
+      }
+
+      void do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) override
+      {
+        m_upstream->deallocate(pointer, bytes, alignment);
+        m_bytes_in_use.fetch_sub(bytes, std::memory_order_relaxed);
+      }
+
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+      {
+        return this == &other;
+      }
+
+    private:
+      std::pmr::memory_resource* m_upstream;
+      std::atomic<std::size_t> m_bytes_requested { 0 };
+      std::atomic<std::size_t> m_num_allocations { 0 };
+      std::atomic<std::size_t> m_bytes_in_use { 0 };
+      std::atomic<std::size_t> m_peak_bytes_in_use { 0 };
+    };
+
+  } // namespace profile
+
+} // namespace utils
+
+#endif // UTILS_PROFILE_COUNTING_RESOURCE_HPP
@@ -0,0 +1,136 @@
+#ifndef UTILS_PROFILE_PERF_COUNTERS_HPP
+#define UTILS_PROFILE_PERF_COUNTERS_HPP
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+
+  namespace profile {
+
+    // hardware counters of the calling thread through Linux perf_event_open,
+    // user space only; every event is opened on its own, so whatever the
+    // CPU, kernel or container (perf_event_paranoid, seccomp) refuses is
+    // just left out, and on other systems nothing is available
+    class perf_counters_t
+    {
+    public:
+      enum event_t { cycles, instructions, branch_misses, L1D_misses, LLC_misses, dTLB_misses, num_events };
+
+      // scaled counts, valid where available(event)
+      using values_t = std::array<double, num_events>;
+
+      static const char* event_name(int event)
+      {
+        static const char* names[] = {
+            "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses", "dTLB-misses" };
+        return names[event];
+      }
+
+      perf_counters_t()
+      {
+        m_fds.fill(-1);
+#if defined(__linux__)
+        constexpr std::uint64_t cache_read_miss =
+            (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        open(cycles, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open(instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open(branch_misses, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        open(L1D_misses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache_read_miss);
+        open(LLC_misses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cache_read_miss);
+        open(dTLB_misses, PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | cache_read_miss);
+#else
+        m_error = "perf_event_open is only available on Linux";
+#endif
+      }
+
+      perf_counters_t(const perf_counters_t&) = delete;
+      perf_counters_t& operator=(const perf_counters_t&) = delete;
+
+      ~perf_counters_t()
+      {
+#if defined(__linux__)
+        for (auto fd: m_fds) {
+          if (fd >= 0) {
+            close(fd);
+          }
+        }
+#endif
+      }
+
+      bool available(int event) const
+      {
+        return m_fds[event] >= 0;
+      }
+
+      bool available() const
+      {
+        for (auto fd: m_fds) {
+          if (fd >= 0) {
+            return true;
+          }
+        }
+        return false;
+      }
+
+      // why the first refused event was refused
+      const std::string& error() const
+      {
+        return m_error;
+      }
+
+      // running totals since construction, scaled up when the kernel
+      // multiplexed the counters; differences of two reads give a phase
+      values_t read() const
+      {
+        values_t values {};
+#if defined(__linux__)
+        for (int event = 0; event < num_events; ++event) {
+          std::uint64_t buffer[3];
+          if (m_fds[event] >= 0 && ::read(m_fds[event], buffer, sizeof(buffer)) == sizeof(buffer)) {
+            // value, time enabled, time running
+            values[event] = buffer[2] > 0 ? double(buffer[0]) * buffer[1] / buffer[2] : 0.0;
+          }
+        }
+#endif
+        return values;
+      }
+
+    private:
+#if defined(__linux__)
+      void open(int event, std::uint32_t type, std::uint64_t config)
+      {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        m_fds[event] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (m_fds[event] < 0 && m_error.empty()) {
+          m_error = std::string(event_name(event)) + ": " + std::strerror(errno);
+        }
+      }
+#endif
+
+      std::array<int, num_events> m_fds;
+      std::string m_error;
+    };
+
+  } // namespace profile
+
+} // namespace utils
+
+#endif // UTILS_PROFILE_PERF_COUNTERS_HPP
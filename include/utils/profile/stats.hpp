@@ -0,0 +1,309 @@
+#ifndef UTILS_PROFILE_STATS_HPP
+#define UTILS_PROFILE_STATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include <utils/profile/perf_counters.hpp>
+
+namespace utils {
+
+  namespace profile {
+
+    // peak resident set size in bytes, 0 where unknown
+    inline std::size_t peak_rss()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+      struct rusage usage;
+      if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+      }
+#if defined(__APPLE__)
+      return std::size_t(usage.ru_maxrss);
+#else
+      return std::size_t(usage.ru_maxrss) * 1024;
+#endif
+#else
+      return 0;
+#endif
+    }
+
+    // opt-in run statistics: wall time per phase, accumulated by scoped
+    // timers, and named counters; a disabled stats_t neither reads the
+    // clock nor stores anything
+    class stats_t
+    {
+    public:
+      using clock = std::chrono::steady_clock;
+
+      class scoped_timer_t
+      {
+      public:
+        scoped_timer_t(stats_t* stats, const char* phase)
+        : m_stats(stats), m_phase(phase)
+        {
+          if (m_stats) {
+            if (m_stats->sampling_perf()) {
+              m_perf_start = m_stats->m_perf->read();
+            }
+            m_start = clock::now();
+          }
+        }
+
+        scoped_timer_t(const scoped_timer_t&) = delete;
+        scoped_timer_t& operator=(const scoped_timer_t&) = delete;
+
+        ~scoped_timer_t()
+        {
+          if (m_stats) {
+            m_stats->add_time(m_phase, std::chrono::duration<double>(clock::now() - m_start).count());
+            if (m_stats->sampling_perf()) {
+              auto values = m_stats->m_perf->read();
+              auto& phase_values = find(m_stats->m_phase_perf, m_phase);
+              for (std::size_t event = 0; event < values.size(); ++event) {
+                phase_values[event] += values[event] - m_perf_start[event];
+              }
+            }
+          }
+        }
+
+      private:
+        stats_t* m_stats;
+        const char* m_phase;
+        clock::time_point m_start;
+        perf_counters_t::values_t m_perf_start;
+      };
+
+      explicit stats_t(bool enabled = false)
+      : m_enabled(enabled)
+      { }
+
+      bool enabled() const
+      {
+        return m_enabled;
+      }
+
+      // also samples hardware counters around every timed phase, reported
+      // per phase and per input token (the "tokens" counter); returns
+      // whether any counter could be opened
+      bool enable_perf()
+      {
+        if (!m_enabled) {
+          return false;
+        }
+        m_perf = std::make_unique<perf_counters_t>();
+        return m_perf->available();
+      }
+
+      // times the enclosing scope as phase
+      scoped_timer_t time(const char* phase)
+      {
+        return scoped_timer_t(m_enabled ? this : nullptr, phase);
+      }
+
+      void add_time(const std::string& phase, double seconds)
+      {
+        if (m_enabled) {
+          find(m_phases, phase) += seconds;
+        }
+      }
+
+      double seconds(const std::string& phase) const
+      {
+        for (auto&& [name, seconds]: m_phases) {
+          if (name == phase) {
+            return seconds;
+          }
+        }
+        return 0.0;
+      }
+
+      void set(const std::string& counter, double value)
+      {
+        if (m_enabled) {
+          find(m_counters, counter) = value;
+        }
+      }
+
+      void add(const std::string& counter, double value)
+      {
+        if (m_enabled) {
+          find(m_counters, counter) += value;
+        }
+      }
+
+      // counter / seconds of phase, reported as "<counter>/s <phase>"
+      void set_rate(const std::string& counter, const std::string& phase)
+      {
+        if (m_enabled) {
+          double amount = find(m_counters, counter), elapsed = seconds(phase);
+          find(m_counters, counter + "/s " + phase) = elapsed > 0.0 ? amount / elapsed : 0.0;
+        }
+      }
+
+      // process-wide counters: peak RSS, meant to be called right before
+      // printing
+      void record_process()
+      {
+        set("peak RSS bytes", double(peak_rss()));
+      }
+
+      void print_table(std::ostream& out_stream) const
+      {
+        if (!m_enabled) {
+          return;
+        }
+        auto flags = out_stream.flags();
+        auto precision = out_stream.precision();
+        double total = 0.0;
+        out_stream << std::left << std::setw(32) << "phase" << std::right << std::setw(16) << "seconds" << "\n";
+        for (auto&& [phase, seconds]: m_phases) {
+          out_stream << "  " << std::left << std::setw(30) << phase
+                     << std::right << std::setw(16) << std::fixed << std::setprecision(6) << seconds << "\n";
+          total += seconds;
+        }
+        out_stream << "  " << std::left << std::setw(30) << "total"
+                   << std::right << std::setw(16) << std::fixed << std::setprecision(6) << total << "\n";
+        out_stream << std::left << std::setw(32) << "counter" << std::right << std::setw(16) << "value" << "\n";
+        for (auto&& [counter, value]: m_counters) {
+          out_stream << "  " << std::left << std::setw(30) << counter
+                     << std::right << std::setw(16) << std::fixed << std::setprecision(0) << value << "\n";
+        }
+        if (m_perf) {
+          double tokens = counter("tokens");
+          out_stream << std::left << std::setw(32) << "perf counter" << std::right << std::setw(16) << "value"
+                     << std::setw(16) << "per token" << "\n";
+          if (!m_perf->available()) {
+            out_stream << "  unavailable (" << m_perf->error() << ")\n";
+          }
+          for (auto&& [phase, values]: m_phase_perf) {
+            out_stream << "  " << phase << "\n";
+            for (int event = 0; event < perf_counters_t::num_events; ++event) {
+              if (!m_perf->available(event)) {
+                continue;
+              }
+              out_stream << "    " << std::left << std::setw(28) << perf_counters_t::event_name(event)
+                         << std::right << std::setw(16) << std::fixed << std::setprecision(0) << values[event];
+              if (tokens > 0) {
+                out_stream << std::setw(16) << std::setprecision(2) << values[event] / tokens;
+              }
+              out_stream << "\n";
+            }
+            if (m_perf->available(perf_counters_t::cycles) && m_perf->available(perf_counters_t::instructions)) {
+              out_stream << "    " << std::left << std::setw(28) << "IPC" << std::right << std::setw(16)
+                         << std::setprecision(2) << ipc(values) << "\n";
+            }
+          }
+        }
+        out_stream.flags(flags);
+        out_stream.precision(precision);
+      }
+
+      void print_json(std::ostream& out_stream) const
+      {
+        if (!m_enabled) {
+          return;
+        }
+        auto precision = out_stream.precision(12);
+        auto print_object = [&](const std::vector<std::pair<std::string, double>>& entries) {
+          out_stream << "{";
+          bool first = true;
+          for (auto&& [name, value]: entries) {
+            out_stream << (first ? "\n" : ",\n") << "    \"" << name << "\": " << value;
+            first = false;
+          }
+          out_stream << (first ? "}" : "\n  }");
+        };
+        out_stream << "{\n  \"phases\": ";
+        print_object(m_phases);
+        out_stream << ",\n  \"counters\": ";
+        print_object(m_counters);
+        if (m_perf && !m_perf->available()) {
+          out_stream << ",\n  \"perf\": null, \"perf_error\": \"" << m_perf->error() << "\"";
+        } else if (m_perf) {
+          double tokens = counter("tokens");
+          out_stream << ",\n  \"perf\": {";
+          bool first = true;
+          for (auto&& [phase, values]: m_phase_perf) {
+            out_stream << (first ? "\n" : ",\n") << "    \"" << phase << "\": {";
+            first = false;
+            bool first_event = true;
+            for (int event = 0; event < perf_counters_t::num_events; ++event) {
+              if (!m_perf->available(event)) {
+                continue;
+              }
+              out_stream << (first_event ? "" : ", ") << "\"" << perf_counters_t::event_name(event) << "\": " << values[event];
+              if (tokens > 0) {
+                out_stream << ", \"" << perf_counters_t::event_name(event) << "_per_token\": " << values[event] / tokens;
+              }
+              first_event = false;
+            }
+            if (m_perf->available(perf_counters_t::cycles) && m_perf->available(perf_counters_t::instructions)) {
+              out_stream << ", \"IPC\": " << ipc(values);
+            }
+            out_stream << "}";
+          }
+          out_stream << (first ? "}" : "\n  }");
+        }
+        out_stream << "\n}\n";
+        out_stream.precision(precision);
+      }
+
+    private:
+      // linear search keeps the report in first-recorded order, there are
+      // only a few dozen entries
+      template <typename T>
+      static T& find(std::vector<std::pair<std::string, T>>& entries, const std::string& name)
+      {
+        for (auto&& [entry_name, value]: entries) {
+          if (entry_name == name) {
+            return value;
+          }
+        }
+        entries.emplace_back(name, T {});
+        return entries.back().second;
+      }
+
+      bool sampling_perf() const
+      {
+        return m_perf && m_perf->available();
+      }
+
+      double counter(const std::string& name) const
+      {
+        for (auto&& [entry_name, value]: m_counters) {
+          if (entry_name == name) {
+            return value;
+          }
+        }
+        return 0.0;
+      }
+
+      static double ipc(const perf_counters_t::values_t& values)
+      {
+        return values[perf_counters_t::cycles] > 0
+            ? values[perf_counters_t::instructions] / values[perf_counters_t::cycles] : 0.0;
+      }
+
+      bool m_enabled;
+      std::vector<std::pair<std::string, double>> m_phases;
+      std::vector<std::pair<std::string, double>> m_counters;
+      std::unique_ptr<perf_counters_t> m_perf;
+      std::vector<std::pair<std::string, perf_counters_t::values_t>> m_phase_perf;
+    };
+
+  } // namespace profile
+
+} // namespace utils
+
+#endif // UTILS_PROFILE_STATS_HPP
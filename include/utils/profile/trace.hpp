@@ -0,0 +1,179 @@
+#ifndef UTILS_PROFILE_TRACE_HPP
+#define UTILS_PROFILE_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+  namespace profile {
+
+    // named spans written as Chrome trace_event JSON ("X" complete events),
+    // loadable by chrome://tracing or Perfetto; every thread appends to its
+    // own buffer without locking, buffers are written out at exit
+    namespace trace {
+
+      using clock = std::chrono::steady_clock;
+
+      struct event_t
+      {
+        const char* name;
+        std::int64_t begin;
+        std::int64_t end;
+      };
+
+      // fixed-size chunks, so recording never moves recorded events
+      struct thread_buffer_t
+      {
+        static constexpr std::size_t chunk_size = 4096;
+
+        std::size_t thread_id;
+        std::vector<std::unique_ptr<event_t[]>> chunks;
+        std::size_t num_events = 0;
+
+        void push(const event_t& event)
+        {
+          if (num_events == chunks.size() * chunk_size) {
+            chunks.emplace_back(new event_t[chunk_size]);
+          }
+          chunks.back()[num_events % chunk_size] = event;
+          ++num_events;
+        }
+      };
+
+      struct session_t
+      {
+        std::atomic<bool> enabled { false };
+        clock::time_point start;
+        std::string filename;
+
+        // only touched when a thread records its first span and at exit
+        std::mutex mutex;
+        std::vector<std::shared_ptr<thread_buffer_t>> buffers;
+      };
+
+      inline session_t& session()
+      {
+        static session_t session;
+        return session;
+      }
+
+      inline bool enabled()
+      {
+        return session().enabled.load(std::memory_order_relaxed);
+      }
+
+      inline std::int64_t now()
+      {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock::now() - session().start).count();
+      }
+
+      inline thread_buffer_t& thread_buffer()
+      {
+        thread_local std::shared_ptr<thread_buffer_t> buffer;
+        if (!buffer) {
+          auto& current_session = session();
+          std::lock_guard<std::mutex> lock(current_session.mutex);
+          buffer = std::make_shared<thread_buffer_t>();
+          buffer->thread_id = current_session.buffers.size();
+          current_session.buffers.push_back(buffer);
+        }
+        return *buffer;
+      }
+
+      // writes every recorded span to the session file; spans still being
+      // recorded by running threads are not safe to read, so call it once
+      // worker threads are joined (it runs at exit once started)
+      inline void flush()
+      {
+        auto& current_session = session();
+        if (!current_session.enabled.exchange(false)) {
+          return;
+        }
+        std::lock_guard<std::mutex> lock(current_session.mutex);
+        std::ofstream out_stream(current_session.filename);
+        out_stream << "{\"traceEvents\": [";
+        out_stream.precision(3);
+        out_stream << std::fixed;
+        bool first = true;
+        for (auto&& buffer: current_session.buffers) {
+          for (std::size_t idx = 0; idx < buffer->num_events; ++idx) {
+            auto& event = buffer->chunks[idx / thread_buffer_t::chunk_size][idx % thread_buffer_t::chunk_size];
+            out_stream << (first ? "\n" : ",\n");
+            first = false;
+            // microseconds, as the format requires
+            out_stream << "{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 0"
+                       << ", \"tid\": " << buffer->thread_id
+                       << ", \"ts\": " << event.begin / 1000.0
+                       << ", \"dur\": " << (event.end - event.begin) / 1000.0 << "}";
+          }
+        }
+        out_stream << "\n], \"displayTimeUnit\": \"ms\"}\n";
+      }
+
+      // starts recording, the trace is written to filename at exit
+      inline void start(const std::string& filename)
+      {
+        auto& current_session = session();
+        current_session.filename = filename;
+        current_session.start = clock::now();
+        if (!current_session.enabled.exchange(true)) {
+          std::atexit(flush);
+        }
+      }
+
+      // records the enclosing scope as a span when tracing is enabled, name
+      // must outlive the session (a string literal)
+      class span_t
+      {
+      public:
+        explicit span_t(const char* name)
+        : m_name(enabled() ? name : nullptr)
+        {
+          if (m_name) {
+            m_begin = now();
+          }
+        }
+
+        span_t(const span_t&) = delete;
+        span_t& operator=(const span_t&) = delete;
+
+        ~span_t()
+        {
+          if (m_name) {
+            thread_buffer().push({ m_name, m_begin, now() });
+          }
+        }
+
+      private:
+        const char* m_name;
+        std::int64_t m_begin = 0;
+      };
+
+    } // namespace trace
+
+  } // namespace profile
+
+} // namespace utils
+
+#define UTILS_TRACE_CONCATENATE_IMPL(lhs, rhs) lhs##rhs
+#define UTILS_TRACE_CONCATENATE(lhs, rhs) UTILS_TRACE_CONCATENATE_IMPL(lhs, rhs)
+
+// UTILS_TRACE_SCOPE("phase") traces the rest of the enclosing scope, and
+// compiles to nothing with UTILS_PROFILE_DISABLE_TRACE
+#ifdef UTILS_PROFILE_DISABLE_TRACE
+#define UTILS_TRACE_SCOPE(name) ((void)0)
+#else
+#define UTILS_TRACE_SCOPE(name) \
+  ::utils::profile::trace::span_t UTILS_TRACE_CONCATENATE(utils_trace_span_, __LINE__)(name)
+#endif
+
+#endif // UTILS_PROFILE_TRACE_HPP
@@ -1,16 +1,17 @@
 
-#include <bitset>
 #include <fstream>
 #include <iostream>
 #include <map>
-#include <queue>
 #include <set>
 #include <sstream>
 #include <string>
 #include <unordered_map>
-#include <utils/io/smart_ifstream.hpp>
 #include <vector>
 
+#include <utils/automaton/nfa.hpp>
+#include <utils/automaton/subset_construction.hpp>
+#include <utils/io/smart_ifstream.hpp>
+
 namespace utils {
 
 namespace show {
@@ -117,77 +118,31 @@ public:
         }
     }
 
-    std::bitset<100> add_transfer(std::set<int>& dfa_set, std::string symbol) {
-        while (true) {
-            bool flag = false;
-            static std::vector<int> v = {};
-            for (auto point : dfa_set) {
-                for (auto edge_pair : link_edge[point]) {
-                    if (edge_pair.second.compare(symbol) == 0) {
-                        v.emplace_back(edge_pair.first);
-                    }
-                }
-            }
-            for (auto point : v) {
-                if (dfa_set.find(point) == dfa_set.end()) {
-                    flag = true;
-                    dfa_set.insert(point);
-                }
+    void nfa_to_dfa() {
+        utils::automaton::nfa_t nfa(total_points);
+        // register symbols in sorted order so that DFA states keep being
+        // numbered by trying the symbols in lexicographic order
+        for (auto& s : symbols) {
+            nfa.add_symbol(s);
+        }
+        for (auto& [in, out_edges] : link_edge) {
+            for (auto& [out, parameter] : out_edges) {
+                nfa.add_transition(in, out, parameter);
             }
-            if (!flag)
-                break;
         }
-        std::bitset<100> set;
-        for (auto p : dfa_set) {
-            set.set(p);
+        for (auto& point : finalizePoints) {
+            nfa.set_finalize(point.first, point.second);
         }
-        return set;
-    }
 
-    void nfa_to_dfa() {
-        cnt = 0;
-        dfa_set[0].insert(0);
-        std::bitset<100> set = add_transfer(dfa_set[0], "null");
-        if (dfa_points.find(set) == dfa_points.end()) {
-            dfa_points[set] = cnt++;
-            for (const auto point : dfa_set[0]) {
-                if (finalizePoints.find(point) != finalizePoints.end()) {
-                    finalizeDFAPoints[0] = "node_" + std::to_string(0);
-                    break;
-                }
+        utils::automaton::subset_construction_t dfa(nfa);
+        cnt = dfa.num_states();
+        for (std::uint32_t now = 0; now < dfa.num_states(); now++) {
+            dfaPoints[now] = "node_" + std::to_string(now);
+            if (dfa.is_finalize(now)) {
+                finalizeDFAPoints[now] = "node_" + std::to_string(now);
             }
-            dfaPoints[0] = "node_" + std::to_string(0);
-        }
-        std::queue<int> Q;
-        Q.push(0);
-        while (!Q.empty()) {
-            int now = Q.front();
-            Q.pop();
-            std::set<int> points;
-            points.clear();
-            for (auto s : symbols) {
-                points.clear();
-                for (auto in : dfa_set[now]) {
-                    for (auto p : link_edge[in]) {
-                        if (p.second.compare(s) == 0) {
-                            points.insert(p.first);
-                        }
-                    }
-                }
-                std::bitset<100> ans = add_transfer(points, "null");
-                if (dfa_points.find(ans) == dfa_points.end()) {
-                    for (auto point : points) {
-                        if (finalizePoints.find(point) != finalizePoints.end()) {
-                            finalizeDFAPoints[cnt] = "node_" + std::to_string(cnt);
-                        }
-                    }
-                    dfaPoints[cnt] = "node_" + std::to_string(cnt);
-                    dfa_points[ans] = cnt++;
-                    dfa_set[cnt - 1] = points;
-                    Q.push(cnt - 1);
-                }
-                if (points.size() > 0)
-                    dfa_edges[std::make_pair(now, dfa_points[ans])] = s;
+            for (auto& [symbol_id, next] : dfa.transitions(now)) {
+                dfa_edges[std::make_pair(now, next)] = nfa.symbol(symbol_id);
             }
         }
     }
@@ -226,8 +181,6 @@ private:
     std::map<int, std::string> points, dfaPoints;
     std::map<std::pair<int, int>, std::string> edges, dfa_edges;
     std::unordered_map<int, std::vector<std::pair<int, std::string>>> link_edge;
-    std::unordered_map<int, std::set<int>> dfa_set;
-    std::unordered_map<std::bitset<100>, int> dfa_points;
     std::unordered_map<int, int> belong;
     std::set<std::string> symbols;
     int total_points;
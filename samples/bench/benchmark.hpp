@@ -0,0 +1,193 @@
+#ifndef SAMPLES_BENCH_BENCHMARK_HPP
+#define SAMPLES_BENCH_BENCHMARK_HPP
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <utils/profile/perf_counters.hpp>
+
+namespace bench {
+
+  // amounts processed by one iteration, e.g. { "bytes", n } or
+  // { "tokens", n }; every counter is also reported as a rate per second
+  using counters_t = std::map<std::string, double>;
+
+  // what an iteration returns when it also has plain values, sizes of what
+  // it ran on like { "table_bytes", n }: reported as the last iteration
+  // returned them, not per iteration or per second
+  struct sample_t
+  {
+    counters_t counters;
+    counters_t values;
+  };
+
+  struct result_t
+  {
+    std::string name;
+    std::size_t iterations;
+    double seconds;
+    counters_t counters;
+    counters_t values;
+    // hardware counters over all iterations, when sampled
+    counters_t perf;
+  };
+
+  // repeats every benchmark until it has run for at least min_time seconds
+  // and collects the results for a table on stderr and a JSON report
+  class runner_t
+  {
+  public:
+    runner_t(double min_time, const std::string& filter)
+    : m_min_time(min_time), m_filter(filter)
+    { }
+
+    // samples hardware counters around every benchmark, reported per
+    // iteration and per token; false (with a note on stderr) when
+    // perf_event_open refuses every counter
+    bool enable_perf()
+    {
+      m_perf = std::make_unique<utils::profile::perf_counters_t>();
+      if (!m_perf->available()) {
+        std::cerr << "perf counters unavailable: " << m_perf->error() << "\n";
+        m_perf.reset();
+        return false;
+      }
+      return true;
+    }
+
+    bool enabled(const std::string& name) const
+    {
+      return name.find(m_filter) != std::string::npos;
+    }
+
+    // function() runs one iteration and returns its counters, or a
+    // sample_t with its counters and plain values
+    template <typename Function>
+    void run(const std::string& name, Function&& function)
+    {
+      if (!enabled(name)) {
+        return;
+      }
+      using clock = std::chrono::steady_clock;
+      result_t result { name, 0, 0.0, {}, {}, {} };
+      utils::profile::perf_counters_t::values_t perf_start {};
+      if (m_perf) {
+        perf_start = m_perf->read();
+      }
+      auto start = clock::now();
+      do {
+        if constexpr (std::is_same_v<decltype(function()), sample_t>) {
+          auto sample = function();
+          for (auto&& [counter, amount]: sample.counters) {
+            result.counters[counter] += amount;
+          }
+          result.values = std::move(sample.values);
+        } else {
+          auto counters = function();
+          for (auto&& [counter, amount]: counters) {
+            result.counters[counter] += amount;
+          }
+        }
+        ++result.iterations;
+        result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+      } while (result.seconds < m_min_time);
+      if (m_perf) {
+        auto perf_end = m_perf->read();
+        for (int event = 0; event < utils::profile::perf_counters_t::num_events; ++event) {
+          if (m_perf->available(event)) {
+            result.perf[utils::profile::perf_counters_t::event_name(event)] = perf_end[event] - perf_start[event];
+          }
+        }
+      }
+      report(result);
+      m_results.push_back(result);
+    }
+
+    const std::vector<result_t>& results() const
+    {
+      return m_results;
+    }
+
+    void write_json(std::ostream& out_stream) const
+    {
+      auto precision = out_stream.precision(12);
+      out_stream << "{\n  \"benchmarks\": [";
+      bool first = true;
+      for (auto& result: m_results) {
+        out_stream << (first ? "\n" : ",\n");
+        first = false;
+        out_stream << "    {\"name\": \"" << result.name << "\""
+                   << ", \"iterations\": " << result.iterations
+                   << ", \"seconds\": " << result.seconds
+                   << ", \"seconds_per_iteration\": " << result.seconds / result.iterations;
+        for (auto&& [counter, amount]: result.counters) {
+          out_stream << ", \"" << counter << "\": " << amount / result.iterations
+                     << ", \"" << counter << "_per_second\": " << amount / result.seconds;
+        }
+        for (auto&& [value_name, value]: result.values) {
+          out_stream << ", \"" << value_name << "\": " << value;
+        }
+        auto tokens = result.counters.find("tokens");
+        for (auto&& [event, amount]: result.perf) {
+          out_stream << ", \"" << event << "\": " << amount / result.iterations;
+          if (tokens != result.counters.end() && tokens->second > 0) {
+            out_stream << ", \"" << event << "_per_token\": " << amount / tokens->second;
+          }
+        }
+        if (result.perf.count("cycles") && result.perf.count("instructions") && result.perf.at("cycles") > 0) {
+          out_stream << ", \"IPC\": " << result.perf.at("instructions") / result.perf.at("cycles");
+        }
+        out_stream << "}";
+      }
+      out_stream << "\n  ]\n}\n";
+      out_stream.precision(precision);
+    }
+
+  private:
+    static void report(const result_t& result)
+    {
+      char line[256];
+      std::snprintf(line, sizeof(line), "%-48s %8zu it %12.3f ms/it",
+          result.name.c_str(), result.iterations, 1e3 * result.seconds / result.iterations);
+      std::cerr << line;
+      for (auto&& [counter, amount]: result.counters) {
+        double rate = amount / result.seconds;
+        if (counter == "bytes") {
+          std::snprintf(line, sizeof(line), " %10.2f MB/s", rate / (1 << 20));
+        } else {
+          std::snprintf(line, sizeof(line), " %12.0f %s/s", rate, counter.c_str());
+        }
+        std::cerr << line;
+      }
+      for (auto&& [value_name, value]: result.values) {
+        std::snprintf(line, sizeof(line), " %12.0f %s", value, value_name.c_str());
+        std::cerr << line;
+      }
+      auto tokens = result.counters.find("tokens");
+      if (result.perf.count("cycles") && result.perf.count("instructions") && result.perf.at("cycles") > 0) {
+        std::snprintf(line, sizeof(line), " %6.2f IPC", result.perf.at("instructions") / result.perf.at("cycles"));
+        std::cerr << line;
+      }
+      if (result.perf.count("cycles") && tokens != result.counters.end() && tokens->second > 0) {
+        std::snprintf(line, sizeof(line), " %10.1f cycles/token", result.perf.at("cycles") / tokens->second);
+        std::cerr << line;
+      }
+      std::cerr << "\n";
+    }
+
+  private:
+    double m_min_time;
+    std::string m_filter;
+    std::vector<result_t> m_results;
+    std::unique_ptr<utils::profile::perf_counters_t> m_perf;
+  };
+
+} // namespace bench
+
+#endif // SAMPLES_BENCH_BENCHMARK_HPP
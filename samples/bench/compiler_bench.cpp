@@ -0,0 +1,643 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <utils/graph/directed_graph.hpp>
+#include <utils/io/batch_reader.hpp>
+#include <utils/io/smart_ifstream.hpp>
+#include <utils/profile/trace.hpp>
+#include <compiler/batch_driver.hpp>
+#include <compiler/fused_parser.hpp>
+#include <compiler/lexical_analysis.hpp>
+#include <compiler/push_parser.hpp>
+#include <compiler/source_generator.hpp>
+#include <compiler/syntax.hpp>
+#include <compiler/syntax_analysis.hpp>
+#include <compiler/syntax_analysis_earley.hpp>
+#include <compiler/syntax_analysis_glr.hpp>
+#include <compiler/syntax_analysis_lr.hpp>
+#include <compiler/syntax_loader.hpp>
+#include <compiler/token_pipeline.hpp>
+
+#include "benchmark.hpp"
+
+#ifndef COMPILER_BENCH_ASSETS_DIR
+#define COMPILER_BENCH_ASSETS_DIR "assets"
+#endif
+
+namespace {
+
+  std::string read_file(const std::string& filename)
+  {
+    std::ifstream in_stream(filename);
+    return std::string {
+        std::istreambuf_iterator<char>(in_stream),
+        std::istreambuf_iterator<char>()
+    };
+  }
+
+  // whole programs repeated up to at least size bytes, still a valid program
+  // since PROGRAM is a list of components
+  std::string repeat_to_size(const std::string& content, std::size_t size)
+  {
+    std::string result;
+    result.reserve(size + content.size());
+    while (result.size() < size) {
+      result += content;
+      result += "\n";
+    }
+    return result;
+  }
+
+  std::shared_ptr<compiler::lexical_automaton_t> load_dfa(const std::string& filename)
+  {
+    utils::io::smart_ifstream dfa_in_stream(filename);
+    return compiler::load_lexical_automaton(dfa_in_stream);
+  }
+
+  compiler::syntax_t load_syntax(const std::string& filename, std::string& start_symbol_id)
+  {
+    utils::io::smart_ifstream in_stream(filename);
+    auto rules = compiler::load_production_rules(in_stream, start_symbol_id);
+    return compiler::syntax_t(rules.begin(), rules.end());
+  }
+
+  // the grammar with every use of symbol_id replaced by each of its rules,
+  // which undoes a left factoring: the same language, no longer LL(1)
+  std::vector<compiler::production_rule_t> inline_symbol(
+      const std::vector<compiler::production_rule_t>& rules, const std::string& symbol_id)
+  {
+    std::vector<compiler::production_rule_t> inlined_rules, result;
+    for (auto&& rule: rules) {
+      if (rule.symbol.symbol_id == symbol_id) {
+        inlined_rules.push_back(rule);
+      }
+    }
+    for (auto&& rule: rules) {
+      if (rule.symbol.symbol_id == symbol_id) {
+        continue;
+      }
+      auto it = std::find_if(rule.rule_symbols.begin(), rule.rule_symbols.end(),
+          [&](const compiler::symbol_t& symbol) { return symbol.symbol_id == symbol_id; });
+      if (it == rule.rule_symbols.end()) {
+        result.push_back(rule);
+        continue;
+      }
+      for (auto&& inlined_rule: inlined_rules) {
+        // symbols are not assignable, so only appended
+        std::vector<compiler::symbol_t> rule_symbols(rule.rule_symbols.begin(), it);
+        if (!inlined_rule.is_epsilon()) {
+          for (auto&& symbol: inlined_rule.rule_symbols) {
+            rule_symbols.push_back(symbol);
+          }
+        }
+        for (auto it_rest = it + 1; it_rest != rule.rule_symbols.end(); ++it_rest) {
+          rule_symbols.push_back(*it_rest);
+        }
+        if (rule_symbols.empty()) {
+          rule_symbols.push_back(compiler::epsilon_symbol());
+        }
+        result.emplace_back(rule.symbol.symbol_id, rule_symbols.begin(), rule_symbols.end());
+      }
+    }
+    return result;
+  }
+
+  struct Vertex
+  {
+    std::size_t m_idx;
+    Vertex(std::size_t idx) : m_idx(idx) { }
+  };
+
+  struct Edge
+  {
+    std::size_t m_idx;
+    Edge(std::size_t idx) : m_idx(idx) { }
+  };
+
+  using Graph = utils::graph::directed_graph_t<Vertex, Edge>;
+
+  // num_vertices vertices, each with out_degree edges to pseudo-random targets
+  std::shared_ptr<Graph> build_graph(
+      std::vector<std::shared_ptr<Vertex>>& vertices,
+      std::size_t num_vertices, std::size_t out_degree)
+  {
+    auto graph = std::make_shared<Graph>();
+    vertices.clear();
+    for (std::size_t idx = 0; idx < num_vertices; ++idx) {
+      vertices.push_back(std::make_shared<Vertex>(idx));
+      graph->add_vertex(vertices.back());
+    }
+    std::size_t num_edges = 0;
+    for (std::size_t idx = 0; idx < num_vertices; ++idx) {
+      for (std::size_t k = 1; k <= out_degree; ++k) {
+        auto target = (idx * 7919 + k * 104729) % num_vertices;
+        graph->add_edge(vertices[idx], vertices[target], std::make_shared<Edge>(num_edges++));
+      }
+    }
+    return graph;
+  }
+
+  void usage(const char* program)
+  {
+    std::cerr << "usage: " << program
+              << " [--assets DIR] [--json FILE] [--filter STR] [--min-time SEC] [--size-mb N]"
+              << " [--generated-tokens N] [--seed N] [--num-files N] [--trace FILE] [--perf]\n";
+  }
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  std::string assets_dir = COMPILER_BENCH_ASSETS_DIR;
+  std::string json_filename;
+  std::string filter;
+  double min_time = 0.5;
+  std::size_t size_mb = 4;
+  std::size_t generated_tokens = 1 << 20;
+  std::uint64_t seed = 0;
+  std::size_t num_files = 2000;
+  bool flag_perf = false;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string arg = argv[idx];
+    if (idx + 1 < argc && arg == "--assets") {
+      assets_dir = argv[++idx];
+    } else if (idx + 1 < argc && arg == "--json") {
+      json_filename = argv[++idx];
+    } else if (idx + 1 < argc && arg == "--filter") {
+      filter = argv[++idx];
+    } else if (idx + 1 < argc && arg == "--min-time") {
+      min_time = std::stod(argv[++idx]);
+    } else if (idx + 1 < argc && arg == "--size-mb") {
+      size_mb = std::stoul(argv[++idx]);
+    } else if (idx + 1 < argc && arg == "--generated-tokens") {
+      generated_tokens = std::stoul(argv[++idx]);
+    } else if (idx + 1 < argc && arg == "--seed") {
+      seed = std::stoull(argv[++idx]);
+    } else if (idx + 1 < argc && arg == "--num-files") {
+      num_files = std::stoul(argv[++idx]);
+    } else if (idx + 1 < argc && arg == "--trace") {
+      utils::profile::trace::start(argv[++idx]);
+    } else if (arg == "--perf") {
+      flag_perf = true;
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  const std::string dfa_filename = assets_dir + "/lab2/lexical_default.txt";
+  const std::string syntax_filename = assets_dir + "/lab2/syntax_default.txt";
+  const std::string code_filename = assets_dir + "/lab2/code_default.txt";
+
+  bench::runner_t runner(min_time, filter);
+  if (flag_perf) {
+    runner.enable_perf();
+  }
+  std::ostream null_stream(nullptr);
+
+  auto dfa = load_dfa(dfa_filename);
+  const std::string code = read_file(code_filename);
+  const std::string synthetic_code = repeat_to_size(code, size_mb << 20);
+  const std::string synthetic_name = "synthetic_" + std::to_string(size_mb) + "MB";
+
+  // random program of the grammar, unlike the repeated one it exercises
+  // every rule, nesting depth and token kind
+  std::string start_symbol_id;
+  auto syntax = load_syntax(syntax_filename, start_symbol_id);
+  compiler::symbol_t start_symbol(start_symbol_id);
+  const std::string generated_code = compiler::source_generator_t(syntax, start_symbol, *dfa, seed)
+      .generate(generated_tokens, 16);
+  const std::string generated_name = "generated_" + std::to_string(generated_tokens) + "tokens";
+
+  // lexer
+  runner.run("lexer/load_dfa/lexical_default", [&]() {
+    auto loaded = load_dfa(dfa_filename);
+    return bench::counters_t { { "states", double(loaded->num_vertices()) } };
+  });
+
+  auto scan_tokens = [&](const std::string& input) {
+    return [&]() {
+      std::size_t num_tokens = 0;
+      compiler::scan_tokens(*dfa, input,
+          [&](const std::string&, std::size_t, std::size_t) { ++num_tokens; });
+      return bench::counters_t { { "bytes", double(input.size()) }, { "tokens", double(num_tokens) } };
+    };
+  };
+  runner.run("lexer/scan_tokens/code_default", scan_tokens(code));
+  runner.run("lexer/scan_tokens/" + synthetic_name, scan_tokens(synthetic_code));
+  runner.run("lexer/scan_tokens/" + generated_name, scan_tokens(generated_code));
+
+  auto scan = [&](const std::string& input) {
+    return [&]() {
+      auto symbols = compiler::scan(dfa, input, null_stream);
+      return bench::counters_t { { "bytes", double(input.size()) }, { "tokens", double(symbols.size()) } };
+    };
+  };
+  runner.run("lexer/scan/code_default", scan(code));
+  runner.run("lexer/scan/" + synthetic_name, scan(synthetic_code));
+  runner.run("lexer/scan/" + generated_name, scan(generated_code));
+
+  // grammar analysis
+  runner.run("syntax/load_rules/syntax_default", [&]() {
+    std::string start_symbol_id;
+    utils::io::smart_ifstream in_stream(syntax_filename);
+    auto rules = compiler::load_production_rules(in_stream, start_symbol_id);
+    return bench::counters_t { { "rules", double(rules.size()) } };
+  });
+
+  runner.run("syntax/LL1_construct/syntax_default", [&]() {
+    compiler::LL1_syntax_analyser_t analyser(syntax, start_symbol);
+    return bench::counters_t {};
+  });
+
+  std::unique_ptr<compiler::LR_syntax_analyser_t> LR_analyser;
+  runner.run("syntax/LR_construct/syntax_default", [&]() {
+    LR_analyser = std::make_unique<compiler::LR_syntax_analyser_t>(syntax, start_symbol);
+    return bench::counters_t { { "states", double(LR_analyser->num_states()) } };
+  });
+
+  // item sets explored on the calling thread only, against the default of
+  // one thread per core above
+  runner.run("syntax/LR_construct_sequential/syntax_default", [&]() {
+    compiler::LR_syntax_analyser_t analyser(syntax, start_symbol, std::pmr::get_default_resource(), 1);
+    return bench::counters_t { { "states", double(analyser.num_states()) } };
+  });
+
+  // parsers
+  auto symbols = compiler::scan(dfa, code, null_stream);
+  auto synthetic_symbols = compiler::scan(dfa, synthetic_code, null_stream);
+  auto generated_symbols = compiler::scan(dfa, generated_code, null_stream);
+
+  compiler::LL1_syntax_analyser_t LL1_analyser(syntax, start_symbol);
+  auto LL1_recognize = [&](const std::vector<compiler::symbol_t>& input) {
+    return [&]() {
+      if (!LL1_analyser.recognize(input.begin(), input.end())) {
+        std::cerr << "LL(1) analyser rejected the benchmark input\n";
+      }
+      return bench::counters_t { { "tokens", double(input.size()) } };
+    };
+  };
+  runner.run("parse/LL1_recognize/code_default", LL1_recognize(symbols));
+  runner.run("parse/LL1_recognize/" + synthetic_name, LL1_recognize(synthetic_symbols));
+  runner.run("parse/LL1_recognize/" + generated_name, LL1_recognize(generated_symbols));
+
+  // the same tokens pushed in batches of 256, as they would arrive
+  auto LL1_push = [&](const std::vector<compiler::symbol_t>& input) {
+    return [&]() {
+      compiler::push_parser_t<compiler::LL1_syntax_analyser_t> parser(LL1_analyser);
+      for (std::size_t i_start = 0; i_start < input.size(); i_start += 256) {
+        auto it_begin = input.begin() + i_start;
+        parser.feed(it_begin, input.size() - i_start < 256 ? input.end() : it_begin + 256);
+      }
+      if (!parser.finish()) {
+        std::cerr << "LL(1) analyser rejected the benchmark input\n";
+      }
+      return bench::counters_t { { "tokens", double(input.size()) } };
+    };
+  };
+  runner.run("parse/LL1_push/" + synthetic_name, LL1_push(synthetic_symbols));
+  runner.run("parse/LL1_push/" + generated_name, LL1_push(generated_symbols));
+
+  if (runner.enabled("parse/LR_recognize")) {
+    if (!LR_analyser) {
+      LR_analyser = std::make_unique<compiler::LR_syntax_analyser_t>(syntax, start_symbol);
+    }
+    auto LR_recognize = [&](const std::vector<compiler::symbol_t>& input) {
+      return [&]() {
+        if (!LR_analyser->recognize(input.begin(), input.end())) {
+          std::cerr << "LR analyser rejected the benchmark input\n";
+        }
+        return bench::counters_t { { "tokens", double(input.size()) } };
+      };
+    };
+    runner.run("parse/LR_recognize/code_default", LR_recognize(symbols));
+    runner.run("parse/LR_recognize/" + synthetic_name, LR_recognize(synthetic_symbols));
+    runner.run("parse/LR_recognize/" + generated_name, LR_recognize(generated_symbols));
+  }
+
+  // table lookups alone, on terminal ids, with the sorted rows and with the
+  // compressed tables
+  if (runner.enabled("parse/LR_pull/" + generated_name)
+      || runner.enabled("parse/LR_pull_compressed/" + generated_name)) {
+    if (!LR_analyser) {
+      LR_analyser = std::make_unique<compiler::LR_syntax_analyser_t>(syntax, start_symbol);
+    }
+    compiler::LR_syntax_analyser_t::options_t compressed_options;
+    compressed_options.compress = true;
+    compiler::LR_syntax_analyser_t compressed_LR_analyser(syntax, start_symbol, compressed_options);
+    auto table_size = compressed_LR_analyser.table_size();
+    std::vector<int> terminal_ids;
+    for (auto&& symbol: generated_symbols) {
+      terminal_ids.push_back(LR_analyser->terminal_id(symbol.symbol_id));
+    }
+    auto LR_pull = [&](const compiler::LR_syntax_analyser_t& analyser, double table_bytes) {
+      return [&, table_bytes]() {
+        std::size_t idx = 0;
+        if (!analyser.recognize_pull([&]() {
+              return idx < terminal_ids.size() ? terminal_ids[idx++] : compiler::end_of_input_id;
+            })) {
+          std::cerr << "LR analyser rejected the benchmark input\n";
+        }
+        return bench::sample_t { { { "tokens", double(terminal_ids.size()) } }, { { "table_bytes", table_bytes } } };
+      };
+    };
+    runner.run("parse/LR_pull/" + generated_name, LR_pull(*LR_analyser, double(table_size.sparse_bytes)));
+    runner.run("parse/LR_pull_compressed/" + generated_name,
+        LR_pull(compressed_LR_analyser, double(table_size.compressed_bytes)));
+  }
+
+  // the GLR engine on the same tables; with no conflict in the grammar it
+  // never leaves its single-stack loop, which should keep up with LR_pull
+  if (runner.enabled("parse/GLR_pull/" + generated_name)) {
+    if (!LR_analyser) {
+      LR_analyser = std::make_unique<compiler::LR_syntax_analyser_t>(syntax, start_symbol);
+    }
+    compiler::GLR_syntax_analyser_t GLR_analyser(*LR_analyser);
+    std::vector<int> terminal_ids;
+    for (auto&& symbol: generated_symbols) {
+      terminal_ids.push_back(GLR_analyser.terminal_id(symbol.symbol_id));
+    }
+    compiler::GLR_syntax_analyser_t::parse_context_t context;
+    runner.run("parse/GLR_pull/" + generated_name, [&]() {
+      std::size_t idx = 0;
+      if (!GLR_analyser.recognize_pull([&]() {
+            return idx < terminal_ids.size() ? terminal_ids[idx++] : compiler::end_of_input_id;
+          }, context)) {
+        std::cerr << "GLR analyser rejected the benchmark input\n";
+      }
+      return bench::counters_t { { "tokens", double(terminal_ids.size()) } };
+    });
+  }
+
+  // the Earley parser on the same inputs, against the deterministic parsers
+  // above: what a grammar no table fits costs
+  if (runner.enabled("parse/Earley_recognize") || runner.enabled("parse/Earley_forest")) {
+    compiler::Earley_syntax_analyser_t Earley_analyser(syntax, start_symbol);
+    compiler::Earley_syntax_analyser_t::parse_context_t context;
+    auto Earley_recognize = [&](const std::vector<compiler::symbol_t>& input) {
+      return [&]() {
+        if (!Earley_analyser.recognize(input.begin(), input.end(), context)) {
+          std::cerr << "Earley analyser rejected the benchmark input\n";
+        }
+        return bench::counters_t { { "tokens", double(input.size()) }, { "items", double(context.items.size()) } };
+      };
+    };
+    runner.run("parse/Earley_recognize/code_default", Earley_recognize(symbols));
+    runner.run("parse/Earley_recognize/" + synthetic_name, Earley_recognize(synthetic_symbols));
+    runner.run("parse/Earley_recognize/" + generated_name, Earley_recognize(generated_symbols));
+    runner.run("parse/Earley_forest/code_default", [&]() {
+      if (!Earley_analyser.analysis(symbols.begin(), symbols.end(), context)) {
+        std::cerr << "Earley analyser rejected the benchmark input\n";
+      }
+      return bench::counters_t { { "tokens", double(symbols.size()) }, { "nodes", double(context.forest.nodes.size()) } };
+    });
+  }
+
+  // LL(1) on terminal ids; adaptive LL on the grammar with the postfix
+  // operators no longer factored out of EXPR_1, so that every primary
+  // expression is a decision its lookahead DFA settles on the next token;
+  // LL(1) on the grammar declaring its expression levels as an operator
+  // table, parsed by precedence climbing
+  if (runner.enabled("parse/LL1_pull/" + generated_name)
+      || runner.enabled("parse/LL_adaptive_pull/" + generated_name)
+      || runner.enabled("parse/LL_climbing_pull/" + generated_name)) {
+    std::string unused_start_symbol_id;
+    utils::io::smart_ifstream in_stream(syntax_filename);
+    auto rules = compiler::load_production_rules(in_stream, unused_start_symbol_id);
+    rules = inline_symbol(rules, "EXPR_1_REMOVE_LEFT_RECURSION");
+    compiler::syntax_t unfactored_syntax(rules.begin(), rules.end());
+    compiler::LL1_syntax_analyser_t adaptive_analyser(unfactored_syntax, start_symbol);
+    utils::io::smart_ifstream operators_in_stream(assets_dir + "/lab2/syntax_operators.txt");
+    std::vector<compiler::operator_table_t> operator_tables;
+    auto operator_rules = compiler::load_production_rules(
+        operators_in_stream, unused_start_symbol_id, operator_tables);
+    compiler::syntax_t operator_syntax(operator_rules.begin(), operator_rules.end(), operator_tables);
+    compiler::LL1_syntax_analyser_t climbing_analyser(operator_syntax, start_symbol);
+    auto LL_pull = [&](const compiler::LL1_syntax_analyser_t& analyser) {
+      std::vector<int> terminal_ids;
+      for (auto&& symbol: generated_symbols) {
+        terminal_ids.push_back(analyser.terminal_id(symbol.symbol_id));
+      }
+      return [&, terminal_ids = std::move(terminal_ids)]() {
+        compiler::LL1_syntax_analyser_t::parse_context_t context;
+        std::size_t idx = 0;
+        if (!analyser.recognize_pull([&]() {
+              return idx < terminal_ids.size() ? terminal_ids[idx++] : compiler::end_of_input_id;
+            }, context)) {
+          std::cerr << "LL analyser rejected the benchmark input\n";
+        }
+        return bench::sample_t {
+            { { "tokens", double(terminal_ids.size()) },
+              { "predictions", double(context.adaptive_predictions) },
+              { "lookahead_tokens", double(context.lookahead_tokens) } },
+            { { "dfa_states", double(analyser.num_lookahead_states()) } } };
+      };
+    };
+    runner.run("parse/LL1_pull/" + generated_name, LL_pull(LL1_analyser));
+    runner.run("parse/LL_adaptive_pull/" + generated_name, LL_pull(adaptive_analyser));
+    runner.run("parse/LL_climbing_pull/" + generated_name, LL_pull(climbing_analyser));
+  }
+
+  // the same lookups with the chain rules bypassed, fewer reductions per
+  // token
+  if (runner.enabled("parse/LR_pull_chain_free/" + generated_name)) {
+    compiler::LR_syntax_analyser_t::options_t chain_free_options;
+    chain_free_options.eliminate_chain_rules = true;
+    compiler::LR_syntax_analyser_t chain_free_LR_analyser(syntax, start_symbol, chain_free_options);
+    auto chain_elimination = chain_free_LR_analyser.chain_elimination();
+    std::vector<int> terminal_ids;
+    for (auto&& symbol: generated_symbols) {
+      terminal_ids.push_back(chain_free_LR_analyser.terminal_id(symbol.symbol_id));
+    }
+    runner.run("parse/LR_pull_chain_free/" + generated_name, [&]() {
+      std::size_t idx = 0;
+      compiler::LR_syntax_analyser_t::parse_context_t context;
+      if (!chain_free_LR_analyser.recognize_pull([&]() {
+            return idx < terminal_ids.size() ? terminal_ids[idx++] : compiler::end_of_input_id;
+          }, context)) {
+        std::cerr << "LR analyser rejected the benchmark input\n";
+      }
+      return bench::sample_t { { { "tokens", double(terminal_ids.size()) },
+                                 { "reductions", double(context.reductions) } },
+                               { { "gotos_rewritten", double(chain_elimination.rewritten_gotos) } } };
+    });
+  }
+
+  // whole pipeline on one input, the DFA and tables being loaded already
+  runner.run("pipeline/scan_and_LL1_recognize/" + synthetic_name, [&]() {
+    auto input = compiler::scan(dfa, synthetic_code, null_stream);
+    LL1_analyser.recognize(input.begin(), input.end());
+    return bench::counters_t { { "bytes", double(synthetic_code.size()) }, { "tokens", double(input.size()) } };
+  });
+
+  // the same without token output, sequential and with lexer and parser
+  // overlapped on two threads through the token ring
+  auto collect_tokens = [&](const std::string& input) {
+    std::vector<compiler::symbol_t> symbols;
+    compiler::scan_tokens(*dfa, input,
+        [&](const std::string& token_name, std::size_t i_start, std::size_t length) {
+          if (token_name != "invalid" && token_name != "comment") {
+            symbols.emplace_back(token_name, input.substr(i_start, length));
+          }
+        });
+    return symbols;
+  };
+  for (auto&& [input_name, input]: { std::make_pair(synthetic_name, &synthetic_code),
+                                     std::make_pair(generated_name, &generated_code) }) {
+    runner.run("pipeline/sequential_LL1_recognize/" + input_name, [&, input = input]() {
+      auto symbols = collect_tokens(*input);
+      if (!LL1_analyser.recognize(symbols.begin(), symbols.end())) {
+        std::cerr << "LL(1) analyser rejected the benchmark input\n";
+      }
+      return bench::counters_t { { "bytes", double(input->size()) }, { "tokens", double(symbols.size()) } };
+    });
+    // same tokens as the sequential run, counted outside the timing
+    auto num_tokens = collect_tokens(*input).size();
+    runner.run("pipeline/pipelined_LL1_recognize/" + input_name, [&, input = input]() {
+      bool accepted = compiler::pipelined_parse(*dfa, *input, [&](auto it_begin, auto it_end) {
+        return LL1_analyser.recognize(it_begin, it_end);
+      });
+      if (!accepted) {
+        std::cerr << "LL(1) analyser rejected the benchmark input\n";
+      }
+      return bench::counters_t { { "bytes", double(input->size()) }, { "tokens", double(num_tokens) } };
+    });
+    // the parser pulling tokens from the compiled DFA, no token is stored
+    compiler::fused_dfa_parser_t<compiler::LL1_syntax_analyser_t> fused_LL1(*dfa, LL1_analyser);
+    runner.run("pipeline/fused_LL1_recognize/" + input_name, [&, input = input]() {
+      if (!fused_LL1.recognize(*input)) {
+        std::cerr << "LL(1) analyser rejected the benchmark input\n";
+      }
+      return bench::counters_t { { "bytes", double(input->size()) }, { "tokens", double(num_tokens) } };
+    });
+    if (LR_analyser && runner.enabled("pipeline/fused_LR_recognize")) {
+      compiler::fused_dfa_parser_t<compiler::LR_syntax_analyser_t> fused_LR(*dfa, *LR_analyser);
+      runner.run("pipeline/fused_LR_recognize/" + input_name, [&, input = input]() {
+        if (!fused_LR.recognize(*input)) {
+          std::cerr << "LR analyser rejected the benchmark input\n";
+        }
+        return bench::counters_t { { "bytes", double(input->size()) }, { "tokens", double(num_tokens) } };
+      });
+    }
+  }
+
+  // many small files read whole, with a syscall per open, fstat, read and
+  // close or batched through io_uring, and then lexed and parsed too
+  const std::string files_name = std::to_string(num_files) + "files";
+  bool files_enabled = false;
+  for (auto&& name: { "io/ifstream_read/", "io/pread_read/", "io/io_uring_read/",
+                      "batch/LL1_pread/", "batch/LL1_io_uring/" }) {
+    files_enabled |= runner.enabled(name + files_name);
+  }
+  if (files_enabled) {
+    auto files_dir = std::filesystem::temp_directory_path()
+        / ("compiler_bench_files_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(files_dir);
+    std::vector<std::string> paths;
+    std::size_t files_bytes = 0;
+    compiler::source_generator_t files_generator(syntax, start_symbol, *dfa, seed);
+    for (std::size_t idx = 0; idx < num_files; ++idx) {
+      paths.push_back((files_dir / ("file_" + std::to_string(idx) + ".c")).string());
+      std::ofstream file_out_stream(paths.back());
+      auto content = files_generator.generate(16 + idx * 7919 % 1000, 16);
+      files_bytes += content.size();
+      file_out_stream << content;
+    }
+
+    runner.run("io/ifstream_read/" + files_name, [&]() {
+      std::size_t bytes = 0;
+      for (auto&& path: paths) {
+        bytes += read_file(path).size();
+      }
+      return bench::counters_t { { "bytes", double(bytes) }, { "files", double(paths.size()) } };
+    });
+    for (bool use_io_uring: { false, true }) {
+      utils::io::batch_reader_t reader(use_io_uring);
+      if (use_io_uring && !reader.uses_io_uring()) {
+        std::cerr << "io_uring unavailable: " << reader.error() << "\n";
+        continue;
+      }
+      runner.run(std::string(use_io_uring ? "io/io_uring_read/" : "io/pread_read/") + files_name, [&]() {
+        std::size_t bytes = 0, num_syscalls = reader.num_syscalls();
+        reader.read(paths, [&](std::size_t, std::string_view content, int) { bytes += content.size(); });
+        return bench::counters_t { { "bytes", double(bytes) }, { "files", double(paths.size()) },
+                                   { "syscalls", double(reader.num_syscalls() - num_syscalls) } };
+      });
+      runner.run(std::string(use_io_uring ? "batch/LL1_io_uring/" : "batch/LL1_pread/") + files_name, [&]() {
+        compiler::batch_driver_t<compiler::LL1_syntax_analyser_t> driver(*dfa, LL1_analyser,
+            std::thread::hardware_concurrency(), use_io_uring);
+        auto results = driver.run(paths);
+        std::size_t num_tokens = 0;
+        for (auto&& result: results) {
+          num_tokens += result.tokens;
+        }
+        return bench::counters_t { { "bytes", double(files_bytes) }, { "files", double(paths.size()) },
+                                   { "tokens", double(num_tokens) } };
+      });
+    }
+    std::filesystem::remove_all(files_dir);
+  }
+
+  // directed graph
+  const std::size_t num_vertices = 20000, out_degree = 4;
+  std::vector<std::shared_ptr<Vertex>> vertices;
+  runner.run("graph/build/20000x4", [&]() {
+    auto graph = build_graph(vertices, num_vertices, out_degree);
+    return bench::counters_t { { "edges", double(graph->num_edges()) } };
+  });
+
+  auto graph = build_graph(vertices, num_vertices, out_degree);
+  runner.run("graph/out_edge_descriptions/20000x4", [&]() {
+    std::size_t num_edges = 0;
+    for (auto& vertex: vertices) {
+      for (auto&& [in, out, edge]: graph->out_edge_descriptions(vertex)) {
+        num_edges += out->m_idx != in->m_idx;
+      }
+    }
+    return bench::counters_t { { "edges", double(num_edges) } };
+  });
+  runner.run("graph/in_edge_descriptions/20000x4", [&]() {
+    std::size_t num_edges = 0;
+    for (auto& vertex: vertices) {
+      for (auto&& [in, out, edge]: graph->in_edge_descriptions(vertex)) {
+        num_edges += out->m_idx != in->m_idx;
+      }
+    }
+    return bench::counters_t { { "edges", double(num_edges) } };
+  });
+  runner.run("graph/edges/20000x4", [&]() {
+    std::size_t num_edges = 0;
+    for (auto&& [in, out, edge]: graph->edges()) {
+      num_edges += edge != nullptr;
+    }
+    return bench::counters_t { { "edges", double(num_edges) } };
+  });
+  runner.run("graph/remove_vertex/20000x4", [&]() {
+    auto removed_graph = build_graph(vertices, num_vertices, out_degree);
+    for (std::size_t idx = 0; idx < num_vertices; idx += 2) {
+      removed_graph->remove_vertex(vertices[idx]);
+    }
+    return bench::counters_t { { "vertices", double(num_vertices / 2) } };
+  });
+
+  if (json_filename.empty()) {
+    runner.write_json(std::cout);
+  } else {
+    std::ofstream json_stream(json_filename);
+    runner.write_json(json_stream);
+  }
+
+  return 0;
+}
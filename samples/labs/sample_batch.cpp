@@ -0,0 +1,125 @@
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <utils/io/content_cache.hpp>
+#include <utils/io/smart_ifstream.hpp>
+#include <utils/profile/trace.hpp>
+#include <compiler/batch_driver.hpp>
+#include <compiler/lexical_analysis.hpp>
+#include <compiler/syntax.hpp>
+#include <compiler/syntax_analysis.hpp>
+#include <compiler/syntax_analysis_lr.hpp>
+#include <compiler/syntax_loader.hpp>
+
+// usage: sample_batch [--threads=N] [--lr] [--no-io-uring] [--trace=FILE]
+//     [--cache=DIR] [--cache-size=MB]
+//     <lexical dfa> <syntax> <file list | directory> <report output>
+// lexes and parses every file with the DFA and the LL(1) (or LR(1)) table
+// built once, writing a JSON report with per-file tokens and diagnostics;
+// files are read through io_uring unless --no-io-uring or unavailable.
+// With --cache, results are kept in DIR and reused while neither the file
+// nor the tables change; a grammar change reparses the cached token
+// streams without lexing again
+template <typename Analyser>
+int run_batch(const compiler::lexical_automaton_t& dfa, const Analyser& analyser,
+    const std::vector<std::string>& paths, std::size_t num_threads, bool use_io_uring,
+    utils::io::content_cache_t* cache, const std::string& report_path)
+{
+  compiler::batch_driver_t<Analyser> driver(dfa, analyser, num_threads, use_io_uring);
+  driver.set_cache(cache);
+  auto time_start = std::chrono::steady_clock::now();
+  auto results = driver.run(paths);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - time_start).count();
+
+  std::ofstream report_out_stream(report_path);
+  compiler::write_batch_report(report_out_stream, results, seconds);
+
+  std::size_t bytes = 0, tokens = 0, accepted = 0;
+  for (auto&& result: results) {
+    bytes += result.bytes;
+    tokens += result.tokens;
+    accepted += result.accepted;
+  }
+  std::cerr << results.size() << " files (" << accepted << " accepted), "
+            << bytes << " bytes, " << tokens << " tokens in " << seconds << " s on "
+            << driver.num_threads() << " threads, " << driver.num_steals() << " steals, "
+            << results.size() / seconds << " files/s, " << bytes / seconds / (1 << 20) << " MB/s\n"
+            << "read with " << (driver.reader().uses_io_uring() ? "io_uring" : "pread") << " in "
+            << driver.reader().num_syscalls() << " system calls";
+  if (!driver.reader().error().empty()) {
+    std::cerr << " (" << driver.reader().error() << ")";
+  }
+  std::cerr << "\n";
+  if (cache) {
+    std::cerr << "cache: " << cache->num_hits() << " hits, " << cache->num_misses() << " misses, "
+              << cache->num_writes() << " writes\n";
+  }
+  return accepted == results.size() ? 0 : 2;
+}
+
+int main(int argc, char* argv[])
+{
+  std::vector<std::string> args;
+  std::size_t num_threads = std::thread::hardware_concurrency();
+  bool flag_lr = false, flag_io_uring = true;
+  std::string cache_directory;
+  std::uint64_t cache_megabytes = 1024;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string arg = argv[idx];
+    if (arg.rfind("--threads=", 0) == 0) {
+      num_threads = std::stoull(arg.substr(10));
+    } else if (arg == "--lr") {
+      flag_lr = true;
+    } else if (arg == "--no-io-uring") {
+      flag_io_uring = false;
+    } else if (arg.rfind("--cache=", 0) == 0) {
+      cache_directory = arg.substr(8);
+    } else if (arg.rfind("--cache-size=", 0) == 0) {
+      cache_megabytes = std::stoull(arg.substr(13));
+    } else if (arg.rfind("--trace=", 0) == 0) {
+      utils::profile::trace::start(arg.substr(8));
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.size() < 4) {
+    std::cerr << "usage: " << argv[0] << " [--threads=N] [--lr] [--no-io-uring] [--trace=FILE]"
+              << " [--cache=DIR] [--cache-size=MB]"
+              << " <lexical dfa> <syntax> <file list | directory> <report output>\n";
+    return 1;
+  }
+
+  using ifstream = utils::io::smart_ifstream;
+  ifstream dfa_in_stream(args[0]);
+  auto dfa = compiler::load_lexical_automaton(dfa_in_stream);
+
+  ifstream syntax_in_stream(args[1]);
+  std::string start_symbol_id;
+  std::vector<compiler::operator_table_t> operator_tables;
+  std::vector<compiler::production_rule_t> rules;
+  try {
+    rules = compiler::load_production_rules(syntax_in_stream, start_symbol_id, operator_tables);
+  } catch (const compiler::grammar_error_t& error) {
+    std::cerr << args[1] << ": " << error.what() << "\n";
+    return 1;
+  }
+  compiler::syntax_t syntax(rules.begin(), rules.end(), operator_tables);
+
+  auto paths = compiler::collect_batch_paths(args[2]);
+  std::unique_ptr<utils::io::content_cache_t> cache;
+  if (!cache_directory.empty()) {
+    cache = std::make_unique<utils::io::content_cache_t>(cache_directory, cache_megabytes << 20);
+  }
+  if (flag_lr) {
+    compiler::LR_syntax_analyser_t analyser(syntax, compiler::symbol_t(start_symbol_id));
+    return run_batch(*dfa, analyser, paths, num_threads, flag_io_uring, cache.get(), args[3]);
+  }
+  compiler::LL1_syntax_analyser_t analyser(syntax, compiler::symbol_t(start_symbol_id));
+  return run_batch(*dfa, analyser, paths, num_threads, flag_io_uring, cache.get(), args[3]);
+}
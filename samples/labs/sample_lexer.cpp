@@ -9,6 +9,7 @@
 #include <stack>
 
 #include <utils/io/smart_ifstream.hpp>
+#include <utils/profile/stats.hpp>
 
 using namespace std;
 
@@ -230,8 +231,8 @@ void smart_token_output(const string& token_id, const string& accepted_string, s
   out_stream << " >\n";
 }
 
-void scan(shared_ptr<Automaton> dfa, const std::string &input, std::ofstream& out_stream) {
-  size_t i_start = 0, i_offset;
+size_t scan(shared_ptr<Automaton> dfa, const std::string &input, std::ofstream& out_stream) {
+  size_t i_start = 0, i_offset, num_tokens = 0;
   for ( ; i_start < input.length(); i_start += i_offset) {
     stack<shared_ptr<State>> stack;
     stack.push(dfa->start_state());
@@ -264,12 +265,36 @@ void scan(shared_ptr<Automaton> dfa, const std::string &input, std::ofstream& ou
       auto stopped_state = stack.top();
       if (stopped_state->token_id != "BLANK") {
         smart_token_output(stopped_state->token_id, input.substr(i_start, i_offset), out_stream);
+        ++num_tokens;
       }
     }
   }
+  return num_tokens;
 }
 
+// usage: sample_lexer [--stats | --stats=json] <code> <token output> <dfa csv output>
+// statistics are written to stderr
 int main(int argc, char *argv[]) {
+  vector<string> args;
+  string stats_format;
+  for (int idx = 1; idx < argc; ++idx) {
+    string arg = argv[idx];
+    if (arg == "--stats") {
+      stats_format = "table";
+    } else if (arg == "--stats=json") {
+      stats_format = "json";
+    } else {
+      args.push_back(arg);
+    }
+  }
+  if (args.size() < 3) {
+    cerr << "usage: " << argv[0] << " [--stats | --stats=json] <code> <token output> <dfa csv output>\n";
+    return 1;
+  }
+  utils::profile::stats_t stats(!stats_format.empty());
+
+  auto load_timer = std::make_unique<utils::profile::stats_t::scoped_timer_t>(
+      stats.enabled() ? &stats : nullptr, "load DFA");
   using utils::io::smart_ifstream;
   smart_ifstream smart_in("assets/dfa/dfa_define.txt");
 
@@ -304,15 +329,39 @@ int main(int argc, char *argv[]) {
     }
   }
 
-  std::ofstream dfa_out_stream(argv[3]);
-  dfa->output_as_csv(dfa_out_stream);
+  load_timer.reset();
+  stats.set("DFA states", dfa->num_states());
+  stats.set("DFA transitions", dfa->num_transitions());
 
-  std::ifstream in_stream(argv[1]);
-  std::string input_content { std::istreambuf_iterator<char>(in_stream), std::istreambuf_iterator<char>() };
+  {
+    auto timer = stats.time("write DFA csv");
+    std::ofstream dfa_out_stream(args[2]);
+    dfa->output_as_csv(dfa_out_stream);
+  }
 
-  std::ofstream out_stream(argv[2]);
-  scan(dfa, input_content, out_stream);
+  std::string input_content;
+  {
+    auto timer = stats.time("read code");
+    std::ifstream in_stream(args[0]);
+    input_content.assign(std::istreambuf_iterator<char>(in_stream), std::istreambuf_iterator<char>());
+  }
+  stats.set("bytes", input_content.size());
+
+  {
+    auto timer = stats.time("scan");
+    std::ofstream out_stream(args[1]);
+    stats.set("tokens", scan(dfa, input_content, out_stream));
+  }
+  stats.set_rate("bytes", "scan");
+  stats.set_rate("tokens", "scan");
 
-  
+  if (stats.enabled()) {
+    stats.record_process();
+    if (stats_format == "json") {
+      stats.print_json(cerr);
+    } else {
+      stats.print_table(cerr);
+    }
+  }
   return 0;
 }
\ No newline at end of file
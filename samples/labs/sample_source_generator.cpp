@@ -0,0 +1,39 @@
+#include <iostream>
+#include <string>
+
+#include <utils/io/smart_ifstream.hpp>
+#include <compiler/lexical_analysis.hpp>
+#include <compiler/source_generator.hpp>
+#include <compiler/syntax.hpp>
+#include <compiler/syntax_loader.hpp>
+
+// usage: sample_source_generator <lexical dfa> <syntax> <num tokens> [max depth] [seed]
+int main(int argc, char* argv[])
+{
+  if (argc < 4) {
+    std::cerr << "usage: " << argv[0] << " <lexical dfa> <syntax> <num tokens> [max depth] [seed]\n";
+    return 1;
+  }
+
+  using ifstream = utils::io::smart_ifstream;
+  ifstream dfa_in_stream(argv[1]);
+  auto dfa = compiler::load_lexical_automaton(dfa_in_stream);
+
+  ifstream syntax_in_stream(argv[2]);
+  std::string start_symbol_id;
+  auto rules = compiler::load_production_rules(syntax_in_stream, start_symbol_id);
+  compiler::syntax_t syntax(rules.begin(), rules.end());
+
+  std::size_t num_tokens = std::stoull(argv[3]);
+  std::size_t max_depth = argc > 4 ? std::stoull(argv[4]) : 32;
+  std::uint64_t seed = argc > 5 ? std::stoull(argv[5]) : 0;
+
+  compiler::source_generator_t generator(
+      syntax, compiler::symbol_t(start_symbol_id), *dfa, seed);
+  for (auto&& terminal: generator.unspellable_terminals()) {
+    std::cerr << "warning: no lexeme scans into " << terminal << "\n";
+  }
+  auto num_generated_tokens = generator.generate(std::cout, num_tokens, max_depth);
+  std::cerr << num_generated_tokens << " tokens\n";
+  return 0;
+}
@@ -3,321 +3,132 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <stack>
-#include <bitset>
 
-#include <utils/automaton/automaton.hpp>
 #include <utils/io/smart_ifstream.hpp>
+#include <compiler/lexical_analysis.hpp>
 #include <compiler/syntax.hpp>
 #include <compiler/syntax_analysis.hpp>
+#include <compiler/syntax_analysis_earley.hpp>
+#include <compiler/syntax_analysis_glr.hpp>
 #include <compiler/syntax_analysis_lr.hpp>
-
-
-
-struct State : utils::automaton::state_property_base
-{
-  std::size_t m_idx;
-  bool m_is_finalize;
-  std::string m_token_name;
-
-  State(std::size_t idx)
-  : m_idx(idx), m_is_finalize(false)
-  { }
-
-  void set_finalize(const std::string& token_name)
-  {
-    m_is_finalize = true;
-    m_token_name = token_name;
-  }
-
-  bool is_finalize() override
-  {
-    return m_is_finalize;
-  }
-};
-
-char translate_escape_character(char escape_character)
-{
-  static std::unordered_map<char, char> translation_map = {
-    { 'b', ' ' }, { 't','\t' }, { 'n','\n' }, { '[', '[' }, { ']', ']' }, 
-    { '.', '.' }, {'\\','\\' },
-  };
-  if (translation_map.count(escape_character) > 0) {
-    return translation_map[escape_character];
-  } else {
-    return '\0';
-  }
-}
-
-std::bitset<256> character_set_all()
-{
-  std::bitset<256> character_set = 0;
-  character_set.set();
-  return character_set;
-}
-
-std::bitset<256> parse_character_set_without_reverse(const std::string& pattern)
+#include <compiler/syntax_loader.hpp>
+
+#include <utils/profile/counting_resource.hpp>
+#include <utils/profile/stats.hpp>
+#include <utils/profile/trace.hpp>
+
+// usage: sample_syntax_analysis [--stats | --stats=json] [--perf] [--arena] [--trace=FILE] [--counters]
+//     [--lr] [--lr-compressed] [--lr-chain-free] [--glr] [--earley]
+//     <lexical dfa> <syntax> <code> <lexical output> <syntax output>
+// statistics are written to stderr, with hardware counters per phase when
+// --perf is given and perf_event_open is permitted; --arena builds the DFA,
+// the grammar and the tables in one monotonic arena; a Chrome trace_event
+// JSON is written to FILE;
+// --counters reports the hottest DFA states, rules and LR states when
+// built with UTILS_PROFILE_ENABLE_COUNTERS;
+// with --stats, --lr also builds the LR(1) table and parses the code with
+// it, with compressed tables given --lr-compressed and with its chain
+// rules bypassed given --lr-chain-free; --glr also runs the GLR engine on
+// that table and --earley the Earley parser. The exit status is 2
+// when such a parser does not agree with LL(1) on accepting the code
+int main(int argc, char* argv[])
 {
-  std::bitset<256> character_set = 0;
-  for (std::size_t idx = 0, length = pattern.length(); idx < length; ++idx) {
-    if (pattern[idx] == '\\') {
-      character_set.set(translate_escape_character(pattern[idx + 1]));
-      ++idx;
-    } else if (isdigit(pattern[idx]) && pattern[idx + 1] == '-' && idx + 2 < length && isdigit(pattern[idx + 2])) {
-      for (auto ch = pattern[idx]; ch <= pattern[idx + 2]; ++ch) {
-        character_set.set(ch);
-      }
-      idx += 2;
-    } else if (isalpha(pattern[idx]) && pattern[idx + 1] == '-' && idx + 2 < length && isalpha(pattern[idx + 2])) {
-      for (auto ch = pattern[idx]; ch <= pattern[idx + 2]; ++ch) {
-        character_set.set(ch);
-      }
-      idx += 2;
+  std::vector<std::string> args;
+  std::string stats_format;
+  bool flag_counters = false, flag_perf = false, flag_arena = false;
+  bool flag_lr = false, flag_lr_compressed = false, flag_lr_chain_free = false, flag_glr = false;
+  bool flag_earley = false;
+  for (int idx = 1; idx < argc; ++idx) {
+    std::string arg = argv[idx];
+    if (arg == "--stats") {
+      stats_format = "table";
+    } else if (arg == "--stats=json") {
+      stats_format = "json";
+    } else if (arg.rfind("--trace=", 0) == 0) {
+      utils::profile::trace::start(arg.substr(8));
+    } else if (arg == "--arena") {
+      flag_arena = true;
+    } else if (arg == "--perf") {
+      flag_perf = true;
+    } else if (arg == "--counters") {
+      flag_counters = true;
+    } else if (arg == "--lr") {
+      flag_lr = true;
+    } else if (arg == "--lr-compressed") {
+      flag_lr = flag_lr_compressed = true;
+    } else if (arg == "--lr-chain-free") {
+      flag_lr = flag_lr_chain_free = true;
+    } else if (arg == "--glr") {
+      flag_lr = flag_glr = true;
+    } else if (arg == "--earley") {
+      flag_earley = true;
     } else {
-      character_set.set(pattern[idx]);
+      args.push_back(arg);
     }
   }
-  return character_set;
-}
-
-std::bitset<256> parse_character_set(const std::string& pattern)
-{
-  std::bitset<256> character_set = 0;
-  if (pattern[0] == '^') {
-    if (pattern.length() > 1) {
-      character_set = ~parse_character_set_without_reverse(pattern.substr(1));
-    }
-  } else {
-    character_set = parse_character_set_without_reverse(pattern);
+  if (args.size() < 5) {
+    std::cerr << "usage: " << argv[0] << " [--stats | --stats=json] [--perf] [--arena] [--trace=FILE] [--counters]"
+              << " [--lr] [--lr-compressed] [--lr-chain-free] [--glr] [--earley]"
+              << " <lexical dfa> <syntax> <code> <lexical output> <syntax output>\n";
+    return 1;
   }
-  return character_set;
-}
-
-struct Transition : utils::automaton::transition_property_base<char>
-{
-  bool m_is_epsilon = false;
-  std::bitset<256> m_character_set = 0;
-
-  Transition(const std::string& parameter)
-  {
-    if (parameter == "epsilon") {
-      // epsilon transition
-      m_is_epsilon = true;
-    } else if (parameter.length() == 1) {
-      // single character
-      if (parameter[0] == '.') {
-        m_character_set = character_set_all();
-      } else {
-        m_character_set.set(parameter[0]);
-      }
-    } else if (parameter.length() == 2 && parameter[0] == '\\') {
-      // escape character
-      m_character_set.set(translate_escape_character(parameter[1]));
-    } else if (parameter[0] == '[' && parameter.back() == ']') {
-      // character range
-      m_character_set = parse_character_set(parameter.substr(1, parameter.length() - 2));
-    }
+  utils::profile::stats_t stats(!stats_format.empty());
+  if (flag_perf) {
+    stats.enable_perf();
   }
 
-  bool is_epsilon() override
-  {
-    return m_is_epsilon;
-  }
+  // one counting resource per component, over the heap or a shared arena
+  // released at once when main returns
+  std::pmr::monotonic_buffer_resource arena;
+  auto upstream = flag_arena ? &arena : std::pmr::new_delete_resource();
+  utils::profile::counting_resource_t DFA_resource(upstream), syntax_resource(upstream),
+      LL1_resource(upstream), LR_resource(upstream);
 
-  bool accept(char value) override
+  using ifstream = utils::io::smart_ifstream;
+  std::shared_ptr<compiler::lexical_automaton_t> dfa;
   {
-    return m_character_set[value];
+    auto timer = stats.time("load DFA");
+    ifstream dfa_in_stream(args[0]);
+    dfa = compiler::load_lexical_automaton(dfa_in_stream, &DFA_resource);
   }
-};
+  stats.set("DFA states", dfa->num_vertices());
+  stats.set("DFA transitions", dfa->num_edges());
 
-using Automaton = utils::automaton::automaton_t<State, Transition>;
-
-std::string smart_character_output(char c)
-{
-  if (c == ' ') {
-    return "\\b";
-  } else if (c == '\t') {
-    return "\\t";
-  } else if (c == '\n') {
-    return "\\n";
-  } else {
-    return std::string { c };
-  }
-}
-
-void smart_token_output(
-    const std::string& token_id, 
-    const std::string& accepted_string, 
-    std::ostream& out_stream)
-{
-  out_stream << "< " << token_id << " ,\t";
-  for (auto& ch: accepted_string) {
-    out_stream << smart_character_output(ch);
-  }
-  out_stream << " >\n";
-}
-
-std::vector<compiler::symbol_t> scan(
-    std::shared_ptr<Automaton> dfa, 
-    const std::string& input_content,
-    std::ostream& out_stream)
-{
-  std::vector<compiler::symbol_t> terminate_symbols;
-  for (std::size_t i_start = 0, i_offset;
-      i_start < input_content.length();
-      i_start += i_offset)
+  std::string input_content;
   {
-    std::stack<typename Automaton::vertex_property_pointer_t> stack;
-    stack.push(dfa->start_state());
-    i_offset = 1;
-    while (i_start + i_offset <= input_content.length() && !stack.empty()) {
-      auto current_state = stack.top();
-      bool found = false;
-      for (auto&& [state_in, state_out, transition]:
-          dfa->out_edge_descriptions(current_state)) 
-      {
-        if (transition->accept(input_content[i_start + i_offset - 1])) {
-          found = true;
-          stack.push(state_out);
-          break;
-        }
-      }
-      if (found) {
-        i_offset += 1;
-      } else {
-        i_offset -= 1;
-        break;
-      }
-    }
-    while (i_offset > 0 && !stack.top()->is_finalize()) {
-      i_offset -= 1;
-      stack.pop();
-    }
-    if (i_offset == 0) {
-      smart_token_output(
-          "invalid", 
-          input_content.substr(i_start, 1), 
-          out_stream);
-      i_start += 1;
-    } else {
-      auto stopped_state = stack.top();
-      if (stopped_state->m_token_name != "blank") {
-        smart_token_output(
-            stopped_state->m_token_name, 
-            input_content.substr(i_start, i_offset), 
-            out_stream);
-        if (stopped_state->m_token_name != "comment") {
-          terminate_symbols.emplace_back(
-              stopped_state->m_token_name, 
-              input_content.substr(i_start, i_offset));
-        }
-      }
-    }
-  }
-  return terminate_symbols;
-}
-
-std::vector<compiler::symbol_t> lexical_analysis(
-    utils::io::smart_ifstream& dfa_in_stream,
-    std::ifstream& code_in_stream,
-    std::ofstream& out_stream)
-{
-  // construct automaton
-  std::vector<typename Automaton::vertex_property_pointer_t> states;
-  states.push_back(std::make_shared<State>(0));
-  
-  std::size_t num_states, num_finalize_states;
-  dfa_in_stream >> num_states >> num_finalize_states;
-
-  auto dfa = std::make_shared<Automaton>(states[0]);
-
-  for (std::size_t idx = 1; idx < num_states; ++idx) {
-    auto state = std::make_shared<State>(idx);
-    states.push_back(state);
-    dfa->add_vertex(state);
-  }
-
-  while (num_finalize_states--) {
-    std::size_t idx_state;
-    std::string token_name;
-    dfa_in_stream >> idx_state >> token_name;
-
-    states[idx_state]->set_finalize(token_name);
+    auto timer = stats.time("read code");
+    std::ifstream code_in_stream(args[2]);
+    input_content.assign(
+        std::istreambuf_iterator<char>(code_in_stream),
+        std::istreambuf_iterator<char>());
   }
+  stats.set("bytes", input_content.size());
 
+  std::vector<compiler::symbol_t> symbols;
   {
-    std::size_t idx_state_in, idx_state_out;
-    std::string parameter;
-    while (dfa_in_stream >> idx_state_in >> idx_state_out >> parameter) {
-      auto transition = std::make_shared<Transition>(parameter);
-      dfa->add_edge(states[idx_state_in], states[idx_state_out], transition);
-    }
+    auto timer = stats.time("scan");
+    std::ofstream lexical_out_stream(args[3]);
+    symbols = compiler::scan(dfa, input_content, lexical_out_stream);
   }
+  stats.set("tokens", symbols.size());
+  stats.set_rate("tokens", "scan");
 
-  // scan
-  std::string input_content {
-      std::istreambuf_iterator<char>(code_in_stream), 
-      std::istreambuf_iterator<char>() 
-  };
-  return scan(dfa, input_content, out_stream);
-}
-
-int main(int argc, char* argv[])
-{
-  using ifstream = utils::io::smart_ifstream;
-  ifstream dfa_in_stream(argv[1]);
-  std::ifstream code_in_stream(argv[3]);
-  std::ofstream lexical_out_stream(argv[4]);
-  auto symbols = lexical_analysis(dfa_in_stream, code_in_stream, lexical_out_stream);
-
-  ifstream in_stream(argv[2]);
+  std::string start_symbol_id;
   std::vector<compiler::production_rule_t> rules;
-  std::string start_symbol_id = "";
+  std::vector<compiler::operator_table_t> operator_tables;
   {
-    std::string s;
-    std::string symbol;
-    std::vector<std::string> rule;
-
-label_symbol:
-    if (in_stream >> s) {
-      symbol = s;
-      if (start_symbol_id == "") {
-        start_symbol_id = s;
-      }
-      goto label_is_defined_as;
-    } else {
-      goto label_terminate;
-    }
-
-label_is_defined_as:
-    in_stream >> s;
-    goto label_rule_start;
-
-label_rule_start:
-    in_stream >> s;
-    rule.push_back(s);
-    goto label_rule_loop;
-
-label_rule_loop:
-    in_stream >> s;
-    if (s == "|") {
-      rules.emplace_back(symbol, rule.begin(), rule.end());
-      rule.clear();
-      goto label_rule_start;
-    } else if (s == ";") {
-      rules.emplace_back(symbol, rule.begin(), rule.end());
-      rule.clear();
-      goto label_symbol;
-    } else {
-      rule.push_back(s);
-      goto label_rule_loop;
+    auto timer = stats.time("load grammar");
+    ifstream in_stream(args[1]);
+    try {
+      rules = compiler::load_production_rules(in_stream, start_symbol_id, operator_tables);
+    } catch (const compiler::grammar_error_t& error) {
+      std::cerr << args[1] << ": " << error.what() << "\n";
+      return 1;
     }
-
-label_terminate:
-    ;
   }
+  stats.set("production rules", rules.size());
 
-  compiler::syntax_t syntax(rules.begin(), rules.end());
+  compiler::syntax_t syntax(rules.begin(), rules.end(), operator_tables, &syntax_resource);
 
   std::cout << "terminate symbols:";
   for (auto&& symbol: syntax.terminate_symbols()) {
@@ -341,8 +152,10 @@ label_terminate:
   }
   std::cout << "\n";
 
-  compiler::LL1_syntax_analyser_t analyser(
-      syntax, compiler::symbol_t(start_symbol_id));
+  auto analyser = [&]() {
+    auto timer = stats.time("build LL(1) table");
+    return compiler::LL1_syntax_analyser_t(syntax, compiler::symbol_t(start_symbol_id), &LL1_resource);
+  }();
 
   for (auto&& symbol: analyser.non_terminate_symbols()) {
     std::cout << "FIRST(" << symbol << ") = { ";
@@ -368,8 +181,14 @@ label_terminate:
   }
   std::cout << "\n";
 
-  std::ofstream syntax_out_stream(argv[5]);
-  analyser.analysis(syntax_out_stream, symbols.begin(), symbols.end());
+  compiler::LL1_syntax_analyser_t::parse_context_t LL1_context;
+  bool LL1_accepted;
+  {
+    auto timer = stats.time("LL(1) parse");
+    std::ofstream syntax_out_stream(args[4]);
+    LL1_accepted = analyser.analysis(syntax_out_stream, symbols.begin(), symbols.end(), LL1_context);
+  }
+  stats.set_rate("tokens", "LL(1) parse");
 
   if (analyser) {
     std::cout << "valid\n";
@@ -377,5 +196,131 @@ label_terminate:
     std::cout << "invalid\n";
   }
 
-  return 0;
+  if (flag_counters) {
+#ifndef UTILS_PROFILE_ENABLE_COUNTERS
+    std::cerr << "counters are compiled out, rebuild with UTILS_PROFILE_ENABLE_COUNTERS\n";
+#endif
+    compiler::report_lexer_counters(*dfa, std::cerr);
+    analyser.report_counters(std::cerr, LL1_context);
+  }
+
+  bool parsers_agree = true;
+  if (stats.enabled()) {
+    std::size_t predict_table_size = 0;
+    for (auto&& [non_terminate_symbol, items]: analyser.get_predict_table()) {
+      for (auto&& [terminate_symbol, rule_set]: items) {
+        predict_table_size += rule_set.size();
+      }
+    }
+    stats.set("predict table entries", predict_table_size);
+    stats.set("LL adaptive cells", analyser.num_conflicts());
+    stats.set("LL adaptive predictions", LL1_context.adaptive_predictions);
+    stats.set("LL lookahead DFA states", analyser.num_lookahead_states());
+
+    // the dense tables, where operator tables are parsed by precedence
+    // climbing
+    stats.set("LL operator tables", analyser.num_operator_tables());
+    {
+      auto timer = stats.time("LL(1) parse dense");
+      auto state = analyser.push_start();
+      analyser.feed(state, symbols.begin(), symbols.end());
+      analyser.finish(state);
+    }
+    stats.set_rate("tokens", "LL(1) parse dense");
+
+    // the other parsers must agree with LL(1) on the code
+    auto check_accepted = [&](const std::string& parser, bool accepted) {
+      if (accepted != LL1_accepted) {
+        std::cerr << parser << " parse " << (accepted ? "accepted" : "rejected")
+                  << " the code, LL(1) parse did not\n";
+        parsers_agree = false;
+      }
+    };
+
+    // the LR(1) table, sorted rows or compressed, with or without its
+    // chain rules
+    std::unique_ptr<const compiler::LR_syntax_analyser_t> LR_analyser;
+    if (flag_lr) {
+      compiler::LR_syntax_analyser_t::options_t LR_options;
+      LR_options.compress = flag_lr_compressed;
+      LR_options.eliminate_chain_rules = flag_lr_chain_free;
+      {
+        auto timer = stats.time("build LR(1) table");
+        LR_analyser = std::make_unique<compiler::LR_syntax_analyser_t>(
+            syntax, compiler::symbol_t(start_symbol_id), LR_options, &LR_resource);
+      }
+      stats.set("LR(1) states", LR_analyser->num_states());
+      stats.set("LR(1) conflicts", LR_analyser->num_conflicts());
+      compiler::LR_syntax_analyser_t::parse_context_t LR_context;
+      {
+        auto timer = stats.time("LR(1) parse");
+        check_accepted("LR(1)", LR_analyser->recognize(symbols.begin(), symbols.end(), LR_context));
+      }
+      stats.set_rate("tokens", "LR(1) parse");
+      stats.set("LR(1) reductions", LR_context.reductions);
+      if (flag_lr_chain_free) {
+        auto LR_chain_elimination = LR_analyser->chain_elimination();
+        stats.set("LR(1) chain rules eliminated", LR_chain_elimination.chain_rules);
+        stats.set("LR(1) chain states bypassed", LR_chain_elimination.bypassed_states);
+        stats.set("LR(1) gotos rewritten", LR_chain_elimination.rewritten_gotos);
+      }
+      if (flag_counters) {
+        LR_analyser->report_counters(std::cerr, LR_context);
+      }
+
+      auto LR_table_size = LR_analyser->table_size();
+      stats.set("LR(1) table bytes dense", LR_table_size.dense_bytes);
+      stats.set("LR(1) table bytes sparse", LR_table_size.sparse_bytes);
+      if (LR_analyser->compressed()) {
+        stats.set("LR(1) table bytes compressed", LR_table_size.compressed_bytes);
+        stats.set("LR(1) default reductions", LR_table_size.default_reductions);
+        if (LR_table_size.comb_slots > 0) {
+          stats.set("LR(1) comb vector fill %", 100.0 * LR_table_size.comb_entries / LR_table_size.comb_slots);
+        }
+      }
+    }
+
+    // the GLR engine on the same tables, building the parse forest
+    if (flag_glr) {
+      compiler::GLR_syntax_analyser_t GLR_analyser(*LR_analyser);
+      compiler::GLR_syntax_analyser_t::parse_context_t GLR_context;
+      {
+        auto timer = stats.time("GLR parse");
+        check_accepted("GLR", GLR_analyser.analysis(symbols.begin(), symbols.end(), GLR_context));
+      }
+      stats.set_rate("tokens", "GLR parse");
+      stats.set("GLR forest nodes", GLR_context.forest.nodes.size());
+      stats.set("GLR ambiguous nodes", GLR_context.forest.num_ambiguous());
+      stats.set("GLR tokens generalized", GLR_context.generalized_tokens);
+    }
+
+    // the Earley parser needs no table, for grammars none fits
+    if (flag_earley) {
+      compiler::Earley_syntax_analyser_t Earley_analyser(syntax, compiler::symbol_t(start_symbol_id));
+      compiler::Earley_syntax_analyser_t::parse_context_t Earley_context;
+      {
+        auto timer = stats.time("Earley parse");
+        check_accepted("Earley", Earley_analyser.analysis(symbols.begin(), symbols.end(), Earley_context));
+      }
+      stats.set_rate("tokens", "Earley parse");
+      stats.set("Earley items", Earley_context.items.size());
+      stats.set("Earley Leo completions", Earley_context.leo_completions);
+      stats.set("Earley forest nodes", Earley_context.forest.nodes.size());
+    }
+
+    for (auto&& [component, resource]: {
+        std::make_pair("DFA", &DFA_resource), std::make_pair("syntax", &syntax_resource),
+        std::make_pair("LL(1)", &LL1_resource), std::make_pair("LR(1)", &LR_resource) }) {
+      stats.set(std::string("bytes requested ") + component, resource->bytes_requested());
+      stats.set(std::string("allocations ") + component, resource->num_allocations());
+    }
+    stats.record_process();
+    if (stats_format == "json") {
+      stats.print_json(std::cerr);
+    } else {
+      stats.print_table(std::cerr);
+    }
+  }
+
+  return parsers_agree ? 0 : 2;
 }
\ No newline at end of file
@@ -9,7 +9,7 @@
 #include <utils/automaton/automaton.hpp>
 #include <utils/io/smart_ifstream.hpp>
 
-struct State : utils::automaton::state_property_base
+struct State
 {
   std::size_t m_idx;
   bool m_is_finalize;
@@ -25,7 +25,7 @@ struct State : utils::automaton::state_property_base
     m_token_name = token_name;
   }
 
-  bool is_finalize() override
+  bool is_finalize() const
   {
     return m_is_finalize;
   }
@@ -88,11 +88,8 @@ std::bitset<256> parse_character_set(const std::string& pattern)
   return character_set;
 }
 
-struct Transition : utils::automaton::transition_property_base<char>
+struct Transition : utils::automaton::character_set_transition_t
 {
-  bool m_is_epsilon = false;
-  std::bitset<256> m_character_set = 0;
-
   Transition(const std::string& parameter)
   {
     if (parameter == "epsilon") {
@@ -113,16 +110,6 @@ struct Transition : utils::automaton::transition_property_base<char>
       m_character_set = parse_character_set(parameter.substr(1, parameter.length() - 2));
     }
   }
-
-  bool is_epsilon() override
-  {
-    return m_is_epsilon;
-  }
-
-  bool accept(char value) override
-  {
-    return m_character_set[value];
-  }
 };
 
 using Automaton = utils::automaton::automaton_t<State, Transition>;
@@ -165,18 +152,10 @@ void scan(
     stack.push(dfa->start_state());
     i_offset = 1;
     while (i_start + i_offset <= input_content.length() && !stack.empty()) {
-      auto current_state = stack.top();
-      bool found = false;
-      for (auto&& [state_in, state_out, transition]:
-          dfa->out_edge_descriptions(current_state)) 
-      {
-        if (transition->accept(input_content[i_start + i_offset - 1])) {
-          found = true;
-          stack.push(state_out);
-          break;
-        }
-      }
-      if (found) {
+      auto next_state = dfa->transit(
+          stack.top(), input_content[i_start + i_offset - 1]);
+      if (next_state) {
+        stack.push(next_state);
         i_offset += 1;
       } else {
         i_offset -= 1;
@@ -0,0 +1,31 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include <utils/automaton/lazy_dfa.hpp>
+#include <utils/io/smart_ifstream.hpp>
+
+int main(int argc, char* argv[])
+{
+  using ifstream = utils::io::smart_ifstream;
+  ifstream nfa_in_stream(argv[1]);
+  auto nfa = utils::automaton::read_nfa(nfa_in_stream);
+
+  // optional cache budget in bytes
+  std::size_t max_memory = argc > 3 ? std::stoul(argv[3]) : std::size_t(8) << 20;
+  utils::automaton::lazy_dfa_t dfa(nfa, max_memory);
+
+  std::ifstream in_stream(argv[2]);
+  std::string line;
+  while (std::getline(in_stream, line)) {
+    std::cout << (dfa.match(line) ? "accepted" : "rejected") << "\t" << line << "\n";
+  }
+
+  std::cout << "\n";
+  std::cout << "cached states: " << dfa.num_cached_states() << "\n";
+  std::cout << "cache memory: " << dfa.memory() << " bytes\n";
+  std::cout << "cache hits: " << dfa.num_hits() << ", misses: " << dfa.num_misses() << "\n";
+  std::cout << "cache flushes: " << dfa.num_flushes() << "\n";
+
+  return 0;
+}